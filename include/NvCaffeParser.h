@@ -38,7 +38,8 @@ namespace nvcaffeparser1
 //!
 //! \brief Object used to store and query Tensors after they have been extracted from a Caffe model using the ICaffeParser.
 //!
-//! \note The lifetime of IBlobNameToTensor is the same as the lifetime of its parent ICaffeParser.
+//! \note The lifetime of IBlobNameToTensor is the same as the lifetime of its parent ICaffeParser, unless
+//! ICaffeParser::resetWeightMemory() is called first.
 //!
 //! \see nvcaffeparser1::ICaffeParser
 //!
@@ -157,6 +158,28 @@ public:
 
     virtual ~IPluginFactoryV2() {}
 };
+
+//!
+//! \struct CaffeParseJob
+//!
+//! \brief One model to parse with ICaffeParser::parseBatch().
+//!
+//! \see ICaffeParser::parseBatch()
+//!
+struct CaffeParseJob
+{
+    //! The plain text, prototxt file used to define the network definition.
+    const char* deploy{nullptr};
+    //! The binaryproto Caffe model that contains the weights associated with the network, or nullptr.
+    const char* model{nullptr};
+    //! Network in which the parser will fill the layers. Each job must have a network of its own.
+    nvinfer1::INetworkDefinition* network{nullptr};
+    //! The type to which the weights will transformed.
+    nvinfer1::DataType weightType{nvinfer1::DataType::kFLOAT};
+    //! Set by parseBatch() to the blob map of this model, or to nullptr if it could not be parsed.
+    const IBlobNameToTensor* result{nullptr};
+};
+
 //!
 //! \class ICaffeParser
 //!
@@ -292,6 +315,99 @@ public:
     //! \see setErrorRecorder
     //!
     virtual nvinfer1::IErrorRecorder* getErrorRecorder() const TRTNOEXCEPT = 0;
+
+    //!
+    //! \brief Set whether parse() decodes the binary model one layer at a time.
+    //!
+    //! In streaming mode the model file is memory-mapped and only indexed up front. The weights of a layer are
+    //! decoded when the layer is added to the network and released afterwards, so peak host memory is bounded by the
+    //! largest layer rather than by the whole model. Weights that need converting are still held until the parser
+    //! is destroyed, since the network refers to them until the engine is built.
+    //!
+    //! \param enable Whether to use streaming mode.
+    //!
+    //! \note Streaming mode only applies to parse(); parseBuffers() always decodes the whole model. It is off by
+    //! default.
+    //!
+    virtual void setStreamingParse(bool enable) TRTNOEXCEPT = 0;
+
+    //!
+    //! \brief Release the host memory that holds converted weights and plugin parameters, keeping it for reuse.
+    //!
+    //! The parser takes this memory from the system in large chunks. Resetting it lets one parser parse many models
+    //! without going back to the system allocator.
+    //!
+    //! \warning The networks filled by earlier calls to parse() or parseBuffers() refer to this memory, so they must
+    //! have been built before this is called. The IBlobNameToTensor objects returned by every parse() or
+    //! parseBuffers() call but the latest are deleted, so pointers to them dangle afterwards. The objects returned by
+    //! parseBatch() must not be used afterwards either, since their job parsers are reused by the next batch.
+    //!
+    virtual void resetWeightMemory() TRTNOEXCEPT = 0;
+
+    //!
+    //! \brief Get the number of bytes of weight memory in use since the parser was created or last reset.
+    //!
+    //! \see resetWeightMemory()
+    //!
+    virtual std::size_t getWeightMemoryInUse() const TRTNOEXCEPT = 0;
+
+    //!
+    //! \brief Get the highest number of bytes of weight memory that has been in use at any one time.
+    //!
+    //! \see resetWeightMemory()
+    //!
+    virtual std::size_t getWeightMemoryHighWaterMark() const TRTNOEXCEPT = 0;
+
+    //!
+    //! \brief Parse several prototxt files and binaryproto Caffe models in parallel.
+    //!
+    //! Each job is parsed as by parse(), with the plugin factories, namespace, buffer size and streaming mode set on
+    //! this parser, and gets a blob map of its own in CaffeParseJob::result. The jobs are spread over a pool of
+    //! worker threads. The plugin creator table is looked up once for the whole batch.
+    //!
+    //! \param jobs The models to parse.
+    //! \param nbJobs The number of jobs.
+    //! \param nbThreads The number of worker threads, or 0 to use one per hardware thread.
+    //!
+    //! \return true if every job was parsed successfully.
+    //!
+    //! \note Calls into the plugin factories and plugin creators are serialized, so they need not be thread-safe.
+    //! The blob maps and weights of a batch stay valid until resetWeightMemory() is called or the parser is
+    //! destroyed.
+    //!
+    //! \warning The parser must not be used from another thread while parseBatch() runs.
+    //!
+    virtual bool parseBatch(CaffeParseJob* jobs, std::int32_t nbJobs, std::int32_t nbThreads) TRTNOEXCEPT = 0;
+
+    //!
+    //! \brief Set the directory of the on-disk parse cache, or nullptr to disable it.
+    //!
+    //! When a directory is set, parsing a model with weights first hashes the contents of the deploy and model
+    //! files (or buffers) together with the weight type. If the cache has an entry for that key, the weights are
+    //! mapped from it, already converted, and the model is not decoded. Otherwise the model is parsed as usual and
+    //! the weights it yields are written to a new entry. Entries are little-endian and are replaced atomically, so
+    //! several processes may share a directory.
+    //!
+    //! \param directory An existing directory, or nullptr. The cache is disabled by default.
+    //!
+    //! \note The layers of the network are still built from the deploy file, which is small. An entry is only valid
+    //! for the plugin factories it was recorded with.
+    //!
+    virtual void setParseCacheDirectory(const char* directory) TRTNOEXCEPT = 0;
+
+    //!
+    //! \brief Get the number of parses, including those of parseBatch(), that were served from the parse cache.
+    //!
+    //! \see setParseCacheDirectory()
+    //!
+    virtual std::int64_t getParseCacheHits() const TRTNOEXCEPT = 0;
+
+    //!
+    //! \brief Get the number of parses, including those of parseBatch(), that missed the parse cache.
+    //!
+    //! \see setParseCacheDirectory()
+    //!
+    virtual std::int64_t getParseCacheMisses() const TRTNOEXCEPT = 0;
 };
 
 //!
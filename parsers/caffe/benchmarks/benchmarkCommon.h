@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TRT_CAFFE_PARSER_BENCHMARK_COMMON_H
+#define TRT_CAFFE_PARSER_BENCHMARK_COMMON_H
+
+#include <chrono>
+#include <iostream>
+
+#include "NvInfer.h"
+
+namespace nvcaffeparser1
+{
+namespace benchmark
+{
+// Prints the warnings and errors of TensorRT
+class Logger : public nvinfer1::ILogger
+{
+public:
+    void log(Severity severity, const char* msg) override
+    {
+        if (severity <= Severity::kWARNING)
+        {
+            std::cerr << msg << std::endl;
+        }
+    }
+};
+
+// Wall clock time of one call to fn, in milliseconds
+template <typename Fn>
+double timeMs(Fn fn)
+{
+    const auto start = std::chrono::steady_clock::now();
+    fn();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+} // namespace benchmark
+} // namespace nvcaffeparser1
+#endif // TRT_CAFFE_PARSER_BENCHMARK_COMMON_H
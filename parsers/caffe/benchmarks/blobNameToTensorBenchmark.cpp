@@ -0,0 +1,260 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Times BlobNameToTensor against the std::map it replaced, on the blob names of an unrolled multi-layer LSTM. The
+// parse loop looks up the bottoms of every layer and binds its tops, in-place Dropout layers alias their top to their
+// bottom, and setTensorNames() names every tensor at the end.
+//
+// Usage: blobNameToTensorBenchmark [timesteps] [layers]
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "benchmarkCommon.h"
+#include "blobNameToTensor.h"
+
+using namespace nvinfer1;
+using namespace nvcaffeparser1;
+
+namespace
+{
+constexpr int kRuns = 5;
+
+// Only keeps its name, so that naming costs the tables nothing but the call
+class NamedTensor : public ITensor
+{
+public:
+    void setName(const char* name) override
+    {
+        mName = name;
+    }
+    const char* getName() const override
+    {
+        return mName;
+    }
+    void setDimensions(Dims) override {}
+    Dims getDimensions() const override
+    {
+        return Dims{};
+    }
+    void setType(DataType) override {}
+    DataType getType() const override
+    {
+        return DataType::kFLOAT;
+    }
+    bool setDynamicRange(float, float) override
+    {
+        return false;
+    }
+    float getDynamicRange() const override
+    {
+        return 0.F;
+    }
+    bool isNetworkInput() const override
+    {
+        return false;
+    }
+    bool isNetworkOutput() const override
+    {
+        return false;
+    }
+    void setBroadcastAcrossBatch(bool) override {}
+    bool getBroadcastAcrossBatch() const override
+    {
+        return false;
+    }
+    TensorLocation getLocation() const override
+    {
+        return TensorLocation::kDEVICE;
+    }
+    void setLocation(TensorLocation) override {}
+    bool dynamicRangeIsSet() const override
+    {
+        return false;
+    }
+    void resetDynamicRange() override {}
+    float getDynamicRangeMin() const override
+    {
+        return 0.F;
+    }
+    float getDynamicRangeMax() const override
+    {
+        return 0.F;
+    }
+    void setAllowedFormats(TensorFormats) override {}
+    TensorFormats getAllowedFormats() const override
+    {
+        return 0U;
+    }
+    bool isShapeTensor() const override
+    {
+        return false;
+    }
+    bool isExecutionTensor() const override
+    {
+        return true;
+    }
+
+private:
+    const char* mName{nullptr};
+};
+
+// The std::map based BlobNameToTensor that the parser used before
+class MapBlobNameToTensor
+{
+public:
+    ITensor* find(const char* name) const
+    {
+        auto p = mMap.find(name);
+        return p == mMap.end() ? nullptr : p->second;
+    }
+
+    ITensor*& operator[](const std::string& name)
+    {
+        return mMap[name];
+    }
+
+    void setTensorNames()
+    {
+        for (auto& p : mMap)
+        {
+            p.second->setName(p.first.c_str());
+        }
+    }
+
+private:
+    std::map<std::string, ITensor*> mMap;
+};
+
+struct Layer
+{
+    std::vector<std::string> bottoms;
+    std::vector<std::string> tops;
+    bool inPlace; // The top is an alias of the bottom, as for Dropout
+};
+
+struct Network
+{
+    std::vector<std::string> inputs;
+    std::vector<Layer> layers;
+    std::vector<std::string> outputs;
+    int nbBlobs{0};
+};
+
+std::string blobName(const char* kind, int layer, int timestep)
+{
+    return "lstm" + std::to_string(layer) + "_" + kind + "_t" + std::to_string(timestep);
+}
+
+// Each step of each layer reads the input and the previous h and c, writes the new h and c, and drops out h in place
+Network makeUnrolledLstm(int nbTimesteps, int nbLayers)
+{
+    Network network;
+    for (int l = 0; l < nbLayers; ++l)
+    {
+        network.inputs.push_back(blobName("h", l, -1));
+        network.inputs.push_back(blobName("c", l, -1));
+    }
+    for (int t = 0; t < nbTimesteps; ++t)
+    {
+        network.inputs.push_back("x_t" + std::to_string(t));
+        for (int l = 0; l < nbLayers; ++l)
+        {
+            const std::string input = l == 0 ? network.inputs.back() : blobName("hd", l - 1, t);
+            network.layers.push_back(Layer{{input, blobName("h", l, t - 1), blobName("c", l, t - 1)},
+                {blobName("h", l, t), blobName("c", l, t)}, false});
+            network.layers.push_back(Layer{{blobName("h", l, t)}, {blobName("hd", l, t)}, true});
+        }
+        network.outputs.push_back(blobName("hd", nbLayers - 1, t));
+    }
+    network.nbBlobs = static_cast<int>(network.inputs.size() + 3 * network.layers.size() / 2);
+    return network;
+}
+
+struct Timings
+{
+    double parseMs;
+    double setNamesMs;
+};
+
+template <typename Table>
+Timings run(const Network& network, std::vector<NamedTensor>& tensors)
+{
+    Timings best{0, 0};
+    for (int r = 0; r < kRuns; ++r)
+    {
+        Table table;
+        size_t found = 0;
+        const double parseMs = benchmark::timeMs([&]() {
+            size_t next = 0;
+            for (const auto& input : network.inputs)
+            {
+                table[input] = &tensors[next++];
+            }
+            for (const auto& layer : network.layers)
+            {
+                for (const auto& bottom : layer.bottoms)
+                {
+                    found += table[bottom] != nullptr;
+                }
+                for (const auto& top : layer.tops)
+                {
+                    table[top] = layer.inPlace ? table[layer.bottoms[0]] : &tensors[next++];
+                }
+            }
+            for (const auto& output : network.outputs)
+            {
+                found += table.find(output.c_str()) != nullptr;
+            }
+        });
+        const double setNamesMs = benchmark::timeMs([&]() { table.setTensorNames(); });
+        if (found != 2 * network.layers.size() + network.outputs.size())
+        {
+            fprintf(stderr, "Blob lookup failed\n");
+            std::exit(EXIT_FAILURE);
+        }
+        best.parseMs = r == 0 ? parseMs : std::min(best.parseMs, parseMs);
+        best.setNamesMs = r == 0 ? setNamesMs : std::min(best.setNamesMs, setNamesMs);
+    }
+    return best;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const int nbTimesteps = argc > 1 ? std::atoi(argv[1]) : 2000;
+    const int nbLayers = argc > 2 ? std::atoi(argv[2]) : 8;
+    if (nbTimesteps <= 0 || nbLayers <= 0)
+    {
+        fprintf(stderr, "Usage: %s [timesteps] [layers]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const Network network = makeUnrolledLstm(nbTimesteps, nbLayers);
+    std::vector<NamedTensor> tensors(network.nbBlobs);
+    printf("%d timesteps x %d layers: %d blobs, %zu layers\n", nbTimesteps, nbLayers, network.nbBlobs,
+        network.layers.size());
+    printf("%-20s %12s %18s\n", "table", "parse ms", "setTensorNames ms");
+    const Timings map = run<MapBlobNameToTensor>(network, tensors);
+    printf("%-20s %12.2f %18.2f\n", "std::map", map.parseMs, map.setNamesMs);
+    const Timings flat = run<BlobNameToTensor>(network, tensors);
+    printf("%-20s %12.2f %18.2f\n", "BlobNameToTensor", flat.parseMs, flat.setNamesMs);
+    return EXIT_SUCCESS;
+}
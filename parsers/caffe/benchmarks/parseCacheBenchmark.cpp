@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Times the startup of a parser, from createCaffeParser() to the end of parse(), on a model with large weights that
+// are converted to half. It compares a parser without a parse cache with a cold cache, which misses and writes the
+// entry, and a warm cache, which maps the entry written by the cold run.
+//
+// Usage: parseCacheBenchmark [cache directory] [layers] [width]
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "NvCaffeParser.h"
+#include "NvInfer.h"
+#include "benchmarkCommon.h"
+#include "syntheticModel.h"
+
+using namespace nvinfer1;
+using namespace nvcaffeparser1;
+
+namespace
+{
+constexpr int kRuns = 3;
+constexpr char kDeploy[] = "parseCache.prototxt";
+constexpr char kModel[] = "parseCache.caffemodel";
+
+// Removes the entries of the parse cache so that the next parse misses
+void clearCache(const std::string& directory)
+{
+    DIR* dir = opendir(directory.c_str());
+    if (!dir)
+    {
+        return;
+    }
+    constexpr char kSuffix[] = ".caffeweights";
+    const size_t suffixLength = sizeof(kSuffix) - 1;
+    while (const dirent* entry = readdir(dir))
+    {
+        const std::string name = entry->d_name;
+        if (name.size() > suffixLength && name.compare(name.size() - suffixLength, suffixLength, kSuffix) == 0)
+        {
+            std::remove((directory + "/" + name).c_str());
+        }
+    }
+    closedir(dir);
+}
+
+struct Startup
+{
+    double ms;
+    int64_t hits;
+    int64_t misses;
+};
+
+// Best of kRuns startups. clear is called before each run.
+template <typename Clear>
+Startup timeStartup(IBuilder& builder, const std::string& cacheDirectory, Clear clear)
+{
+    Startup best{0, 0, 0};
+    for (int r = 0; r < kRuns; ++r)
+    {
+        clear();
+        INetworkDefinition* network = builder.createNetworkV2(0U);
+        ICaffeParser* parser{nullptr};
+        bool ok = false;
+        const double ms = benchmark::timeMs([&]() {
+            parser = createCaffeParser();
+            parser->setParseCacheDirectory(cacheDirectory.empty() ? nullptr : cacheDirectory.c_str());
+            ok = parser->parse(kDeploy, kModel, *network, DataType::kHALF) != nullptr;
+        });
+        if (!ok)
+        {
+            fprintf(stderr, "Cannot parse %s\n", kModel);
+            std::exit(EXIT_FAILURE);
+        }
+        if (r == 0 || ms < best.ms)
+        {
+            best = Startup{ms, parser->getParseCacheHits(), parser->getParseCacheMisses()};
+        }
+        parser->destroy();
+        network->destroy();
+    }
+    return best;
+}
+
+void report(const char* name, const Startup& startup)
+{
+    printf("%-10s %12.1f %6lld %8lld\n", name, startup.ms, static_cast<long long>(startup.hits),
+        static_cast<long long>(startup.misses));
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const std::string cacheDirectory = argc > 1 ? argv[1] : "parseCache";
+    const int nbLayers = argc > 2 ? std::atoi(argv[2]) : 16;
+    const int width = argc > 3 ? std::atoi(argv[3]) : 2048;
+    if (nbLayers <= 0 || width <= 0)
+    {
+        fprintf(stderr, "Usage: %s [cache directory] [layers] [width]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    mkdir(cacheDirectory.c_str(), 0777);
+
+    benchmark::Logger logger;
+    IBuilder* builder = createInferBuilder(logger);
+    if (!builder || !benchmark::writeInnerProductChain(kDeploy, kModel, nbLayers, width))
+    {
+        fprintf(stderr, "Cannot create the builder or write %s\n", kModel);
+        return EXIT_FAILURE;
+    }
+
+    printf("%d InnerProduct layers of width %d, %.0f MiB of FP32 weights, parsed to FP16\n", nbLayers, width,
+        static_cast<double>(nbLayers) * (width + 1) * width * sizeof(float) / (1 << 20));
+    printf("%-10s %12s %6s %8s\n", "startup", "ms", "hits", "misses");
+    report("uncached", timeStartup(*builder, "", []() {}));
+    report("cold", timeStartup(*builder, cacheDirectory, [&]() { clearCache(cacheDirectory); }));
+    report("warm", timeStartup(*builder, cacheDirectory, []() {}));
+
+    clearCache(cacheDirectory);
+    std::remove(kDeploy);
+    std::remove(kModel);
+    builder->destroy();
+    shutdownProtobufLibrary();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Times ICaffeParser::parse() on chains of InnerProduct layers of increasing depth. Parse time should grow linearly
+// with the depth, so the time per layer should stay flat.
+//
+// Usage: parseTimeBenchmark [depth...]
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "NvCaffeParser.h"
+#include "NvInfer.h"
+#include "benchmarkCommon.h"
+#include "syntheticModel.h"
+
+using namespace nvinfer1;
+using namespace nvcaffeparser1;
+
+namespace
+{
+constexpr int kWidth = 16;
+constexpr int kRuns = 5;
+} // namespace
+
+int main(int argc, char** argv)
+{
+    std::vector<int> depths{250, 500, 1000, 2000, 4000, 8000};
+    if (argc > 1)
+    {
+        depths.clear();
+        for (int i = 1; i < argc; ++i)
+        {
+            depths.push_back(std::atoi(argv[i]));
+        }
+    }
+
+    benchmark::Logger logger;
+    IBuilder* builder = createInferBuilder(logger);
+    if (!builder)
+    {
+        return EXIT_FAILURE;
+    }
+
+    printf("%8s %12s %12s\n", "layers", "parse ms", "us/layer");
+    bool ok = true;
+    for (const int depth : depths)
+    {
+        const std::string deploy = "parseTime" + std::to_string(depth) + ".prototxt";
+        const std::string model = "parseTime" + std::to_string(depth) + ".caffemodel";
+        if (!benchmark::writeInnerProductChain(deploy, model, depth, kWidth))
+        {
+            fprintf(stderr, "Cannot write %s\n", model.c_str());
+            ok = false;
+            break;
+        }
+
+        // Best of kRuns, each with a fresh parser and network
+        double best = 0;
+        for (int r = 0; r < kRuns && ok; ++r)
+        {
+            INetworkDefinition* network = builder->createNetworkV2(0U);
+            ICaffeParser* parser = createCaffeParser();
+            const double ms = benchmark::timeMs(
+                [&]() { ok = parser->parse(deploy.c_str(), model.c_str(), *network, DataType::kFLOAT) != nullptr; });
+            best = r == 0 ? ms : std::min(best, ms);
+            parser->destroy();
+            network->destroy();
+        }
+        std::remove(deploy.c_str());
+        std::remove(model.c_str());
+        if (!ok)
+        {
+            fprintf(stderr, "Cannot parse the network of %d layers\n", depth);
+            break;
+        }
+        printf("%8d %12.2f %12.2f\n", depth, best, 1000.0 * best / depth);
+    }
+
+    builder->destroy();
+    shutdownProtobufLibrary();
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <fstream>
+#include <random>
+
+#include "syntheticModel.h"
+#include "trtcaffe.pb.h"
+
+namespace nvcaffeparser1
+{
+namespace benchmark
+{
+namespace
+{
+void addBlob(trtcaffe::LayerParameter& layer, int rows, int columns, std::mt19937& random)
+{
+    std::uniform_real_distribution<float> uniform(-1.F, 1.F);
+    trtcaffe::BlobProto* blob = layer.add_blobs();
+    if (rows > 1)
+    {
+        blob->mutable_shape()->add_dim(rows);
+    }
+    blob->mutable_shape()->add_dim(columns);
+    for (int i = 0; i < rows * columns; ++i)
+    {
+        blob->add_data(uniform(random));
+    }
+}
+} // namespace
+
+bool writeInnerProductChain(const std::string& deployPath, const std::string& modelPath, int nbLayers, int width)
+{
+    std::ofstream deploy(deployPath);
+    deploy << "name: \"chain\"" << std::endl
+           << "input: \"data\"" << std::endl
+           << "input_shape { dim: 1 dim: " << width << " dim: 1 dim: 1 }" << std::endl;
+
+    trtcaffe::NetParameter model;
+    model.set_name("chain");
+    std::mt19937 random(1);
+    std::string bottom = "data";
+    for (int l = 0; l < nbLayers; ++l)
+    {
+        const std::string name = "fc" + std::to_string(l);
+        deploy << "layer { name: \"" << name << "\" type: \"InnerProduct\" bottom: \"" << bottom << "\" top: \""
+               << name << "\" inner_product_param { num_output: " << width << " } }" << std::endl;
+
+        trtcaffe::LayerParameter* layer = model.add_layer();
+        layer->set_name(name);
+        layer->set_type("InnerProduct");
+        addBlob(*layer, width, width, random);
+        addBlob(*layer, 1, width, random);
+        bottom = name;
+    }
+
+    std::ofstream modelFile(modelPath, std::ios::binary);
+    return deploy.good() && model.SerializeToOstream(&modelFile) && modelFile.good();
+}
+} // namespace benchmark
+} // namespace nvcaffeparser1
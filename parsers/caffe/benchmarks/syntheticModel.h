@@ -0,0 +1,31 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TRT_CAFFE_PARSER_SYNTHETIC_MODEL_H
+#define TRT_CAFFE_PARSER_SYNTHETIC_MODEL_H
+
+#include <string>
+
+namespace nvcaffeparser1
+{
+namespace benchmark
+{
+// Writes a deploy prototxt and a binaryproto model for a chain of nbLayers InnerProduct layers, each with width
+// outputs, applied to a width x 1 x 1 input. The weights are pseudo-random and the same on every call.
+bool writeInnerProductChain(const std::string& deployPath, const std::string& modelPath, int nbLayers, int width);
+} // namespace benchmark
+} // namespace nvcaffeparser1
+#endif // TRT_CAFFE_PARSER_SYNTHETIC_MODEL_H
@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Times the fused weight conversions of weightConversion.h against the scalar loops they replaced: a NaN scan
+// followed by an element by element conversion with a range check.
+//
+// Usage: weightConversionBenchmark [millions of elements]
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "benchmarkCommon.h"
+#include "weightConversion.h"
+
+using namespace nvcaffeparser1;
+
+namespace
+{
+constexpr int kRuns = 5;
+
+bool scalarCheck(const float* src, int64_t count)
+{
+    for (int64_t i = 0; i < count; ++i)
+    {
+        if (std::isnan(src[i]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename Src, typename Dst>
+bool scalarConvert(const Src* src, Dst* dst, int64_t count)
+{
+    bool ok = true;
+    for (int64_t i = 0; i < count; ++i)
+    {
+        if (std::isnan(float(src[i])))
+        {
+            ok = false;
+            break;
+        }
+    }
+    for (int64_t i = 0; i < count; ++i)
+    {
+        const Dst value = static_cast<Dst>(src[i]);
+        if (value > std::numeric_limits<Dst>::max() || value < std::numeric_limits<Dst>::lowest())
+        {
+            ok = false;
+        }
+        dst[i] = value;
+    }
+    return ok;
+}
+
+// Best of kRuns calls to fn, in milliseconds. fn returns whether the weights were valid, which must be true.
+template <typename Fn>
+double bestOfMs(Fn fn)
+{
+    double best = 0;
+    for (int r = 0; r < kRuns; ++r)
+    {
+        bool ok = false;
+        const double ms = benchmark::timeMs([&]() { ok = fn(); });
+        if (!ok)
+        {
+            fprintf(stderr, "Conversion reported invalid weights\n");
+            std::exit(EXIT_FAILURE);
+        }
+        best = r == 0 ? ms : std::min(best, ms);
+    }
+    return best;
+}
+
+void report(const char* name, double scalarMs, double fusedMs)
+{
+    printf("%-16s %12.2f %12.2f %8.1fx\n", name, scalarMs, fusedMs, scalarMs / fusedMs);
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const int64_t count = (argc > 1 ? std::atoll(argv[1]) : 64) << 20;
+    if (count <= 0)
+    {
+        fprintf(stderr, "Usage: %s [millions of elements]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> uniform(-1.F, 1.F);
+    std::vector<float> floats(count);
+    std::generate(floats.begin(), floats.end(), [&]() { return uniform(random); });
+    const std::vector<double> doubles(floats.begin(), floats.end());
+    std::vector<float16> halves(count);
+    std::vector<float> floatsOut(count);
+    convertWeights(floats.data(), halves.data(), count);
+
+    printf("%lld elements, %u hardware threads\n", static_cast<long long>(count), std::thread::hardware_concurrency());
+    printf("%-16s %12s %12s %9s\n", "conversion", "scalar ms", "fused ms", "speedup");
+    std::vector<float16> halvesOut(count);
+    report("FLOAT->HALF", bestOfMs([&]() { return scalarConvert(floats.data(), halvesOut.data(), count); }),
+        bestOfMs([&]() { return convertWeights(floats.data(), halvesOut.data(), count).inRange(); }));
+    report("HALF->FLOAT", bestOfMs([&]() { return scalarConvert(halves.data(), floatsOut.data(), count); }),
+        bestOfMs([&]() { return convertWeights(halves.data(), floatsOut.data(), count).inRange(); }));
+    report("DOUBLE->FLOAT", bestOfMs([&]() { return scalarConvert(doubles.data(), floatsOut.data(), count); }),
+        bestOfMs([&]() { return convertWeights(doubles.data(), floatsOut.data(), count).inRange(); }));
+    report("DOUBLE->HALF", bestOfMs([&]() { return scalarConvert(doubles.data(), halvesOut.data(), count); }),
+        bestOfMs([&]() { return convertWeights(doubles.data(), halvesOut.data(), count).inRange(); }));
+    report("FLOAT NaN check", bestOfMs([&]() { return scalarCheck(floats.data(), count); }),
+        bestOfMs([&]() { return !checkWeights(floats.data(), count).foundNan; }));
+    return EXIT_SUCCESS;
+}
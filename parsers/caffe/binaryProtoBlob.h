@@ -16,10 +16,12 @@
 
 #ifndef TRT_CAFFE_PARSER_BINARY_PROTO_BLOB_H
 #define TRT_CAFFE_PARSER_BINARY_PROTO_BLOB_H
+#include <memory>
 #include <stdlib.h>
 
 #include "NvCaffeParser.h"
 #include "NvInfer.h"
+#include "mappedFile.h"
 
 namespace nvcaffeparser1
 {
@@ -28,6 +30,16 @@ class BinaryProtoBlob : public IBinaryProtoBlob
 public:
     BinaryProtoBlob(void* memory, nvinfer1::DataType type, nvinfer1::DimsNCHW dimensions)
         : mMemory(memory)
+        , mData(memory)
+        , mDataType(type)
+        , mDimensions(dimensions)
+    {
+    }
+
+    // The data is left in the mapped file, which the blob keeps open
+    BinaryProtoBlob(std::unique_ptr<MappedFile> file, const void* data, nvinfer1::DataType type, nvinfer1::DimsNCHW dimensions)
+        : mFile(std::move(file))
+        , mData(data)
         , mDataType(type)
         , mDimensions(dimensions)
     {
@@ -45,7 +57,7 @@ public:
 
     const void* getData() override
     {
-        return mMemory;
+        return mData;
     }
 
     void destroy() override
@@ -58,7 +70,9 @@ public:
         free(mMemory);
     }
 
-    void* mMemory;
+    std::unique_ptr<MappedFile> mFile;
+    void* mMemory{nullptr};
+    const void* mData;
     nvinfer1::DataType mDataType;
     nvinfer1::DimsNCHW mDimensions;
 };
@@ -17,42 +17,56 @@
 #ifndef TRT_CAFFE_PARSER_BLOB_NAME_TO_TENSOR_H
 #define TRT_CAFFE_PARSER_BLOB_NAME_TO_TENSOR_H
 
-#include <map>
+#include <cstdint>
+#include <cstring>
+#include <deque>
 #include <string>
+#include <vector>
 
 #include "NvCaffeParser.h"
 #include "NvInfer.h"
 
 namespace nvcaffeparser1
 {
+// Blob names are interned: each distinct name is stored once, in insertion order, and its index is its ID. Lookups
+// go through an open-addressing table of IDs with linear probing, which keeps the table flat and compares strings
+// only when the full hashes match. Entries live in a deque so that the references returned by operator[] stay valid
+// while other names are added.
 class BlobNameToTensor : public IBlobNameToTensor
 {
 public:
     void add(const std::string& name, nvinfer1::ITensor* tensor)
     {
-        mMap[name] = tensor;
+        (*this)[name] = tensor;
     }
 
     nvinfer1::ITensor* find(const char* name) const override
     {
-        auto p = mMap.find(name);
-        if (p == mMap.end())
-        {
-            return nullptr;
-        }
-        return p->second;
+        const uint32_t id = lookup(name, strlen(name), hashName(name, strlen(name)));
+        return id == kEmpty ? nullptr : mEntries[id].tensor;
     }
 
     nvinfer1::ITensor*& operator[](const std::string& name)
     {
-        return mMap[name];
+        const uint64_t hash = hashName(name.data(), name.size());
+        uint32_t id = lookup(name.data(), name.size(), hash);
+        if (id == kEmpty)
+        {
+            id = insert(name, hash);
+        }
+        return mEntries[id].tensor;
     }
 
+    // Names are set in insertion order, so when several blobs map to the same tensor the most recently added name
+    // wins
     void setTensorNames()
     {
-        for (auto& p : mMap)
+        for (auto& entry : mEntries)
         {
-            p.second->setName(p.first.c_str());
+            if (entry.tensor)
+            {
+                entry.tensor->setName(entry.name.c_str());
+            }
         }
     }
 
@@ -64,7 +78,95 @@ public:
     }
 
 private:
-    std::map<std::string, nvinfer1::ITensor*> mMap;
+    static constexpr uint32_t kEmpty = UINT32_MAX;
+
+    struct Entry
+    {
+        std::string name;
+        nvinfer1::ITensor* tensor;
+    };
+
+    struct Slot
+    {
+        uint64_t hash;
+        uint32_t id;
+    };
+
+    // 64-bit FNV-1a
+    static uint64_t hashName(const char* name, size_t length)
+    {
+        uint64_t hash = 14695981039346656037ULL;
+        for (size_t i = 0; i < length; ++i)
+        {
+            hash = (hash ^ static_cast<uint8_t>(name[i])) * 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    uint32_t lookup(const char* name, size_t length, uint64_t hash) const
+    {
+        if (mSlots.empty())
+        {
+            return kEmpty;
+        }
+        const size_t mask = mSlots.size() - 1;
+        for (size_t i = hash & mask;; i = (i + 1) & mask)
+        {
+            const Slot& slot = mSlots[i];
+            if (slot.id == kEmpty)
+            {
+                return kEmpty;
+            }
+            if (slot.hash == hash)
+            {
+                const std::string& candidate = mEntries[slot.id].name;
+                if (candidate.size() == length && memcmp(candidate.data(), name, length) == 0)
+                {
+                    return slot.id;
+                }
+            }
+        }
+    }
+
+    uint32_t insert(const std::string& name, uint64_t hash)
+    {
+        // Keep the load factor at most 1/2
+        if (2 * (mEntries.size() + 1) > mSlots.size())
+        {
+            rehash(mSlots.empty() ? 64 : 2 * mSlots.size());
+        }
+        const uint32_t id = static_cast<uint32_t>(mEntries.size());
+        mEntries.push_back(Entry{name, nullptr});
+        place(Slot{hash, id});
+        return id;
+    }
+
+    void rehash(size_t capacity)
+    {
+        std::vector<Slot> old(capacity, Slot{0, kEmpty});
+        old.swap(mSlots);
+        for (const Slot& slot : old)
+        {
+            if (slot.id != kEmpty)
+            {
+                place(slot);
+            }
+        }
+    }
+
+    void place(const Slot& slot)
+    {
+        const size_t mask = mSlots.size() - 1;
+        size_t i = slot.hash & mask;
+        while (mSlots[i].id != kEmpty)
+        {
+            i = (i + 1) & mask;
+        }
+        mSlots[i] = slot;
+    }
+
+    std::deque<Entry> mEntries;
+    std::vector<Slot> mSlots;
     bool mError{false};
 };
 } // namespace nvcaffeparser1
@@ -14,7 +14,10 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+#include <atomic>
 #include <iostream>
+#include <thread>
 
 #include "caffeMacros.h"
 #include "caffeParser.h"
@@ -24,6 +27,7 @@
 #include "binaryProtoBlob.h"
 #include "google/protobuf/text_format.h"
 #include "half.h"
+#include "weightConversion.h"
 #include "NvInferPluginUtils.h"
 
 using namespace nvinfer1;
@@ -31,9 +35,13 @@ using namespace nvcaffeparser1;
 
 CaffeParser::~CaffeParser()
 {
-    for (auto v : mTmpAllocs)
+    for (auto p : mJobParsers)
     {
-        free(v);
+        p->destroy();
+    }
+    for (auto p : mIdleJobParsers)
+    {
+        p->destroy();
     }
     for (auto p : mNewPlugins)
     {
@@ -42,9 +50,192 @@ CaffeParser::~CaffeParser()
             p->destroy();
         }
     }
+    for (auto b : mOldBlobNameToTensors)
+    {
+        delete b;
+    }
     delete mBlobNameToTensor;
 }
 
+void CaffeParser::resetWeightMemory()
+{
+    mWeightArena.reset();
+    for (auto b : mOldBlobNameToTensors)
+    {
+        delete b;
+    }
+    mOldBlobNameToTensors.clear();
+    for (auto p : mJobParsers)
+    {
+        p->resetWeightMemory();
+        p->releaseModel();
+        mIdleJobParsers.push_back(p);
+    }
+    mJobParsers.clear();
+}
+
+void CaffeParser::releaseModel()
+{
+    mWeightCache.reset();
+    mDeploy.reset();
+    mModel.reset();
+    mRawDataAliases.clear();
+    mModelFile.reset();
+    mStreamingModel.reset();
+}
+
+void CaffeParser::updatePluginCreators()
+{
+    // Get list of all available plugin creators
+    int numCreators = 0;
+    nvinfer1::IPluginCreator* const* tmpList = getPluginRegistry()->getPluginCreatorList(&numCreators);
+    if (mPluginCreators && numCreators == mNbPluginCreators)
+    {
+        return;
+    }
+
+    std::shared_ptr<PluginCreatorTable> creators = std::make_shared<PluginCreatorTable>();
+    for (int k = 0; k < numCreators; ++k)
+    {
+        if (!tmpList[k])
+        {
+            std::cout << "Plugin Creator for plugin " << k << " is a nullptr." << std::endl;
+            continue;
+        }
+        std::string pluginName = tmpList[k]->getPluginName();
+        (*creators)[pluginName] = tmpList[k];
+    }
+    mPluginCreators = creators;
+    mNbPluginCreators = numCreators;
+}
+
+void CaffeParser::configureJobParser(CaffeParser& job) const
+{
+    job.mIsJobParser = true;
+    job.mProtobufBufferSize = mProtobufBufferSize;
+    job.mPluginFactory = mPluginFactory;
+    job.mPluginFactoryV2 = mPluginFactoryV2;
+    job.mPluginFactoryIsExt = mPluginFactoryIsExt;
+    job.mPluginNamespace = mPluginNamespace;
+    job.mStreamingParse = mStreamingParse;
+    job.mParseCacheDirectory = mParseCacheDirectory;
+    job.mPluginCreators = mPluginCreators;
+    job.mNbPluginCreators = mNbPluginCreators;
+    job.mPluginMutex = mPluginMutex;
+}
+
+int64_t CaffeParser::getParseCacheHits() const
+{
+    int64_t hits = mParseCacheHits;
+    for (auto p : mJobParsers)
+    {
+        hits += p->getParseCacheHits();
+    }
+    for (auto p : mIdleJobParsers)
+    {
+        hits += p->getParseCacheHits();
+    }
+    return hits;
+}
+
+int64_t CaffeParser::getParseCacheMisses() const
+{
+    int64_t misses = mParseCacheMisses;
+    for (auto p : mJobParsers)
+    {
+        misses += p->getParseCacheMisses();
+    }
+    for (auto p : mIdleJobParsers)
+    {
+        misses += p->getParseCacheMisses();
+    }
+    return misses;
+}
+
+// Looks the model up in the parse cache, and returns true on a hit, in which case the model need not be read. On a
+// miss, the cache records the weights of this parse instead.
+bool CaffeParser::openWeightCache(const void* deploy, size_t deploySize, const void* model, size_t modelSize,
+    DataType weightType)
+{
+    const WeightCacheKey key = makeWeightCacheKey(deploy, deploySize, model, modelSize, weightType);
+    mWeightCachePath = mParseCacheDirectory + "/" + WeightCache::getFileName(key);
+    mWeightCache.reset(new WeightCache);
+    if (mWeightCache->load(mWeightCachePath, key))
+    {
+        ++mParseCacheHits;
+        return true;
+    }
+    ++mParseCacheMisses;
+    mWeightCache->record(key);
+    return false;
+}
+
+bool CaffeParser::parseBatch(CaffeParseJob* jobs, int32_t nbJobs, int32_t nbThreads)
+{
+    if (nbJobs <= 0)
+    {
+        return true;
+    }
+    CHECK_NULL_RET_VAL(jobs, false)
+    updatePluginCreators();
+
+    // Each job gets a parser of its own, so that the per-model state (blob map, weight memory, new plugins and the
+    // decoded model) is never shared between threads
+    const size_t firstJobParser = mJobParsers.size();
+    for (int32_t i = 0; i < nbJobs; ++i)
+    {
+        CaffeParser* job{nullptr};
+        if (mIdleJobParsers.empty())
+        {
+            job = new CaffeParser;
+        }
+        else
+        {
+            job = mIdleJobParsers.back();
+            mIdleJobParsers.pop_back();
+        }
+        configureJobParser(*job);
+        mJobParsers.push_back(job);
+        jobs[i].result = nullptr;
+    }
+
+    if (nbThreads <= 0)
+    {
+        nbThreads = static_cast<int32_t>(std::thread::hardware_concurrency());
+    }
+    nbThreads = std::max(1, std::min(nbThreads, nbJobs));
+
+    std::atomic<int32_t> nextJob{0};
+    auto worker = [&]() {
+        // The jobs already keep every thread busy, so weight conversion within a job stays on its thread
+        const SerialConversionScope serialConversion(nbThreads > 1);
+        for (int32_t i = nextJob++; i < nbJobs; i = nextJob++)
+        {
+            CaffeParseJob& job = jobs[i];
+            if (!job.deploy || !job.network)
+            {
+                std::cout << "parseBatch: job " << i << " has no deploy file or network" << std::endl;
+                continue;
+            }
+            job.result = mJobParsers[firstJobParser + i]->parse(job.deploy, job.model, *job.network, job.weightType);
+        }
+    };
+
+    // The calling thread is one of the workers
+    std::vector<std::thread> threads;
+    for (int32_t t = 1; t < nbThreads; ++t)
+    {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    return std::all_of(jobs, jobs + nbJobs, [](const CaffeParseJob& job) { return job.result != nullptr; });
+}
+
 std::vector<nvinfer1::PluginField> CaffeParser::parseNormalizeParam(const trtcaffe::LayerParameter& msg, CaffeWeightFactory& weightFactory, BlobNameToTensor& tensors)
 {
     std::vector<nvinfer1::PluginField> f;
@@ -308,6 +499,101 @@ std::vector<nvinfer1::PluginField> CaffeParser::parseRPROIParam(const trtcaffe::
     return f;
 }
 
+std::vector<CaffeParser::LayerHandler> CaffeParser::resolveLayerHandlers()
+{
+    // Caffe layer types that are built from plugin creators in the registry
+    static const struct
+    {
+        const char* layerType;
+        const char* pluginName;
+        PluginParamParseFn parseParams;
+    } kCreatorPlugins[] = {
+        {"Normalize", "Normalize_TRT", &CaffeParser::parseNormalizeParam},
+        {"PriorBox", "PriorBox_TRT", &CaffeParser::parsePriorBoxParam},
+        {"DetectionOutput", "NMS_TRT", &CaffeParser::parseDetectionOutputParam},
+        {"RPROI", "RPROI_TRT", &CaffeParser::parseRPROIParam},
+    };
+    const bool hasPluginV2 = getInferLibVersion() >= 5000;
+
+    auto resolveType = [&](const std::string& type) {
+        LayerHandler handler;
+        if (hasPluginV2)
+        {
+            for (const auto& plugin : kCreatorPlugins)
+            {
+                if (type == plugin.layerType)
+                {
+                    auto creator = mPluginCreators->find(plugin.pluginName);
+                    if (creator != mPluginCreators->end())
+                    {
+                        handler.kind = LayerKind::kCREATOR_PLUGIN;
+                        handler.creator = creator->second;
+                        handler.parseParams = plugin.parseParams;
+                        return handler;
+                    }
+                    break;
+                }
+            }
+        }
+
+        if (type == "Dropout")
+        {
+            handler.kind = LayerKind::kDROPOUT;
+        }
+        else if (type == "Input")
+        {
+            handler.kind = LayerKind::kINPUT;
+        }
+        else if (type == "Flatten")
+        {
+            handler.kind = LayerKind::kFLATTEN;
+        }
+        else
+        {
+            auto v = gParseTable.find(type);
+            if (v != gParseTable.end())
+            {
+                handler.kind = LayerKind::kBUILTIN;
+                handler.parse = v->second;
+            }
+        }
+        return handler;
+    };
+
+    // Each layer type is resolved once. Factory plugins are matched by layer name, so they are resolved per layer,
+    // with the factories queried for the whole network under a single lock.
+    std::unordered_map<std::string, LayerHandler> typeHandlers;
+    std::vector<LayerHandler> handlers(mDeploy->layer_size());
+    std::lock_guard<std::mutex> pluginLock(*mPluginMutex);
+    for (int i = 0; i < mDeploy->layer_size(); i++)
+    {
+        const trtcaffe::LayerParameter& layerMsg = mDeploy->layer(i);
+        LayerHandler& handler = handlers[i];
+        if (layerMsg.has_phase() && layerMsg.phase() == trtcaffe::TEST)
+        {
+            handler.kind = LayerKind::kSKIP;
+        }
+        else if (mPluginFactory && mPluginFactory->isPlugin(layerMsg.name().c_str()))
+        {
+            handler.kind = LayerKind::kFACTORY_PLUGIN;
+        }
+        else if (hasPluginV2 && mPluginFactoryV2 && mPluginFactoryV2->isPluginV2(layerMsg.name().c_str()))
+        {
+            handler.kind = LayerKind::kFACTORY_PLUGIN_V2;
+        }
+        else
+        {
+            auto it = typeHandlers.find(layerMsg.type());
+            if (it == typeHandlers.end())
+            {
+                it = typeHandlers.emplace(layerMsg.type(), resolveType(layerMsg.type())).first;
+            }
+            handler = it->second;
+        }
+    }
+    return handlers;
+}
+
 const IBlobNameToTensor* CaffeParser::parseBuffers(const char* deployBuffer,
                                                    std::size_t deployLength,
                                                    const char* modelBuffer,
@@ -315,6 +601,10 @@ const IBlobNameToTensor* CaffeParser::parseBuffers(const char* deployBuffer,
                                                    INetworkDefinition& network,
                                                    DataType weightType)
 {
+    mRawDataAliases.clear();
+    mModelFile.reset();
+    mStreamingModel.reset();
+    mWeightCache.reset();
     mDeploy = std::unique_ptr<trtcaffe::NetParameter>(new trtcaffe::NetParameter);
     google::protobuf::io::ArrayInputStream deployStream(deployBuffer, deployLength);
     if (!google::protobuf::TextFormat::Parse(&deployStream, mDeploy.get()))
@@ -322,7 +612,13 @@ const IBlobNameToTensor* CaffeParser::parseBuffers(const char* deployBuffer,
         RETURN_AND_LOG_ERROR(nullptr, "Could not parse deploy file");
     }
 
-    if (modelBuffer)
+    const bool cacheHit = modelBuffer && !mParseCacheDirectory.empty()
+        && openWeightCache(deployBuffer, deployLength, modelBuffer, modelLength, weightType);
+    if (cacheHit)
+    {
+        mModel = std::unique_ptr<trtcaffe::NetParameter>(new trtcaffe::NetParameter);
+    }
+    else if (modelBuffer)
     {
         mModel = std::unique_ptr<trtcaffe::NetParameter>(new trtcaffe::NetParameter);
         google::protobuf::io::ArrayInputStream modelStream(modelBuffer, modelLength);
@@ -346,8 +642,38 @@ const IBlobNameToTensor* CaffeParser::parse(const char* deployFile,
     CHECK_NULL_RET_NULL(deployFile)
 
     // this is used to deal with dropout layers which have different input and output
+    mRawDataAliases.clear();
+    mStreamingModel.reset();
+    mWeightCache.reset();
     mModel = std::unique_ptr<trtcaffe::NetParameter>(new trtcaffe::NetParameter);
-    if (modelFile && !readBinaryProto(mModel.get(), modelFile, mProtobufBufferSize))
+
+    bool cacheHit{false};
+    if (modelFile && !mParseCacheDirectory.empty())
+    {
+        MappedFile deployData(deployFile);
+        MappedFile modelData(modelFile);
+        if (deployData.isOpen() && modelData.isOpen())
+        {
+            cacheHit = openWeightCache(deployData.data(), deployData.size(), modelData.data(), modelData.size(),
+                weightType);
+        }
+    }
+
+    if (cacheHit)
+    {
+        // The weights are served from the cache, so the model is not read at all
+        mModelFile.reset();
+    }
+    else if (modelFile && mStreamingParse)
+    {
+        // The layers are decoded one at a time while parsing, leaving mModel empty
+        mStreamingModel.reset(new StreamingModel);
+        if (!mStreamingModel->open(modelFile, mProtobufBufferSize))
+        {
+            RETURN_AND_LOG_ERROR(nullptr, "Could not parse model file");
+        }
+    }
+    else if (modelFile && !readBinaryProto(mModel.get(), modelFile, mProtobufBufferSize, mModelFile, mRawDataAliases))
     {
         RETURN_AND_LOG_ERROR(nullptr, "Could not parse model file");
     }
@@ -366,22 +692,20 @@ const IBlobNameToTensor* CaffeParser::parse(INetworkDefinition& network,
                                             bool hasModel)
 {
     bool ok = true;
-    CaffeWeightFactory weights(*mModel.get(), weightType, mTmpAllocs, hasModel);
+    CaffeWeightFactory weights(*mModel.get(), weightType, mWeightArena, hasModel,
+        mStreamingModel ? &mStreamingModel->getRawDataAliases() : &mRawDataAliases, mStreamingModel.get(),
+        mWeightCache.get());
 
+    if (mBlobNameToTensor)
+    {
+        mOldBlobNameToTensors.push_back(mBlobNameToTensor);
+    }
     mBlobNameToTensor = new (BlobNameToTensor);
 
-    // Get list of all available plugin creators
-    int numCreators = 0;
-    nvinfer1::IPluginCreator* const* tmpList = getPluginRegistry()->getPluginCreatorList(&numCreators);
-    for (int k = 0; k < numCreators; ++k)
+    // Job parsers share the table of the parser that created them
+    if (!mIsJobParser)
     {
-        if (!tmpList[k])
-        {
-            std::cout << "Plugin Creator for plugin " << k << " is a nullptr." << std::endl;
-            continue;
-        }
-        std::string pluginName = tmpList[k]->getPluginName();
-        mPluginRegistry[pluginName] = tmpList[k];
+        updatePluginCreators();
     }
 
     for (int i = 0; i < mDeploy->input_size(); i++)
@@ -416,10 +740,14 @@ const IBlobNameToTensor* CaffeParser::parse(INetworkDefinition& network,
         (*mBlobNameToTensor)[mDeploy->input().Get(i)] = tensor;
     }
 
+    // How each layer is added is resolved before the loop, so the loop does no matching on layer types or names
+    const std::vector<LayerHandler> handlers = resolveLayerHandlers();
+
     for (int i = 0; i < mDeploy->layer_size() && ok; i++)
     {
         const trtcaffe::LayerParameter& layerMsg = mDeploy->layer(i);
-        if (layerMsg.has_phase() && layerMsg.phase() == trtcaffe::TEST)
+        const LayerHandler& handler = handlers[i];
+        if (handler.kind == LayerKind::kSKIP)
         {
             continue;
         }
@@ -443,18 +771,20 @@ const IBlobNameToTensor* CaffeParser::parse(INetworkDefinition& network,
         }
 
         // If there is a pluginFactory provided, use layer name matching to handle the plugin construction
-        if (mPluginFactory && mPluginFactory->isPlugin(layerMsg.name().c_str()))
+        if (handler.kind == LayerKind::kFACTORY_PLUGIN)
         {
             std::vector<Weights> w = weights.getAllWeights(layerMsg.name());
+            std::unique_lock<std::mutex> pluginLock(*mPluginMutex);
             IPlugin* plugin = mPluginFactory->createPlugin(layerMsg.name().c_str(), w.empty() ? nullptr : &w[0], w.size());
+            bool isExt = mPluginFactoryIsExt && static_cast<IPluginFactoryExt*>(mPluginFactory)->isPluginExt(layerMsg.name().c_str());
+            pluginLock.unlock();
+
             std::vector<ITensor*> inputs;
             for (int i = 0, n = layerMsg.bottom_size(); i < n; i++)
             {
                 inputs.push_back((*mBlobNameToTensor)[layerMsg.bottom(i)]);
             }
 
-            bool isExt = mPluginFactoryIsExt && static_cast<IPluginFactoryExt*>(mPluginFactory)->isPluginExt(layerMsg.name().c_str());
-
             ILayer* layer = isExt ? network.addPluginExt(&inputs[0], int(inputs.size()), *static_cast<IPluginExt*>(plugin))
                                   : network.addPlugin(&inputs[0], int(inputs.size()), *plugin);
 
@@ -477,111 +807,89 @@ const IBlobNameToTensor* CaffeParser::parse(INetworkDefinition& network,
 
             continue;
         }
-        if (getInferLibVersion() >= 5000)
+
+        if (handler.kind == LayerKind::kFACTORY_PLUGIN_V2)
         {
-            if (mPluginFactoryV2 && mPluginFactoryV2->isPluginV2(layerMsg.name().c_str()))
+            if (mPluginFactory)
             {
-                if (mPluginFactory)
-                {
-                    RETURN_AND_LOG_ERROR(nullptr, "Both IPluginFactory and IPluginFactoryV2 are set. If using TensorRT 5.0 or later, switch to IPluginFactoryV2");
-                }
-                std::vector<Weights> w = weights.getAllWeights(layerMsg.name());
-                nvinfer1::IPluginV2* plugin = mPluginFactoryV2->createPlugin(layerMsg.name().c_str(), w.empty() ? nullptr : &w[0], w.size(), mPluginNamespace.c_str());
-                std::vector<ITensor*> inputs;
-                for (int i = 0, n = layerMsg.bottom_size(); i < n; i++)
-                {
-                    inputs.push_back((*mBlobNameToTensor)[layerMsg.bottom(i)]);
-                }
-                ILayer* layer = network.addPluginV2(&inputs[0], int(inputs.size()), *plugin);
-                layer->setName(layerMsg.name().c_str());
-                if (plugin->getNbOutputs() != layerMsg.top_size())
-                {
-                    std::cout << "Plugin layer output count is not equal to caffe output count" << std::endl;
-                    ok = false;
-                }
-                for (int i = 0, n = std::min(layer->getNbOutputs(), layerMsg.top_size()); i < n; i++)
-                {
-                    (*mBlobNameToTensor)[layerMsg.top(i)] = layer->getOutput(i);
-                }
-
-                if (layer == nullptr)
-                {
-                    std::cout << "error parsing layer type " << layerMsg.type() << " index " << i << std::endl;
-                    ok = false;
-                }
-                continue;
+                RETURN_AND_LOG_ERROR(nullptr, "Both IPluginFactory and IPluginFactoryV2 are set. If using TensorRT 5.0 or later, switch to IPluginFactoryV2");
+            }
+            std::vector<Weights> w = weights.getAllWeights(layerMsg.name());
+            std::unique_lock<std::mutex> pluginLock(*mPluginMutex);
+            nvinfer1::IPluginV2* plugin = mPluginFactoryV2->createPlugin(layerMsg.name().c_str(), w.empty() ? nullptr : &w[0], w.size(), mPluginNamespace.c_str());
+            pluginLock.unlock();
+            std::vector<ITensor*> inputs;
+            for (int i = 0, n = layerMsg.bottom_size(); i < n; i++)
+            {
+                inputs.push_back((*mBlobNameToTensor)[layerMsg.bottom(i)]);
+            }
+            ILayer* layer = network.addPluginV2(&inputs[0], int(inputs.size()), *plugin);
+            layer->setName(layerMsg.name().c_str());
+            if (plugin->getNbOutputs() != layerMsg.top_size())
+            {
+                std::cout << "Plugin layer output count is not equal to caffe output count" << std::endl;
+                ok = false;
+            }
+            for (int i = 0, n = std::min(layer->getNbOutputs(), layerMsg.top_size()); i < n; i++)
+            {
+                (*mBlobNameToTensor)[layerMsg.top(i)] = layer->getOutput(i);
             }
-            // Use the TRT5 plugin creator method to check for built-in plugin support
-
 
-                std::string pluginName;
-                nvinfer1::PluginFieldCollection fc;
-                std::vector<nvinfer1::PluginField> f;
-                if (layerMsg.type() == "Normalize")
-                {
-                    pluginName = "Normalize_TRT";
-                    f = parseNormalizeParam(layerMsg, weights, *mBlobNameToTensor);
-                }
-                else if (layerMsg.type() == "PriorBox")
-                {
-                    pluginName = "PriorBox_TRT";
-                    f = parsePriorBoxParam(layerMsg, weights, *mBlobNameToTensor);
-                }
-                else if (layerMsg.type() == "DetectionOutput")
-                {
-                    pluginName = "NMS_TRT";
-                    f = parseDetectionOutputParam(layerMsg, weights, *mBlobNameToTensor);
-                }
-                else if (layerMsg.type() == "RPROI")
-                {
-                    pluginName = "RPROI_TRT";
-                    f = parseRPROIParam(layerMsg, weights, *mBlobNameToTensor);
-                }
+            if (layer == nullptr)
+            {
+                std::cout << "error parsing layer type " << layerMsg.type() << " index " << i << std::endl;
+                ok = false;
+            }
+            continue;
+        }
 
-                if (mPluginRegistry.find(pluginName) != mPluginRegistry.end())
-                {
-                    // Set fc
-                    fc.nbFields = f.size();
-                    fc.fields = f.empty() ? nullptr : f.data();
-                    nvinfer1::IPluginV2* pluginV2 = mPluginRegistry.at(pluginName)->createPlugin(layerMsg.name().c_str(), &fc);
-                    assert(pluginV2);
-                    mNewPlugins.push_back(pluginV2);
-
-                    std::vector<ITensor*> inputs;
-                    for (int i = 0, n = layerMsg.bottom_size(); i < n; i++)
-                    {
-                        inputs.push_back((*mBlobNameToTensor)[layerMsg.bottom(i)]);
-                    }
+        // Use the TRT5 plugin creator method for built-in plugin support. The plugin parameters, and the weights they
+        // need, are only parsed once the creator is known to exist.
+        if (handler.kind == LayerKind::kCREATOR_PLUGIN)
+        {
+            std::vector<nvinfer1::PluginField> f = (this->*handler.parseParams)(layerMsg, weights, *mBlobNameToTensor);
+            nvinfer1::PluginFieldCollection fc;
+            fc.nbFields = f.size();
+            fc.fields = f.empty() ? nullptr : f.data();
+            std::unique_lock<std::mutex> pluginLock(*mPluginMutex);
+            nvinfer1::IPluginV2* pluginV2 = handler.creator->createPlugin(layerMsg.name().c_str(), &fc);
+            pluginLock.unlock();
+            assert(pluginV2);
+            mNewPlugins.push_back(pluginV2);
 
-                    auto layer = network.addPluginV2(&inputs[0], int(inputs.size()), *pluginV2);
-                    layer->setName(layerMsg.name().c_str());
-                    if (pluginV2->getNbOutputs() != layerMsg.top_size())
-                    {
-                        std::cout << "Plugin layer output count is not equal to caffe output count" << std::endl;
-                        ok = false;
-                    }
-                    for (int i = 0, n = std::min(layer->getNbOutputs(), layerMsg.top_size()); i < n; i++)
-                    {
-                        (*mBlobNameToTensor)[layerMsg.top(i)] = layer->getOutput(i);
-                    }
+            std::vector<ITensor*> inputs;
+            for (int i = 0, n = layerMsg.bottom_size(); i < n; i++)
+            {
+                inputs.push_back((*mBlobNameToTensor)[layerMsg.bottom(i)]);
+            }
 
-                    if (layer == nullptr)
-                    {
-                        std::cout << "error parsing layer type " << layerMsg.type() << " index " << i << std::endl;
-                        ok = false;
-                    }
-                    continue;
-                }
+            auto layer = network.addPluginV2(&inputs[0], int(inputs.size()), *pluginV2);
+            layer->setName(layerMsg.name().c_str());
+            if (pluginV2->getNbOutputs() != layerMsg.top_size())
+            {
+                std::cout << "Plugin layer output count is not equal to caffe output count" << std::endl;
+                ok = false;
+            }
+            for (int i = 0, n = std::min(layer->getNbOutputs(), layerMsg.top_size()); i < n; i++)
+            {
+                (*mBlobNameToTensor)[layerMsg.top(i)] = layer->getOutput(i);
+            }
 
+            if (layer == nullptr)
+            {
+                std::cout << "error parsing layer type " << layerMsg.type() << " index " << i << std::endl;
+                ok = false;
+            }
+            continue;
         }
 
-        if (layerMsg.type() == "Dropout")
+        if (handler.kind == LayerKind::kDROPOUT)
         {
             (*mBlobNameToTensor)[layerMsg.top().Get(0)] = (*mBlobNameToTensor)[layerMsg.bottom().Get(0)];
             continue;
         }
 
-        if (layerMsg.type() == "Input")
+        if (handler.kind == LayerKind::kINPUT)
         {
             const trtcaffe::InputParameter& p = layerMsg.input_param();
             for (int i = 0; i < layerMsg.top_size(); i++)
@@ -611,7 +919,7 @@ const IBlobNameToTensor* CaffeParser::parse(INetworkDefinition& network,
             }
             continue;
         }
-        if (layerMsg.type() == "Flatten")
+        if (handler.kind == LayerKind::kFLATTEN)
         {
             ITensor* tensor = (*mBlobNameToTensor)[layerMsg.bottom().Get(0)];
             (*mBlobNameToTensor)[layerMsg.top().Get(0)] = tensor;
@@ -622,17 +930,15 @@ const IBlobNameToTensor* CaffeParser::parse(INetworkDefinition& network,
             continue;
         }
 
-        // Use parser table to lookup the corresponding parse function to handle the rest of the layers
-        auto v = gParseTable.find(layerMsg.type());
-
-        if (v == gParseTable.end())
+        // The rest of the layers are handled by the parse function found in the parser table
+        if (handler.kind == LayerKind::kUNKNOWN)
         {
             std::cout << "could not parse layer type " << layerMsg.type() << std::endl;
             ok = false;
         }
         else
         {
-            ILayer* layer = (*v->second)(network, layerMsg, weights, *static_cast<BlobNameToTensor*>(mBlobNameToTensor));
+            ILayer* layer = (*handler.parse)(network, layerMsg, weights, *static_cast<BlobNameToTensor*>(mBlobNameToTensor));
             if (layer == nullptr)
             {
                 std::cout << "error parsing layer type " << layerMsg.type() << " index " << i << std::endl;
@@ -646,31 +952,39 @@ const IBlobNameToTensor* CaffeParser::parse(INetworkDefinition& network,
         }
     }
 
+    if (mStreamingModel)
+    {
+        mStreamingModel->release();
+    }
     mBlobNameToTensor->setTensorNames();
 
-    return ok && weights.isOK() && mBlobNameToTensor->isOK() ? mBlobNameToTensor : nullptr;
+    const bool parsed = ok && weights.isOK() && mBlobNameToTensor->isOK();
+    if (parsed && mWeightCache && mWeightCache->isRecording() && !mWeightCache->write(mWeightCachePath))
+    {
+        std::cout << "Warning: could not write parse cache file " << mWeightCachePath << std::endl;
+    }
+    return parsed ? mBlobNameToTensor : nullptr;
 }
 
 IBinaryProtoBlob* CaffeParser::parseBinaryProto(const char* fileName)
 {
     CHECK_NULL_RET_NULL(fileName)
-    using namespace google::protobuf::io;
 
-    std::ifstream stream(fileName, std::ios::in | std::ios::binary);
-    if (!stream)
+    // The blob data is aliased into the mapped file rather than decoded, and is handed out from there when it is
+    // already of the right type
+    std::unique_ptr<MappedFile> file(new MappedFile(fileName));
+    if (!file->isOpen())
     {
         RETURN_AND_LOG_ERROR(nullptr, "Could not open file " + std::string{fileName});
     }
-
-    IstreamInputStream rawInput(&stream);
-    CodedInputStream codedInput(&rawInput);
-    codedInput.SetTotalBytesLimit(INT_MAX, -1);
+    if (file->size() > static_cast<size_t>(INT_MAX))
+    {
+        RETURN_AND_LOG_ERROR(nullptr, "parseBinaryProto: mean file is too large");
+    }
 
     trtcaffe::BlobProto blob;
-    bool ok = blob.ParseFromCodedStream(&codedInput);
-    stream.close();
-
-    if (!ok)
+    RawDataAliases aliases;
+    if (!parseBlobAliasingRawData(file->data(), static_cast<int>(file->size()), &blob, aliases))
     {
         RETURN_AND_LOG_ERROR(nullptr, "parseBinaryProto: Could not parse mean file");
     }
@@ -694,21 +1008,49 @@ IBinaryProtoBlob* CaffeParser::parseBinaryProto(const char* fileName)
     const int dataSize = dims.n() * dims.c() * dims.h() * dims.w();
     assert(dataSize > 0);
 
-    const trtcaffe::Type blobProtoDataType = CaffeWeightFactory::getBlobProtoDataType(blob);
-    const auto blobProtoData = CaffeWeightFactory::getBlobProtoData(blob, blobProtoDataType, mTmpAllocs);
+    // Double precision means are handed out as FP32
+    trtcaffe::Type blobProtoDataType = CaffeWeightFactory::getBlobProtoDataType(blob, &aliases);
+    if (blobProtoDataType == trtcaffe::DOUBLE)
+    {
+        blobProtoDataType = trtcaffe::FLOAT;
+    }
+    const DataType dataType = blobProtoDataType == trtcaffe::FLOAT ? DataType::kFLOAT : DataType::kHALF;
+    const size_t elementSize = CaffeWeightFactory::sizeOfCaffeType(blobProtoDataType);
+    const int dataSizeBytes = dataSize * elementSize;
+
+    auto alias = aliases.find(&blob);
+    if (alias != aliases.end() && blob.raw_data_type() == blobProtoDataType)
+    {
+        if (alias->second.second != static_cast<size_t>(dataSizeBytes))
+        {
+            std::cout << "CaffeParser::parseBinaryProto: blob dimensions don't match data size!!" << std::endl;
+            return nullptr;
+        }
+        if (reinterpret_cast<uintptr_t>(alias->second.first) % elementSize == 0)
+        {
+            return new BinaryProtoBlob(std::move(file), alias->second.first, dataType, dims);
+        }
+        // Misaligned data is copied once, straight from the file
+        void* memory = malloc(dataSizeBytes);
+        memcpy(memory, alias->second.first, dataSizeBytes);
+        return new BinaryProtoBlob(memory, dataType, dims);
+    }
 
+    // The data has to be converted
+    WeightArena arena;
+    const auto blobProtoData = CaffeWeightFactory::getBlobProtoData(blob, blobProtoDataType, arena, &aliases);
+    if (blobProtoData.first == nullptr)
+    {
+        std::cout << "CaffeParser::parseBinaryProto: couldn't find any data!!" << std::endl;
+        return nullptr;
+    }
     if (dataSize != (int) blobProtoData.second)
     {
         std::cout << "CaffeParser::parseBinaryProto: blob dimensions don't match data size!!" << std::endl;
         return nullptr;
     }
 
-    const int dataSizeBytes = dataSize * CaffeWeightFactory::sizeOfCaffeType(blobProtoDataType);
     void* memory = malloc(dataSizeBytes);
     memcpy(memory, blobProtoData.first, dataSizeBytes);
-    return new BinaryProtoBlob(memory,
-                               blobProtoDataType == trtcaffe::FLOAT ? DataType::kFLOAT : DataType::kHALF, dims);
-
-    std::cout << "CaffeParser::parseBinaryProto: couldn't find any data!!" << std::endl;
-    return nullptr;
+    return new BinaryProtoBlob(memory, dataType, dims);
 }
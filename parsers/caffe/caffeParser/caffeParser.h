@@ -19,12 +19,15 @@
 
 #include <vector>
 #include <memory>
+#include <mutex>
 #include <unordered_map>
 #include <string>
 
 #include "NvCaffeParser.h"
 #include "caffeWeightFactory.h"
 #include "blobNameToTensor.h"
+#include "mappedFile.h"
+#include "streamingModel.h"
 #include "trtcaffe.pb.h"
 
 namespace nvcaffeparser1
@@ -58,6 +61,14 @@ public:
     void destroy() override { delete this; }
     void setErrorRecorder(nvinfer1::IErrorRecorder* recorder) override { (void)recorder; assert(!"TRT- Not implemented."); }
     nvinfer1::IErrorRecorder* getErrorRecorder() const override { assert(!"TRT- Not implemented."); return nullptr; }
+    void setStreamingParse(bool enable) override { mStreamingParse = enable; }
+    void resetWeightMemory() override;
+    size_t getWeightMemoryInUse() const override { return mWeightArena.getBytesInUse(); }
+    size_t getWeightMemoryHighWaterMark() const override { return mWeightArena.getHighWaterMark(); }
+    bool parseBatch(CaffeParseJob* jobs, int32_t nbJobs, int32_t nbThreads) override;
+    void setParseCacheDirectory(const char* directory) override { mParseCacheDirectory = directory ? directory : ""; }
+    int64_t getParseCacheHits() const override;
+    int64_t getParseCacheMisses() const override;
 
 private:
     ~CaffeParser() override;
@@ -69,26 +80,83 @@ private:
     template <typename T>
     T* allocMemory(int size = 1)
     {
-        T* tmpMem = static_cast<T*>(malloc(sizeof(T) * size));
-        mTmpAllocs.push_back(tmpMem);
-        return tmpMem;
+        return mWeightArena.allocate<T>(size);
     }
 
     const IBlobNameToTensor* parse(nvinfer1::INetworkDefinition& network,
                                    nvinfer1::DataType weightType,
                                    bool hasModel);
 
+    typedef std::unordered_map<std::string, nvinfer1::IPluginCreator*> PluginCreatorTable;
+    typedef nvinfer1::ILayer* (*LayerParseFn)(nvinfer1::INetworkDefinition&, const trtcaffe::LayerParameter&, CaffeWeightFactory&, BlobNameToTensor&);
+    typedef std::vector<nvinfer1::PluginField> (CaffeParser::*PluginParamParseFn)(const trtcaffe::LayerParameter&, CaffeWeightFactory&, BlobNameToTensor&);
+
+    enum class LayerKind
+    {
+        kSKIP,
+        kFACTORY_PLUGIN,
+        kFACTORY_PLUGIN_V2,
+        kCREATOR_PLUGIN,
+        kDROPOUT,
+        kINPUT,
+        kFLATTEN,
+        kBUILTIN,
+        kUNKNOWN
+    };
+
+    // How a layer of the deploy file is added to the network
+    struct LayerHandler
+    {
+        LayerKind kind{LayerKind::kUNKNOWN};
+        LayerParseFn parse{nullptr};
+        nvinfer1::IPluginCreator* creator{nullptr};
+        PluginParamParseFn parseParams{nullptr};
+    };
+
+    std::vector<LayerHandler> resolveLayerHandlers();
+    void updatePluginCreators();
+    void configureJobParser(CaffeParser& job) const;
+    void releaseModel();
+    bool openWeightCache(const void* deploy, size_t deploySize, const void* model, size_t modelSize,
+        nvinfer1::DataType weightType);
+
 private:
     std::shared_ptr<trtcaffe::NetParameter> mDeploy;
     std::shared_ptr<trtcaffe::NetParameter> mModel;
-    std::vector<void*> mTmpAllocs;
+    // Backs the blob data aliased in mRawDataAliases when the model was read from a file
+    std::unique_ptr<MappedFile> mModelFile;
+    RawDataAliases mRawDataAliases;
+    // Set instead of mModel holding the layers when parsing in streaming mode
+    std::unique_ptr<StreamingModel> mStreamingModel;
+    bool mStreamingParse{false};
+    // Set when the parse cache is enabled and there is a model, to either the cache entry that was hit or the one
+    // being recorded
+    std::unique_ptr<WeightCache> mWeightCache;
+    std::string mWeightCachePath;
+    std::string mParseCacheDirectory;
+    int64_t mParseCacheHits{0};
+    int64_t mParseCacheMisses{0};
+    // Holds converted weights and plugin fields until the parser is destroyed or resetWeightMemory() is called
+    WeightArena mWeightArena;
     BlobNameToTensor* mBlobNameToTensor{nullptr};
+    // Blob maps of earlier parses, kept because the caller may still hold them
+    std::vector<BlobNameToTensor*> mOldBlobNameToTensors;
     size_t mProtobufBufferSize{INT_MAX};
     nvcaffeparser1::IPluginFactory* mPluginFactory{nullptr};
     nvcaffeparser1::IPluginFactoryV2* mPluginFactoryV2{nullptr};
     bool mPluginFactoryIsExt{false};
     std::vector<nvinfer1::IPluginV2*> mNewPlugins;
-    std::unordered_map<std::string, nvinfer1::IPluginCreator*> mPluginRegistry;
+    // Built from the plugin registry on the first parse and shared with the job parsers of parseBatch(). It is only
+    // rebuilt if the number of registered creators changes.
+    std::shared_ptr<const PluginCreatorTable> mPluginCreators;
+    int mNbPluginCreators{-1};
+    // Serializes the calls into plugin factories and creators, which are shared by all the jobs of a batch
+    std::shared_ptr<std::mutex> mPluginMutex{std::make_shared<std::mutex>()};
+    // Job parsers own the state of the models parsed by parseBatch(). They go idle when the weight memory is reset,
+    // and idle ones are reused by later batches.
+    std::vector<CaffeParser*> mJobParsers;
+    std::vector<CaffeParser*> mIdleJobParsers;
+    bool mIsJobParser{false};
     std::string mPluginNamespace = "";
 };
 } //namespace nvcaffeparser1
@@ -39,22 +39,14 @@ inline bool bnConvertWrap(float scaleFactor, const Weights& variance, const Weig
             return false;
         }
     }
-    T* shiftv = reinterpret_cast<T*>(malloc(sizeof(T) * shift.count));
-    if (!shiftv)
+    T* shiftv = weightFactory.getWeightArena().allocate<T>(shift.count);
+    T* scalev = weightFactory.getWeightArena().allocate<T>(scale.count);
+    if (!shiftv || !scalev)
     {
         return false;
     }
-
-    T* scalev = reinterpret_cast<T*>(malloc(sizeof(T) * scale.count));
-    if (!scalev)
-    {
-        free(shiftv);
-        return false;
-    }
     shift.values = shiftv;
     scale.values = scalev;
-    weightFactory.getTmpAllocs().push_back(shiftv);
-    weightFactory.getTmpAllocs().push_back(scalev);
 
     const T* m = reinterpret_cast<const T*>(mean.values);
     const T* v = reinterpret_cast<const T*>(variance.values);
@@ -39,21 +39,19 @@ ILayer* parsePower(INetworkDefinition& network, const trtcaffe::LayerParameter&
     Weights wShift, wScale, wPower;
     if (dataType == DataType::kHALF)
     {
-        auto* t = reinterpret_cast<float16*>(malloc(3 * sizeof(float16)));
+        auto* t = weightFactory.getWeightArena().allocate<float16>(3);
         t[0] = float16(shift), t[1] = float16(scale), t[2] = float16(power);
         wShift = Weights{DataType::kHALF, &t[0], 1};
         wScale = Weights{DataType::kHALF, &t[1], 1};
         wPower = Weights{DataType::kHALF, &t[2], 1};
-        weightFactory.getTmpAllocs().push_back(t);
     }
     else
     {
-        auto* t = reinterpret_cast<float*>(malloc(3 * sizeof(float)));
+        auto* t = weightFactory.getWeightArena().allocate<float>(3);
         t[0] = shift, t[1] = scale, t[2] = power;
         wShift = Weights{DataType::kFLOAT, &t[0], 1};
         wScale = Weights{DataType::kFLOAT, &t[1], 1};
         wPower = Weights{DataType::kFLOAT, &t[2], 1};
-        weightFactory.getTmpAllocs().push_back(t);
     }
 
     weightFactory.convert(wShift);
@@ -141,12 +141,9 @@ ILayer* parseReduction(INetworkDefinition& network, const trtcaffe::LayerParamet
     // need to add in layer after for coeff != 1.0
     if (coeff != 1.0f)
     {
-        auto* shiftArr = (float*) malloc(sizeof(float));
-        auto* scaleArr = (float*) malloc(sizeof(float));
-        auto* powerArr = (float*) malloc(sizeof(float));
-        weightFactory.getTmpAllocs().push_back(shiftArr);
-        weightFactory.getTmpAllocs().push_back(scaleArr);
-        weightFactory.getTmpAllocs().push_back(powerArr);
+        auto* shiftArr = weightFactory.getWeightArena().allocate<float>();
+        auto* scaleArr = weightFactory.getWeightArena().allocate<float>();
+        auto* powerArr = weightFactory.getWeightArena().allocate<float>();
         *shiftArr = 0.0f;
         *scaleArr = coeff;
         *powerArr = 1.0f;
@@ -17,13 +17,19 @@
 #ifndef TRT_CAFFE_PARSER_READ_PROTO_H
 #define TRT_CAFFE_PARSER_READ_PROTO_H
 
+#include <algorithm>
+#include <climits>
 #include <fstream>
+#include <memory>
 
 #include "google/protobuf/io/coded_stream.h"
 #include "google/protobuf/io/zero_copy_stream_impl.h"
 #include "google/protobuf/text_format.h"
+#include "google/protobuf/wire_format_lite.h"
 
 #include "caffeMacros.h"
+#include "caffeWeightFactory.h"
+#include "mappedFile.h"
 #include "trtcaffe.pb.h"
 
 namespace nvcaffeparser1
@@ -34,34 +40,148 @@ namespace nvcaffeparser1
 //
 // So we need to read the deploy file to get the input
 
-bool readBinaryProto(trtcaffe::NetParameter* net, const char* file, size_t bufSize)
+// Merges the serialized message [data, data + size) into msg, except for the length-delimited fields for which
+// isSplit(fieldNumber) holds: their payloads are handed to onSplit(fieldNumber, payload, payloadSize) instead.
+// Runs of the remaining fields are merged through protobuf in one go.
+template <typename Message, typename IsSplitFn, typename OnSplitFn>
+bool mergeSplittingFields(const uint8_t* data, int size, Message* msg, IsSplitFn isSplit, OnSplitFn onSplit)
 {
-    CHECK_NULL_RET_VAL(net, false)
-    CHECK_NULL_RET_VAL(file, false)
     using namespace google::protobuf::io;
+    using google::protobuf::internal::WireFormatLite;
 
-    std::ifstream stream(file, std::ios::in | std::ios::binary);
-    if (!stream)
+    CodedInputStream input(data, size);
+    input.SetTotalBytesLimit(size, -1);
+    int runStart = 0;
+    auto mergeRun = [&](int runEnd) {
+        if (runEnd == runStart)
+        {
+            return true;
+        }
+        CodedInputStream run(data + runStart, runEnd - runStart);
+        run.SetTotalBytesLimit(runEnd - runStart, -1);
+        return msg->MergePartialFromCodedStream(&run) && run.ConsumedEntireMessage();
+    };
+
+    while (true)
     {
-        RETURN_AND_LOG_ERROR(false, "Could not open file " + std::string(file));
+        const int fieldStart = input.CurrentPosition();
+        const google::protobuf::uint32 tag = input.ReadTag();
+        if (tag == 0)
+        {
+            return input.CurrentPosition() == size && mergeRun(size);
+        }
+        const int field = WireFormatLite::GetTagFieldNumber(tag);
+        if (WireFormatLite::GetTagWireType(tag) == WireFormatLite::WIRETYPE_LENGTH_DELIMITED && isSplit(field))
+        {
+            google::protobuf::uint32 length;
+            if (!mergeRun(fieldStart) || !input.ReadVarint32(&length)
+                || length > static_cast<google::protobuf::uint32>(size - input.CurrentPosition()))
+            {
+                return false;
+            }
+            if (!onSplit(field, data + input.CurrentPosition(), static_cast<int>(length))
+                || !input.Skip(static_cast<int>(length)))
+            {
+                return false;
+            }
+            runStart = input.CurrentPosition();
+        }
+        else if (!WireFormatLite::SkipField(&input, tag))
+        {
+            return false;
+        }
     }
+}
 
-    IstreamInputStream rawInput(&stream);
-    CodedInputStream codedInput(&rawInput);
-    codedInput.SetTotalBytesLimit(int(bufSize), -1);
+// Parses a BlobProto without copying its bulk data. raw_data is recorded in aliases instead, and so are the packed
+// data and double_data of BVLC models, which then read as raw data of type FLOAT or DOUBLE. A blob that carries
+// its data in more than one piece, which serializers don't produce, is copied into the message as usual.
+inline bool parseBlobAliasingRawData(const uint8_t* data, int size, trtcaffe::BlobProto* blob, RawDataAliases& aliases)
+{
+    int nbPieces = 0;
+    bool ok = mergeSplittingFields(data, size, blob,
+        [](int field) {
+            return field == trtcaffe::BlobProto::kRawDataFieldNumber || field == trtcaffe::BlobProto::kDataFieldNumber
+                || field == trtcaffe::BlobProto::kDoubleDataFieldNumber;
+        },
+        [&](int field, const uint8_t* payload, int payloadSize) {
+            ++nbPieces;
+            if (field == trtcaffe::BlobProto::kDataFieldNumber)
+            {
+                blob->set_raw_data_type(trtcaffe::FLOAT);
+            }
+            else if (field == trtcaffe::BlobProto::kDoubleDataFieldNumber)
+            {
+                blob->set_raw_data_type(trtcaffe::DOUBLE);
+            }
+            aliases[blob] = std::make_pair(static_cast<const void*>(payload), static_cast<size_t>(payloadSize));
+            return true;
+        });
+    if (ok && nbPieces > 0
+        && (nbPieces > 1 || blob->data_size() > 0 || blob->double_data_size() > 0 || blob->has_raw_data()))
+    {
+        aliases.erase(blob);
+        blob->Clear();
+        ok = blob->ParseFromArray(data, size);
+    }
+    return ok;
+}
 
-    bool ok = net->ParseFromCodedStream(&codedInput);
-    stream.close();
+// Parses a LayerParameter or V1LayerParameter, aliasing the raw data of its blobs
+template <typename Layer>
+bool parseLayerAliasingRawData(const uint8_t* data, int size, Layer* layer, RawDataAliases& aliases)
+{
+    return mergeSplittingFields(data, size, layer,
+        [](int field) { return field == Layer::kBlobsFieldNumber; },
+        [&](int /*field*/, const uint8_t* payload, int payloadSize) {
+            return parseBlobAliasingRawData(payload, payloadSize, layer->add_blobs(), aliases);
+        });
+}
 
-    if (!ok)
+// Parses a caffemodel held in memory without copying the data of the blobs, which make up almost all of the
+// file. They are recorded in aliases instead, pointing into data, which therefore has to outlive
+// any use of the weights.
+inline bool parseNetAliasingRawData(const uint8_t* data, int size, trtcaffe::NetParameter* net, RawDataAliases& aliases)
+{
+    return mergeSplittingFields(data, size, net,
+        [](int field) {
+            return field == trtcaffe::NetParameter::kLayerFieldNumber
+                || field == trtcaffe::NetParameter::kLayersFieldNumber;
+        },
+        [&](int field, const uint8_t* payload, int payloadSize) {
+            return field == trtcaffe::NetParameter::kLayerFieldNumber
+                ? parseLayerAliasingRawData(payload, payloadSize, net->add_layer(), aliases)
+                : parseLayerAliasingRawData(payload, payloadSize, net->add_layers(), aliases);
+        });
+}
+
+// The model file is memory-mapped and parsed in place, so that the blob data is not copied. mapping keeps the
+// file mapped for as long as the weights in aliases are in use.
+inline bool readBinaryProto(trtcaffe::NetParameter* net, const char* file, size_t bufSize,
+                     std::unique_ptr<MappedFile>& mapping, RawDataAliases& aliases)
+{
+    CHECK_NULL_RET_VAL(net, false)
+    CHECK_NULL_RET_VAL(file, false)
+
+    mapping.reset(new MappedFile(file));
+    if (!mapping->isOpen())
+    {
+        RETURN_AND_LOG_ERROR(false, "Could not open file " + std::string(file));
+    }
+    if (mapping->size() > std::min(bufSize, static_cast<size_t>(INT_MAX)))
+    {
+        RETURN_AND_LOG_ERROR(false, "Binary model file exceeds the protobuf buffer size");
+    }
+
+    if (!parseNetAliasingRawData(mapping->data(), static_cast<int>(mapping->size()), net, aliases))
     {
         RETURN_AND_LOG_ERROR(false, "Could not parse binary model file");
     }
 
-    return ok;
+    return true;
 }
 
-bool readTextProto(trtcaffe::NetParameter* net, const char* file)
+inline bool readTextProto(trtcaffe::NetParameter* net, const char* file)
 {
     CHECK_NULL_RET_VAL(net, false)
     CHECK_NULL_RET_VAL(file, false)
@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TRT_CAFFE_PARSER_STREAMING_MODEL_H
+#define TRT_CAFFE_PARSER_STREAMING_MODEL_H
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "caffeWeightFactory.h"
+#include "mappedFile.h"
+#include "readProto.h"
+#include "trtcaffe.pb.h"
+
+namespace nvcaffeparser1
+{
+// A binary caffemodel that is decoded one layer at a time.
+//
+// Opening the model maps the file and only indexes where each layer is, by name. A layer is decoded when its blobs
+// are first asked for, and dropped again when another layer is asked for, so at most one decoded layer is held at
+// any time. The blob data itself is aliased into the mapping rather than decoded, so the weights handed out stay
+// valid after their layer is dropped. A layer whose blobs had to be copied into the message is kept instead.
+class StreamingModel : public ILayerBlobSource
+{
+public:
+    bool open(const char* file, size_t bufSize)
+    {
+        CHECK_NULL_RET_VAL(file, false)
+        using namespace google::protobuf::io;
+        using google::protobuf::internal::WireFormatLite;
+
+        mFile.reset(new MappedFile(file));
+        if (!mFile->isOpen())
+        {
+            RETURN_AND_LOG_ERROR(false, "Could not open file " + std::string(file));
+        }
+        if (mFile->size() > std::min(bufSize, static_cast<size_t>(INT_MAX)))
+        {
+            RETURN_AND_LOG_ERROR(false, "Binary model file exceeds the protobuf buffer size");
+        }
+
+        // Only the layer names are decoded here. The layers are skipped over by length.
+        trtcaffe::NetParameter rest;
+        const bool ok = mergeSplittingFields(mFile->data(), static_cast<int>(mFile->size()), &rest,
+            [](int field) {
+                return field == trtcaffe::NetParameter::kLayerFieldNumber
+                    || field == trtcaffe::NetParameter::kLayersFieldNumber;
+            },
+            [&](int field, const uint8_t* payload, int payloadSize) {
+                const bool legacy = field == trtcaffe::NetParameter::kLayersFieldNumber;
+                const int nameField = legacy ? static_cast<int>(trtcaffe::V1LayerParameter::kNameFieldNumber)
+                                             : static_cast<int>(trtcaffe::LayerParameter::kNameFieldNumber);
+                CodedInputStream input(payload, payloadSize);
+                input.SetTotalBytesLimit(payloadSize, -1);
+                std::string name;
+                for (google::protobuf::uint32 tag = input.ReadTag(); tag != 0; tag = input.ReadTag())
+                {
+                    if (WireFormatLite::GetTagFieldNumber(tag) == nameField
+                        && WireFormatLite::GetTagWireType(tag) == WireFormatLite::WIRETYPE_LENGTH_DELIMITED)
+                    {
+                        if (!WireFormatLite::ReadString(&input, &name))
+                        {
+                            return false;
+                        }
+                    }
+                    else if (!WireFormatLite::SkipField(&input, tag))
+                    {
+                        return false;
+                    }
+                }
+                // If a name is repeated, the first layer wins, as in CaffeWeightFactory
+                mIndex.emplace(name, LayerLocation{payload, payloadSize, legacy});
+                return true;
+            });
+        if (!ok)
+        {
+            RETURN_AND_LOG_ERROR(false, "Could not parse binary model file");
+        }
+        return true;
+    }
+
+    const google::protobuf::RepeatedPtrField<trtcaffe::BlobProto>* getBlobs(const std::string& layerName) override
+    {
+        if (mCurrent && layerName == mCurrentName)
+        {
+            return mCurrentBlobs;
+        }
+        release();
+        mCurrent = true;
+        mCurrentName = layerName;
+
+        auto it = mIndex.find(layerName);
+        if (it == mIndex.end())
+        {
+            return nullptr;
+        }
+        const LayerLocation& location = it->second;
+        bool ok{false};
+        if (location.legacy)
+        {
+            mV1Layer.reset(new trtcaffe::V1LayerParameter);
+            ok = parseLayerAliasingRawData(location.data, location.size, mV1Layer.get(), mAliases);
+            mCurrentBlobs = &mV1Layer->blobs();
+        }
+        else
+        {
+            mLayer.reset(new trtcaffe::LayerParameter);
+            ok = parseLayerAliasingRawData(location.data, location.size, mLayer.get(), mAliases);
+            mCurrentBlobs = &mLayer->blobs();
+        }
+        if (!ok)
+        {
+            std::cout << layerName << ": could not parse layer in binary model file" << std::endl;
+            release();
+            mCurrent = true;
+            return nullptr;
+        }
+        return mCurrentBlobs;
+    }
+
+    // Drops the decoded layer, if any
+    void release()
+    {
+        if (mCurrentBlobs)
+        {
+            bool ownsData{false};
+            for (const auto& blob : *mCurrentBlobs)
+            {
+                mAliases.erase(&blob);
+                ownsData |= blob.has_raw_data() || blob.data_size() > 0 || blob.double_data_size() > 0;
+            }
+            // Weights may point into a layer that holds its own data, and TensorRT reads them until the engine
+            // is built, so such a layer has to be kept.
+            if (ownsData && mLayer)
+            {
+                mRetainedLayers.push_back(std::move(mLayer));
+            }
+            if (ownsData && mV1Layer)
+            {
+                mRetainedV1Layers.push_back(std::move(mV1Layer));
+            }
+        }
+        mLayer.reset();
+        mV1Layer.reset();
+        mCurrentBlobs = nullptr;
+        mCurrent = false;
+    }
+
+    const RawDataAliases& getRawDataAliases() const
+    {
+        return mAliases;
+    }
+
+private:
+    struct LayerLocation
+    {
+        const uint8_t* data;
+        int size;
+        bool legacy;
+    };
+
+    std::unique_ptr<MappedFile> mFile;
+    std::unordered_map<std::string, LayerLocation> mIndex;
+    // Aliases of the blobs of the decoded layer only
+    RawDataAliases mAliases;
+
+    bool mCurrent{false};
+    std::string mCurrentName;
+    std::unique_ptr<trtcaffe::LayerParameter> mLayer;
+    std::unique_ptr<trtcaffe::V1LayerParameter> mV1Layer;
+    const google::protobuf::RepeatedPtrField<trtcaffe::BlobProto>* mCurrentBlobs{nullptr};
+
+    std::vector<std::unique_ptr<trtcaffe::LayerParameter>> mRetainedLayers;
+    std::vector<std::unique_ptr<trtcaffe::V1LayerParameter>> mRetainedV1Layers;
+};
+} // namespace nvcaffeparser1
+#endif // TRT_CAFFE_PARSER_STREAMING_MODEL_H
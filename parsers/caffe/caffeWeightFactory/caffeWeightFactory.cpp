@@ -17,12 +17,32 @@
 #include "caffeMacros.h"
 #include "caffeWeightFactory.h"
 #include "half.h"
+#include "weightConversion.h"
 
 using namespace nvinfer1;
 using namespace nvcaffeparser1;
 
+// Returns the raw data of a blob and its size in bytes, whether it is held by the message or aliased into the
+// mapped model file. The pointer is null if the blob has no raw data.
+static std::pair<const void*, size_t> getRawData(const trtcaffe::BlobProto& blobMsg, const RawDataAliases* rawDataAliases)
+{
+    if (blobMsg.has_raw_data())
+    {
+        return std::make_pair(blobMsg.raw_data().data(), blobMsg.raw_data().size());
+    }
+    if (rawDataAliases)
+    {
+        auto it = rawDataAliases->find(&blobMsg);
+        if (it != rawDataAliases->end())
+        {
+            return it->second;
+        }
+    }
+    return std::make_pair(nullptr, 0UL);
+}
+
 template <typename INPUT, typename OUTPUT>
-void* convertInternal(void** ptr, int64_t count, bool* mOK)
+void* convertInternal(void** ptr, int64_t count, WeightArena& arena, bool* mOK)
 {
     assert(ptr != nullptr);
     if (*ptr == nullptr)
@@ -34,35 +54,43 @@ void* convertInternal(void** ptr, int64_t count, bool* mOK)
         return nullptr;
     }
     auto* iPtr = static_cast<INPUT*>(*ptr);
-    auto* oPtr = static_cast<OUTPUT*>(malloc(count * sizeof(OUTPUT)));
-    for (int i = 0; i < count; ++i)
+    auto* oPtr = arena.allocate<OUTPUT>(count);
+    const ConversionResult result = convertWeights(iPtr, oPtr, count);
+    if (!result.inRange())
     {
-        if (static_cast<OUTPUT>(iPtr[i]) > std::numeric_limits<OUTPUT>::max()
-            || static_cast<OUTPUT>(iPtr[i]) < std::numeric_limits<OUTPUT>::lowest())
+        std::cout << "Error: Weight " << iPtr[result.firstOutOfRange] << " is outside of [" << std::numeric_limits<OUTPUT>::max()
+                  << ", " << std::numeric_limits<OUTPUT>::lowest() << "]." << std::endl;
+        if (mOK)
         {
-            std::cout << "Error: Weight " << iPtr[i] << " is outside of [" << std::numeric_limits<OUTPUT>::max()
-                      << ", " << std::numeric_limits<OUTPUT>::lowest() << "]." << std::endl;
-            if (mOK)
-            {
-                (*mOK) = false;
-            }
-            break;
+            (*mOK) = false;
         }
-        oPtr[i] = iPtr[i];
     }
     (*ptr) = oPtr;
     return oPtr;
 }
 
-
-
-CaffeWeightFactory::CaffeWeightFactory(const trtcaffe::NetParameter& msg, DataType dataType, std::vector<void*>& tmpAllocs, bool isInitialized)
+CaffeWeightFactory::CaffeWeightFactory(const trtcaffe::NetParameter& msg, DataType dataType, WeightArena& arena, bool isInitialized,
+                                       const RawDataAliases* rawDataAliases, ILayerBlobSource* blobSource,
+                                       WeightCache* weightCache)
     : mMsg(msg)
-    , mTmpAllocs(tmpAllocs)
+    , mRawDataAliases(rawDataAliases)
+    , mBlobSource(blobSource)
+    , mWeightCache(weightCache)
+    , mArena(arena)
     , mDataType(dataType)
     , mInitialized(isInitialized)
 {
     mRef = std::unique_ptr<trtcaffe::NetParameter>(new trtcaffe::NetParameter);
+
+    // Index the layers by name once, so that weight lookups don't rescan the whole model for every layer.
+    // If a name is repeated, the first layer wins, as it did with the linear search.
+    const bool legacy = mMsg.layer_size() == 0;
+    const int nbLayers = legacy ? mMsg.layers_size() : mMsg.layer_size();
+    mLayerIndex.reserve(nbLayers);
+    for (int i = 0; i < nbLayers; ++i)
+    {
+        mLayerIndex.emplace(legacy ? mMsg.layers(i).name() : mMsg.layer(i).name(), i);
+    }
 }
 
 DataType CaffeWeightFactory::getDataType() const
@@ -85,47 +113,59 @@ size_t CaffeWeightFactory::getDataTypeSize() const
     return 0;
 }
 
-std::vector<void*>& CaffeWeightFactory::getTmpAllocs()
+WeightArena& CaffeWeightFactory::getWeightArena()
 {
-    return mTmpAllocs;
+    return mArena;
 }
 
 int CaffeWeightFactory::getBlobsSize(const std::string& layerName)
 {
-    for (int i = 0, n = mMsg.layer_size(); i < n; ++i)
+    if (mWeightCache && mWeightCache->isLoaded())
     {
-        if (mMsg.layer(i).name() == layerName)
-        {
-            return mMsg.layer(i).blobs_size();
-        }
+        return mWeightCache->getBlobsSize(layerName);
     }
-    return 0;
+    const int size = getModelBlobsSize(layerName);
+    if (mWeightCache)
+    {
+        mWeightCache->recordBlobsSize(layerName, size);
+    }
+    return size;
 }
 
-const trtcaffe::BlobProto* CaffeWeightFactory::getBlob(const std::string& layerName, int index)
+int CaffeWeightFactory::getModelBlobsSize(const std::string& layerName)
 {
-    if (mMsg.layer_size() > 0)
+    if (mBlobSource)
     {
-        for (int i = 0, n = mMsg.layer_size(); i < n; i++)
-        {
-            if (mMsg.layer(i).name() == layerName && index < mMsg.layer(i).blobs_size())
-            {
-                return &mMsg.layer(i).blobs(index);
-            }
-        }
+        const auto* blobs = mBlobSource->getBlobs(layerName);
+        return blobs ? blobs->size() : 0;
     }
-    else
+    auto it = mLayerIndex.find(layerName);
+    if (it == mLayerIndex.end())
     {
-        for (int i = 0, n = mMsg.layers_size(); i < n; i++)
-        {
-            if (mMsg.layers(i).name() == layerName && index < mMsg.layers(i).blobs_size())
-            {
-                return &mMsg.layers(i).blobs(index);
-            }
-        }
+        return 0;
     }
+    return mMsg.layer_size() > 0 ? mMsg.layer(it->second).blobs_size() : mMsg.layers(it->second).blobs_size();
+}
 
-    return nullptr;
+const trtcaffe::BlobProto* CaffeWeightFactory::getBlob(const std::string& layerName, int index)
+{
+    if (mBlobSource)
+    {
+        const auto* blobs = mBlobSource->getBlobs(layerName);
+        return blobs && index < blobs->size() ? &blobs->Get(index) : nullptr;
+    }
+    auto it = mLayerIndex.find(layerName);
+    if (it == mLayerIndex.end())
+    {
+        return nullptr;
+    }
+    if (mMsg.layer_size() > 0)
+    {
+        const trtcaffe::LayerParameter& layer = mMsg.layer(it->second);
+        return index < layer.blobs_size() ? &layer.blobs(index) : nullptr;
+    }
+    const trtcaffe::V1LayerParameter& layer = mMsg.layers(it->second);
+    return index < layer.blobs_size() ? &layer.blobs(index) : nullptr;
 }
 
 std::vector<Weights> CaffeWeightFactory::getAllWeights(const std::string& layerName)
@@ -133,13 +173,24 @@ std::vector<Weights> CaffeWeightFactory::getAllWeights(const std::string& layerN
     std::vector<Weights> v;
     for (int i = 0;; i++)
     {
+        Weights weights;
+        if (mWeightCache && mWeightCache->isLoaded())
+        {
+            if (!mWeightCache->getBlob(layerName, i, weights))
+            {
+                break;
+            }
+            v.push_back(weights);
+            continue;
+        }
         auto b = getBlob(layerName, i);
         if (b == nullptr)
         {
             break;
         }
-        auto weights = getWeights(*b, layerName);
+        weights = getWeights(*b, layerName);
         convert(weights, DataType::kFLOAT);
+        recordWeights(layerName, i, weights);
         v.push_back(weights);
     }
     return v;
@@ -147,33 +198,55 @@ std::vector<Weights> CaffeWeightFactory::getAllWeights(const std::string& layerN
 
 Weights CaffeWeightFactory::operator()(const std::string& layerName, WeightType weightType)
 {
-    const trtcaffe::BlobProto* blobMsg = getBlob(layerName, int(weightType));
+    Weights weights;
+    if (mWeightCache && mWeightCache->isLoaded() && mWeightCache->getBlob(layerName, int(weightType), weights))
+    {
+        return weights;
+    }
+    const trtcaffe::BlobProto* blobMsg
+        = mWeightCache && mWeightCache->isLoaded() ? nullptr : getBlob(layerName, int(weightType));
     if (blobMsg == nullptr)
     {
         std::cout << "Weights for layer " << layerName << " doesn't exist" << std::endl;
         RETURN_AND_LOG_ERROR(getNullWeights(), "ERROR: Attempting to access NULL weights");
         assert(0);
     }
-    return getWeights(*blobMsg, layerName);
+    weights = getWeights(*blobMsg, layerName);
+    recordWeights(layerName, int(weightType), weights);
+    return weights;
+}
+
+void CaffeWeightFactory::recordWeights(const std::string& layerName, int index, const Weights& weights)
+{
+    if (mWeightCache && mWeightCache->isRecording())
+    {
+        // The blob count is recorded along with the first blob, since the cache must answer getBlobsSize() too
+        mWeightCache->recordBlobsSize(layerName, getModelBlobsSize(layerName));
+        mWeightCache->recordBlob(layerName, index, weights);
+    }
 }
 
 void CaffeWeightFactory::convert(Weights& weights, DataType targetType)
 {
-    void* tmpAlloc{nullptr};
+    if (mWeightCache && mWeightCache->isLoaded() && mWeightCache->getConverted(weights, targetType, weights))
+    {
+        return;
+    }
+    const Weights source = weights;
     if (weights.type == DataType::kFLOAT && targetType == DataType::kHALF)
     {
-        tmpAlloc = convertInternal<float, float16>(const_cast<void**>(&weights.values), weights.count, &mOK);
+        convertInternal<float, float16>(const_cast<void**>(&weights.values), weights.count, mArena, &mOK);
         weights.type = targetType;
+        if (mWeightCache)
+        {
+            mWeightCache->recordConverted(source, weights);
+        }
     }
     if (weights.type == DataType::kHALF && targetType == DataType::kFLOAT)
     {
-        tmpAlloc = convertInternal<float16, float>(const_cast<void**>(&weights.values), weights.count, &mOK);
+        convertInternal<float16, float>(const_cast<void**>(&weights.values), weights.count, mArena, &mOK);
         weights.type = targetType;
     }
-    if (tmpAlloc)
-    {
-        mTmpAllocs.push_back(tmpAlloc);
-    }
 }
 
 void CaffeWeightFactory::convert(Weights& weights)
@@ -198,7 +271,7 @@ Weights CaffeWeightFactory::getNullWeights()
 
 Weights CaffeWeightFactory::allocateWeights(int64_t elems, std::uniform_real_distribution<float> distribution)
 {
-    void* data = malloc(elems * getDataTypeSize());
+    void* data = mArena.allocate(elems * getDataTypeSize());
 
     switch (getDataType())
     {
@@ -218,13 +291,12 @@ Weights CaffeWeightFactory::allocateWeights(int64_t elems, std::uniform_real_dis
         break;
     }
 
-    mTmpAllocs.push_back(data);
     return Weights{getDataType(), data, elems};
 }
 
 Weights CaffeWeightFactory::allocateWeights(int64_t elems, std::normal_distribution<float> distribution)
 {
-    void* data = malloc(elems * getDataTypeSize());
+    void* data = mArena.allocate(elems * getDataTypeSize());
 
     switch (getDataType())
     {
@@ -244,13 +316,12 @@ Weights CaffeWeightFactory::allocateWeights(int64_t elems, std::normal_distribut
         break;
     }
 
-    mTmpAllocs.push_back(data);
     return Weights{getDataType(), data, elems};
 }
 
-trtcaffe::Type CaffeWeightFactory::getBlobProtoDataType(const trtcaffe::BlobProto& blobMsg)
+trtcaffe::Type CaffeWeightFactory::getBlobProtoDataType(const trtcaffe::BlobProto& blobMsg, const RawDataAliases* rawDataAliases)
 {
-    if (blobMsg.has_raw_data())
+    if (getRawData(blobMsg, rawDataAliases).first != nullptr)
     {
         assert(blobMsg.has_raw_data_type());
         return blobMsg.raw_data_type();
@@ -277,125 +348,113 @@ size_t CaffeWeightFactory::sizeOfCaffeType(trtcaffe::Type type)
 
 // The size returned here is the number of array entries, not bytes
 std::pair<const void*, size_t> CaffeWeightFactory::getBlobProtoData(const trtcaffe::BlobProto& blobMsg,
-                                                                        trtcaffe::Type type, std::vector<void*>& tmpAllocs)
+                                                                        trtcaffe::Type type, WeightArena& arena,
+                                                                        const RawDataAliases* rawDataAliases, bool* foundNan)
 {
+    const std::pair<const void*, size_t> rawData = getRawData(blobMsg, rawDataAliases);
+    const bool hasRawData = rawData.first != nullptr;
+
+    // Looks for NaNs in data that is handed out as is
+    auto checkInPlace = [&](const void* data, size_t count) {
+        if (foundNan)
+        {
+            *foundNan = type == trtcaffe::FLOAT16
+                ? checkWeights(static_cast<const float16*>(data), count).foundNan
+                : checkWeights(static_cast<const float*>(data), count).foundNan;
+        }
+    };
+
     // NVCaffe new binary format. It may carry any type.
-    if (blobMsg.has_raw_data())
+    if (hasRawData)
     {
         assert(blobMsg.has_raw_data_type());
         if (blobMsg.raw_data_type() == type)
         {
-            return std::make_pair(&blobMsg.raw_data().front(),
-                                    blobMsg.raw_data().size() / sizeOfCaffeType(type));
+            const size_t count = rawData.second / sizeOfCaffeType(type);
+            const void* data = rawData.first;
+            // Data aliased into a mapped file carries no alignment guarantee, so copy it out if needed
+            if (reinterpret_cast<uintptr_t>(data) % sizeOfCaffeType(type) != 0)
+            {
+                void* new_memory = arena.allocate(count * sizeOfCaffeType(type));
+                memcpy(new_memory, data, count * sizeOfCaffeType(type));
+                data = new_memory;
+            }
+            checkInPlace(data, count);
+            return std::make_pair(data, count);
         }
     }
     // Old BVLC format.
     if (blobMsg.data_size() > 0 && type == trtcaffe::FLOAT)
     {
-        return std::make_pair(&blobMsg.data().Get(0), blobMsg.data_size());
+        checkInPlace(blobMsg.data().data(), blobMsg.data_size());
+        return std::make_pair(blobMsg.data().data(), blobMsg.data_size());
     }
 
     // Converting to the target type otherwise
-    const int count = blobMsg.has_raw_data() ? blobMsg.raw_data().size() / sizeOfCaffeType(blobMsg.raw_data_type()) : (blobMsg.data_size() > 0 ? blobMsg.data_size() : blobMsg.double_data_size());
+    const int count = hasRawData ? rawData.second / sizeOfCaffeType(blobMsg.raw_data_type()) : (blobMsg.data_size() > 0 ? blobMsg.data_size() : blobMsg.double_data_size());
 
-    if (count > 0)
+    if (count > 0 && (type == trtcaffe::FLOAT || type == trtcaffe::FLOAT16))
     {
-        void* new_memory = malloc(count * sizeOfCaffeType(type));
-        tmpAllocs.push_back(new_memory);
+        void* new_memory = arena.allocate(count * sizeOfCaffeType(type));
 
+        // Range checking, NaN detection and conversion are done in one pass
+        ConversionResult result;
         if (type == trtcaffe::FLOAT)
         {
             auto* dst = reinterpret_cast<float*>(new_memory);
-            if (blobMsg.has_raw_data())
+            if (hasRawData)
             {
                 if (blobMsg.raw_data_type() == trtcaffe::FLOAT16)
                 {
-                    const auto* src = reinterpret_cast<const float16*>(&blobMsg.raw_data().front());
-                    for (int i = 0; i < count; ++i)
-                    {
-                        dst[i] = float(src[i]);
-                    }
+                    result = convertWeights(reinterpret_cast<const float16*>(rawData.first), dst, count);
                 }
                 else if (blobMsg.raw_data_type() == trtcaffe::DOUBLE)
                 {
-                    const auto* src = reinterpret_cast<const double*>(&blobMsg.raw_data().front());
-                    for (int i = 0; i < count; ++i)
-                    {
-                        dst[i] = float(src[i]);
-                    }
+                    result = convertWeights(reinterpret_cast<const double*>(rawData.first), dst, count);
                 }
             }
             else if (blobMsg.double_data_size() == count)
             {
-                for (int i = 0; i < count; ++i)
-                {
-                    dst[i] = float(blobMsg.double_data(i));
-                }
+                result = convertWeights(blobMsg.double_data().data(), dst, count);
             }
-            return std::make_pair(new_memory, count);
         }
-        if (type == trtcaffe::FLOAT16)
+        else
         {
             auto* dst = reinterpret_cast<float16*>(new_memory);
-
-            if (blobMsg.has_raw_data())
+            if (hasRawData)
             {
                 if (blobMsg.raw_data_type() == trtcaffe::FLOAT)
                 {
-                    const auto* src = reinterpret_cast<const float*>(&blobMsg.raw_data().front());
-                    for (int i = 0; i < count; ++i)
-                    {
-                        dst[i] = float16(src[i]);
-                    }
+                    result = convertWeights(reinterpret_cast<const float*>(rawData.first), dst, count);
                 }
                 else if (blobMsg.raw_data_type() == trtcaffe::DOUBLE)
                 {
-                    const auto* src = reinterpret_cast<const double*>(&blobMsg.raw_data().front());
-                    for (int i = 0; i < count; ++i)
-                    {
-                        dst[i] = float16(float(src[i]));
-                    }
+                    result = convertWeights(reinterpret_cast<const double*>(rawData.first), dst, count);
                 }
             }
             else if (blobMsg.data_size() == count)
             {
-                for (int i = 0; i < count; ++i)
-                {
-                    dst[i] = float16(blobMsg.data(i));
-                }
+                result = convertWeights(blobMsg.data().data(), dst, count);
             }
             else if (blobMsg.double_data_size() == count)
             {
-                for (int i = 0; i < count; ++i)
-                {
-                    dst[i] = float16(float(blobMsg.double_data(i)));
-                }
+                result = convertWeights(blobMsg.double_data().data(), dst, count);
             }
-            return std::make_pair(new_memory, count);
         }
-    }
-    return std::make_pair(nullptr, 0UL);
-}
-
-template <typename T>
-bool CaffeWeightFactory::checkForNans(const void* values, int count, const std::string& layerName)
-{
-    const T* v = reinterpret_cast<const T*>(values);
-    for (int i = 0; i < count; i++)
-    {
-        if (std::isnan(float(v[i])))
+        if (foundNan)
         {
-            std::cout << layerName << ": Nan detected in weights" << std::endl;
-            return false;
+            *foundNan = result.foundNan;
         }
+        return std::make_pair(new_memory, count);
     }
-    return true;
+    return std::make_pair(nullptr, 0UL);
 }
 
 Weights CaffeWeightFactory::getWeights(const trtcaffe::BlobProto& blobMsg, const std::string& layerName)
 {
     // Always load weights into FLOAT format
-    const auto blobProtoData = getBlobProtoData(blobMsg, trtcaffe::FLOAT, mTmpAllocs);
+    bool foundNan{false};
+    const auto blobProtoData = getBlobProtoData(blobMsg, trtcaffe::FLOAT, mArena, mRawDataAliases, &foundNan);
 
     if (blobProtoData.first == nullptr)
     {
@@ -406,6 +465,10 @@ Weights CaffeWeightFactory::getWeights(const trtcaffe::BlobProto& blobMsg, const
         return Weights{DataType::kFLOAT, nullptr, 0};
     }
 
-    mOK &= checkForNans<float>(blobProtoData.first, int(blobProtoData.second), layerName);
+    if (foundNan)
+    {
+        std::cout << layerName << ": Nan detected in weights" << std::endl;
+        mOK = false;
+    }
     return Weights{DataType::kFLOAT, blobProtoData.first, int(blobProtoData.second)};
 }
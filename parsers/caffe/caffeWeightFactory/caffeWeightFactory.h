@@ -21,19 +21,37 @@
 #include <string>
 #include <random>
 #include <memory>
+#include <unordered_map>
 #include "NvInfer.h"
+#include "weightArena.h"
+#include "weightCache.h"
 #include "weightType.h"
 #include "trtcaffe.pb.h"
 
 namespace nvcaffeparser1
 {
+// Raw blob data (pointer, size in bytes) that was left in the memory-mapped model file rather than copied into
+// BlobProto::raw_data while parsing. Such blobs have raw_data_type set but no raw_data.
+typedef std::unordered_map<const trtcaffe::BlobProto*, std::pair<const void*, size_t>> RawDataAliases;
+
+// Provides the blobs of a layer on demand, for models that are not held in memory as a whole
+class ILayerBlobSource
+{
+public:
+    // Returns nullptr if there is no layer of that name. The blobs stay valid until the next call.
+    virtual const google::protobuf::RepeatedPtrField<trtcaffe::BlobProto>* getBlobs(const std::string& layerName) = 0;
+    virtual ~ILayerBlobSource() {}
+};
+
 class CaffeWeightFactory
 {
 public:
-    CaffeWeightFactory(const trtcaffe::NetParameter& msg, nvinfer1::DataType dataType, std::vector<void*>& tmpAllocs, bool isInitialized);
+    CaffeWeightFactory(const trtcaffe::NetParameter& msg, nvinfer1::DataType dataType, WeightArena& arena, bool isInitialized,
+                       const RawDataAliases* rawDataAliases = nullptr, ILayerBlobSource* blobSource = nullptr,
+                       WeightCache* weightCache = nullptr);
     nvinfer1::DataType getDataType() const;
     size_t getDataTypeSize() const;
-    std::vector<void*>& getTmpAllocs();
+    WeightArena& getWeightArena();
     int getBlobsSize(const std::string& layerName);
     const trtcaffe::BlobProto* getBlob(const std::string& layerName, int index);
     std::vector<nvinfer1::Weights> getAllWeights(const std::string& layerName);
@@ -45,19 +63,29 @@ public:
     nvinfer1::Weights getNullWeights();
     nvinfer1::Weights allocateWeights(int64_t elems, std::uniform_real_distribution<float> distribution = std::uniform_real_distribution<float>(-0.01f, 0.01F));
     nvinfer1::Weights allocateWeights(int64_t elems, std::normal_distribution<float> distribution);
-    static trtcaffe::Type getBlobProtoDataType(const trtcaffe::BlobProto& blobMsg);
+    static trtcaffe::Type getBlobProtoDataType(const trtcaffe::BlobProto& blobMsg, const RawDataAliases* rawDataAliases = nullptr);
     static size_t sizeOfCaffeType(trtcaffe::Type type);
-    // The size returned here is the number of array entries, not bytes
-    static std::pair<const void*, size_t> getBlobProtoData(const  trtcaffe::BlobProto& blobMsg, trtcaffe::Type type, std::vector<void*>& tmpAllocs);
+    // The size returned here is the number of array entries, not bytes. If foundNan is given, the data is also
+    // checked for NaNs, in the same pass as the conversion when there is one.
+    static std::pair<const void*, size_t> getBlobProtoData(const  trtcaffe::BlobProto& blobMsg, trtcaffe::Type type, WeightArena& arena,
+                                                           const RawDataAliases* rawDataAliases = nullptr, bool* foundNan = nullptr);
 
 private:
-    template <typename T>
-    bool checkForNans(const void* values, int count, const std::string& layerName);
     nvinfer1::Weights getWeights(const trtcaffe::BlobProto& blobMsg, const std::string& layerName);
+    int getModelBlobsSize(const std::string& layerName);
+    void recordWeights(const std::string& layerName, int index, const nvinfer1::Weights& weights);
 
     const trtcaffe::NetParameter& mMsg;
+    // Maps a layer name to its index in mMsg.layer(), or in mMsg.layers() for legacy models
+    std::unordered_map<std::string, int> mLayerIndex;
+    const RawDataAliases* mRawDataAliases;
+    // If set, blobs are looked up here rather than in mMsg
+    ILayerBlobSource* mBlobSource;
+    // If loaded, weights are served from here and the model is not used. If recording, the weights handed out are
+    // recorded here.
+    WeightCache* mWeightCache;
     std::unique_ptr<trtcaffe::NetParameter> mRef;
-    std::vector<void*>& mTmpAllocs;
+    WeightArena& mArena;
     nvinfer1::DataType mDataType;
     // bool mQuantize;
     bool mInitialized;
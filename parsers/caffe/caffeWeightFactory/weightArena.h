@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TRT_CAFFE_PARSER_WEIGHT_ARENA_H
+#define TRT_CAFFE_PARSER_WEIGHT_ARENA_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+namespace nvcaffeparser1
+{
+// Bump-pointer arena for the temporary weight buffers of the parser: converted weights, random initial weights and
+// plugin fields. They all live until the network has been built, so they are never freed one by one. Memory is
+// taken from the system in large chunks, and reset() makes the chunks available again for the next model.
+class WeightArena
+{
+public:
+    static constexpr size_t kDefaultChunkSize = size_t(4) << 20;
+    static constexpr size_t kAlignment = 64;
+
+    explicit WeightArena(size_t chunkSize = kDefaultChunkSize)
+        : mChunkSize(chunkSize)
+    {
+    }
+
+    WeightArena(const WeightArena&) = delete;
+    WeightArena& operator=(const WeightArena&) = delete;
+
+    ~WeightArena()
+    {
+        for (auto& chunk : mChunks)
+        {
+            free(chunk.raw);
+        }
+    }
+
+    // Returns memory aligned to kAlignment, or nullptr if the system is out of memory
+    void* allocate(size_t bytes)
+    {
+        bytes = bytes ? roundUp(bytes) : kAlignment;
+        // First fit, starting from the chunk currently being filled. Chunks before it are treated as full.
+        for (size_t i = mCurrent; i < mChunks.size(); ++i)
+        {
+            if (mChunks[i].size - mChunks[i].used >= bytes)
+            {
+                return take(mChunks[i], bytes);
+            }
+        }
+
+        // Allocations bigger than a chunk get a chunk of their own
+        Chunk chunk;
+        chunk.size = std::max(mChunkSize, bytes);
+        chunk.raw = malloc(chunk.size + kAlignment - 1);
+        if (!chunk.raw)
+        {
+            return nullptr;
+        }
+        chunk.base = reinterpret_cast<uint8_t*>(roundUp(reinterpret_cast<uintptr_t>(chunk.raw)));
+        mBytesReserved += chunk.size;
+        mChunks.push_back(chunk);
+        if (mChunks[mCurrent].size - mChunks[mCurrent].used < mChunkSize / 16)
+        {
+            // Stop trying to fill a chunk that is nearly full
+            mCurrent = mChunks.size() - 1;
+        }
+        return take(mChunks.back(), bytes);
+    }
+
+    template <typename T>
+    T* allocate(size_t count = 1)
+    {
+        return static_cast<T*>(allocate(sizeof(T) * count));
+    }
+
+    // Makes all the memory available again without returning it to the system. Everything allocated before is
+    // invalidated.
+    void reset()
+    {
+        for (auto& chunk : mChunks)
+        {
+            chunk.used = 0;
+        }
+        mCurrent = 0;
+        mBytesInUse = 0;
+    }
+
+    // Bytes handed out since construction or the last reset(), including alignment padding
+    size_t getBytesInUse() const
+    {
+        return mBytesInUse;
+    }
+
+    // Highest value getBytesInUse() has reached
+    size_t getHighWaterMark() const
+    {
+        return mHighWaterMark;
+    }
+
+    // Bytes taken from the system
+    size_t getBytesReserved() const
+    {
+        return mBytesReserved;
+    }
+
+private:
+    struct Chunk
+    {
+        void* raw{nullptr};
+        uint8_t* base{nullptr};
+        size_t size{0};
+        size_t used{0};
+    };
+
+    static uintptr_t roundUp(uintptr_t value)
+    {
+        return (value + kAlignment - 1) & ~uintptr_t(kAlignment - 1);
+    }
+
+    void* take(Chunk& chunk, size_t bytes)
+    {
+        void* p = chunk.base + chunk.used;
+        chunk.used += bytes;
+        mBytesInUse += bytes;
+        mHighWaterMark = std::max(mHighWaterMark, mBytesInUse);
+        return p;
+    }
+
+    size_t mChunkSize;
+    std::vector<Chunk> mChunks;
+    size_t mCurrent{0};
+    size_t mBytesInUse{0};
+    size_t mHighWaterMark{0};
+    size_t mBytesReserved{0};
+};
+} // namespace nvcaffeparser1
+#endif // TRT_CAFFE_PARSER_WEIGHT_ARENA_H
@@ -0,0 +1,430 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+#include "weightCache.h"
+
+using namespace nvinfer1;
+
+namespace nvcaffeparser1
+{
+namespace
+{
+constexpr char kMagic[8] = {'T', 'R', 'T', 'C', 'W', 'C', 0, 0};
+// Bump this whenever the layout changes, or the way the factory produces weights does
+constexpr uint32_t kVersion = 1;
+constexpr uint64_t kAlignment = 64;
+
+struct FileHeader
+{
+    char magic[8];
+    uint32_t version;
+    int32_t dataType;
+    uint64_t hash;
+    uint64_t deploySize;
+    uint64_t modelSize;
+    uint64_t nbLayers;
+};
+
+struct FileBlob
+{
+    int32_t index;
+    int32_t hasHalf;
+    int64_t count;
+    uint64_t floatOffset;
+    uint64_t halfOffset;
+};
+
+bool isLittleEndian()
+{
+    const uint16_t one = 1;
+    uint8_t first;
+    memcpy(&first, &one, 1);
+    return first == 1;
+}
+
+inline uint64_t rotl(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+inline uint64_t mix(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+// Four independent multiply-rotate lanes over 32-byte stripes, so that hashing a large model runs at memory speed
+uint64_t hashBytes(const void* data, size_t size, uint64_t seed)
+{
+    constexpr uint64_t k1 = 0x9e3779b185ebca87ULL;
+    constexpr uint64_t k2 = 0xc2b2ae3d27d4eb4fULL;
+    const auto* p = static_cast<const uint8_t*>(data);
+    uint64_t lanes[4] = {seed + k1, seed ^ k2, seed - k1, ~seed};
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32)
+    {
+        for (int l = 0; l < 4; ++l)
+        {
+            uint64_t w;
+            memcpy(&w, p + i + 8 * l, 8);
+            lanes[l] = rotl(lanes[l] + w * k2, 31) * k1;
+        }
+    }
+    uint64_t h = rotl(lanes[0], 1) + rotl(lanes[1], 7) + rotl(lanes[2], 12) + rotl(lanes[3], 18) + size;
+    for (; i < size; ++i)
+    {
+        h = rotl(h ^ (p[i] * k1), 11) * k2;
+    }
+    return mix(h);
+}
+
+uint64_t alignUp(uint64_t offset)
+{
+    return (offset + kAlignment - 1) & ~(kAlignment - 1);
+}
+
+// Bounds-checked reads from the mapped file
+class Cursor
+{
+public:
+    Cursor(const uint8_t* data, size_t size)
+        : mData(data)
+        , mSize(size)
+    {
+    }
+
+    template <typename T>
+    bool read(T& value)
+    {
+        if (mSize - mOffset < sizeof(T))
+        {
+            return false;
+        }
+        memcpy(&value, mData + mOffset, sizeof(T));
+        mOffset += sizeof(T);
+        return true;
+    }
+
+    bool readString(std::string& value, uint32_t length)
+    {
+        if (mSize - mOffset < length)
+        {
+            return false;
+        }
+        value.assign(reinterpret_cast<const char*>(mData + mOffset), length);
+        mOffset += length;
+        return true;
+    }
+
+    // Returns nullptr unless count elements of elementSize bytes at offset lie inside the file. The count is checked
+    // against the remaining bytes before multiplying so that a corrupt count cannot wrap the size.
+    const void* at(uint64_t offset, uint64_t count, uint64_t elementSize) const
+    {
+        return offset <= mSize && count <= (mSize - offset) / elementSize ? mData + offset : nullptr;
+    }
+
+private:
+    const uint8_t* mData;
+    size_t mSize;
+    size_t mOffset{0};
+};
+
+template <typename T>
+void append(std::string& out, const T& value)
+{
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+} // namespace
+
+WeightCacheKey makeWeightCacheKey(const void* deploy, size_t deploySize, const void* model, size_t modelSize,
+    DataType dataType)
+{
+    WeightCacheKey key;
+    key.deploySize = deploySize;
+    key.modelSize = modelSize;
+    key.dataType = static_cast<int32_t>(dataType);
+    key.hash
+        = hashBytes(model, modelSize, hashBytes(deploy, deploySize, kVersion) ^ static_cast<uint64_t>(key.dataType));
+    return key;
+}
+
+std::string WeightCache::getFileName(const WeightCacheKey& key)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.caffeweights", static_cast<unsigned long long>(key.hash));
+    return name;
+}
+
+bool WeightCache::load(const std::string& path, const WeightCacheKey& key)
+{
+    mFile.reset();
+    mRecording = false;
+    mLayerNames.clear();
+    mLayers.clear();
+    mHalfData.clear();
+    if (!isLittleEndian())
+    {
+        return false;
+    }
+
+    std::unique_ptr<MappedFile> file(new MappedFile(path.c_str()));
+    if (!file->isOpen())
+    {
+        return false;
+    }
+    Cursor cursor(file->data(), file->size());
+    FileHeader header;
+    if (!cursor.read(header) || memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion
+        || header.hash != key.hash || header.deploySize != key.deploySize || header.modelSize != key.modelSize
+        || header.dataType != key.dataType)
+    {
+        return false;
+    }
+
+    const uint64_t elementSizes[] = {sizeof(float), sizeof(uint16_t)};
+    for (uint64_t l = 0; l < header.nbLayers; ++l)
+    {
+        uint32_t nameLength{0};
+        std::string name;
+        Layer layer;
+        uint32_t nbRecorded{0};
+        if (!cursor.read(nameLength) || !cursor.readString(name, nameLength) || !cursor.read(layer.nbBlobs)
+            || !cursor.read(nbRecorded))
+        {
+            return false;
+        }
+        for (uint32_t b = 0; b < nbRecorded; ++b)
+        {
+            FileBlob fileBlob;
+            if (!cursor.read(fileBlob) || fileBlob.count < 0)
+            {
+                return false;
+            }
+            Blob blob{fileBlob.index, fileBlob.count, nullptr, nullptr};
+            blob.floatData = cursor.at(fileBlob.floatOffset, fileBlob.count, elementSizes[0]);
+            if (fileBlob.hasHalf)
+            {
+                blob.halfData = cursor.at(fileBlob.halfOffset, fileBlob.count, elementSizes[1]);
+                if (!blob.halfData)
+                {
+                    return false;
+                }
+                mHalfData[blob.floatData] = blob.halfData;
+            }
+            if (!blob.floatData)
+            {
+                return false;
+            }
+            layer.blobs.push_back(blob);
+        }
+        mLayerNames.push_back(name);
+        mLayers.emplace(name, std::move(layer));
+    }
+
+    mKey = key;
+    mFile = std::move(file);
+    return true;
+}
+
+void WeightCache::record(const WeightCacheKey& key)
+{
+    mFile.reset();
+    mLayerNames.clear();
+    mLayers.clear();
+    mHalfData.clear();
+    mKey = key;
+    mRecording = isLittleEndian();
+}
+
+bool WeightCache::write(const std::string& path) const
+{
+    if (!mRecording)
+    {
+        return false;
+    }
+
+    std::string meta;
+    FileHeader header;
+    memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.dataType = mKey.dataType;
+    header.hash = mKey.hash;
+    header.deploySize = mKey.deploySize;
+    header.modelSize = mKey.modelSize;
+    header.nbLayers = mLayerNames.size();
+    append(meta, header);
+
+    // The metadata size is known before any offset is, since every field has a fixed size
+    uint64_t metaSize = sizeof(FileHeader);
+    for (const auto& name : mLayerNames)
+    {
+        metaSize += sizeof(uint32_t) + name.size() + 2 * sizeof(int32_t)
+            + mLayers.at(name).blobs.size() * sizeof(FileBlob);
+    }
+
+    // Arrays to write after the metadata, at these offsets
+    std::vector<std::pair<uint64_t, std::pair<const void*, uint64_t>>> arrays;
+    uint64_t offset = alignUp(metaSize);
+    for (const auto& name : mLayerNames)
+    {
+        const Layer& layer = mLayers.at(name);
+        append(meta, static_cast<uint32_t>(name.size()));
+        meta.append(name);
+        append(meta, layer.nbBlobs);
+        append(meta, static_cast<uint32_t>(layer.blobs.size()));
+        for (const Blob& blob : layer.blobs)
+        {
+            FileBlob fileBlob{blob.index, 0, blob.count, offset, 0};
+            arrays.emplace_back(offset, std::make_pair(blob.floatData, blob.count * sizeof(float)));
+            offset = alignUp(offset + blob.count * sizeof(float));
+            auto half = mHalfData.find(blob.floatData);
+            if (half != mHalfData.end())
+            {
+                fileBlob.hasHalf = 1;
+                fileBlob.halfOffset = offset;
+                arrays.emplace_back(offset, std::make_pair(half->second, blob.count * sizeof(uint16_t)));
+                offset = alignUp(offset + blob.count * sizeof(uint16_t));
+            }
+            append(meta, fileBlob);
+        }
+    }
+
+    std::random_device random;
+    std::ostringstream tmpPath;
+    tmpPath << path << ".tmp." << std::hex << random() << random();
+    {
+        std::ofstream out(tmpPath.str(), std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!out)
+        {
+            return false;
+        }
+        out.write(meta.data(), meta.size());
+        uint64_t written = meta.size();
+        const char padding[kAlignment] = {};
+        for (const auto& array : arrays)
+        {
+            out.write(padding, array.first - written);
+            out.write(static_cast<const char*>(array.second.first), array.second.second);
+            written = array.first + array.second.second;
+        }
+        if (!out)
+        {
+            out.close();
+            std::remove(tmpPath.str().c_str());
+            return false;
+        }
+    }
+    if (std::rename(tmpPath.str().c_str(), path.c_str()) != 0)
+    {
+        std::remove(tmpPath.str().c_str());
+        return false;
+    }
+    return true;
+}
+
+int WeightCache::getBlobsSize(const std::string& layerName) const
+{
+    auto it = mLayers.find(layerName);
+    return it == mLayers.end() ? 0 : it->second.nbBlobs;
+}
+
+bool WeightCache::getBlob(const std::string& layerName, int index, Weights& weights) const
+{
+    auto it = mLayers.find(layerName);
+    if (it == mLayers.end())
+    {
+        return false;
+    }
+    for (const Blob& blob : it->second.blobs)
+    {
+        if (blob.index == index)
+        {
+            weights = Weights{DataType::kFLOAT, blob.floatData, blob.count};
+            return true;
+        }
+    }
+    return false;
+}
+
+bool WeightCache::getConverted(const Weights& weights, DataType type, Weights& converted) const
+{
+    if (weights.type != DataType::kFLOAT || type != DataType::kHALF)
+    {
+        return false;
+    }
+    auto it = mHalfData.find(weights.values);
+    if (it == mHalfData.end())
+    {
+        return false;
+    }
+    converted = Weights{DataType::kHALF, it->second, weights.count};
+    return true;
+}
+
+WeightCache::Layer& WeightCache::getRecordedLayer(const std::string& layerName)
+{
+    auto it = mLayers.find(layerName);
+    if (it == mLayers.end())
+    {
+        mLayerNames.push_back(layerName);
+        it = mLayers.emplace(layerName, Layer()).first;
+    }
+    return it->second;
+}
+
+void WeightCache::recordBlobsSize(const std::string& layerName, int nbBlobs)
+{
+    if (mRecording)
+    {
+        getRecordedLayer(layerName).nbBlobs = nbBlobs;
+    }
+}
+
+void WeightCache::recordBlob(const std::string& layerName, int index, const Weights& weights)
+{
+    if (!mRecording || weights.type != DataType::kFLOAT || (!weights.values && weights.count))
+    {
+        return;
+    }
+    Layer& layer = getRecordedLayer(layerName);
+    for (const Blob& blob : layer.blobs)
+    {
+        if (blob.index == index)
+        {
+            return;
+        }
+    }
+    layer.blobs.push_back(Blob{index, weights.count, weights.values, nullptr});
+}
+
+void WeightCache::recordConverted(const Weights& weights, const Weights& converted)
+{
+    if (mRecording && weights.type == DataType::kFLOAT && converted.type == DataType::kHALF && weights.values)
+    {
+        mHalfData[weights.values] = converted.values;
+    }
+}
+} // namespace nvcaffeparser1
@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TRT_CAFFE_PARSER_WEIGHT_CACHE_H
+#define TRT_CAFFE_PARSER_WEIGHT_CACHE_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "NvInfer.h"
+#include "mappedFile.h"
+
+namespace nvcaffeparser1
+{
+// Identifies the inputs of a parse: the contents of the deploy and model buffers and the target weight type
+struct WeightCacheKey
+{
+    uint64_t hash{0};
+    uint64_t deploySize{0};
+    uint64_t modelSize{0};
+    int32_t dataType{0};
+};
+
+WeightCacheKey makeWeightCacheKey(const void* deploy, size_t deploySize, const void* model, size_t modelSize,
+    nvinfer1::DataType dataType);
+
+// On-disk cache of the weights handed out by CaffeWeightFactory for one model.
+//
+// A parse that misses the cache records, for every layer it asks about, the number of blobs and each blob it read as
+// FP32, along with the FP16 copies it converted. The records point at memory that lives until the end of the parse,
+// when write() stores them in a cache file. A parse that hits the cache maps that file and serves the same weights
+// from it, so the model is neither decoded nor converted.
+//
+// The file is little-endian, and arrays are 64-byte aligned from the start of the file. Caching is disabled on
+// big-endian hosts.
+class WeightCache
+{
+public:
+    // Maps the cache file and checks that it was written for key. Returns false if it is missing or stale.
+    bool load(const std::string& path, const WeightCacheKey& key);
+    // Starts recording the weights of a parse with this key
+    void record(const WeightCacheKey& key);
+    // Writes the recorded weights to path. The file is written under a temporary name and renamed into place, so
+    // concurrent writers and readers never see a partial file.
+    bool write(const std::string& path) const;
+
+    bool isLoaded() const
+    {
+        return static_cast<bool>(mFile);
+    }
+    bool isRecording() const
+    {
+        return mRecording;
+    }
+
+    // Lookups, when loaded. Unknown layers have no blobs.
+    int getBlobsSize(const std::string& layerName) const;
+    bool getBlob(const std::string& layerName, int index, nvinfer1::Weights& weights) const;
+    // Finds the cached conversion of a cached blob to type
+    bool getConverted(const nvinfer1::Weights& weights, nvinfer1::DataType type, nvinfer1::Weights& converted) const;
+
+    // Recording, when recording
+    void recordBlobsSize(const std::string& layerName, int nbBlobs);
+    void recordBlob(const std::string& layerName, int index, const nvinfer1::Weights& weights);
+    void recordConverted(const nvinfer1::Weights& weights, const nvinfer1::Weights& converted);
+
+    static std::string getFileName(const WeightCacheKey& key);
+
+private:
+    struct Blob
+    {
+        int32_t index;
+        int64_t count;
+        const void* floatData;
+        const void* halfData;
+    };
+
+    struct Layer
+    {
+        int32_t nbBlobs{0};
+        std::vector<Blob> blobs;
+    };
+
+    Layer& getRecordedLayer(const std::string& layerName);
+
+    WeightCacheKey mKey;
+    bool mRecording{false};
+    std::unique_ptr<MappedFile> mFile;
+    // Layers in the order they were first asked about, so that the file contents are deterministic
+    std::vector<std::string> mLayerNames;
+    std::unordered_map<std::string, Layer> mLayers;
+    // Maps the FP32 data of a blob to its FP16 copy
+    std::unordered_map<const void*, const void*> mHalfData;
+};
+} // namespace nvcaffeparser1
+#endif // TRT_CAFFE_PARSER_WEIGHT_CACHE_H
@@ -0,0 +1,509 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "weightConversion.h"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define TRT_CAFFE_X86_SIMD 1
+#include <immintrin.h>
+#define TRT_CAFFE_TARGET_AVX2_F16C __attribute__((target("avx2,f16c")))
+#endif
+
+namespace nvcaffeparser1
+{
+namespace
+{
+// Arrays shorter than this many elements per thread are converted on the calling thread
+constexpr int64_t kParallelGrain = int64_t(1) << 20;
+
+// Set on threads that must not split conversions of their own: the workers of ConversionPool, and the threads of a
+// SerialConversionScope
+thread_local bool tSerialConversion{false};
+
+inline uint16_t halfBits(float16 h)
+{
+    uint16_t bits;
+    memcpy(&bits, &h, sizeof(bits));
+    return bits;
+}
+
+inline float16 halfFromBits(uint16_t bits)
+{
+    float16 h;
+    memcpy(static_cast<void*>(&h), &bits, sizeof(bits));
+    return h;
+}
+
+// Rounds a float or double to the nearest half, ties to even, in one step. This matches _mm256_cvtps_ph with
+// _MM_FROUND_TO_NEAREST_INT bit for bit, NaN payloads included, so the scalar path and the SIMD tails agree with the
+// vector loop. half_float::half rounds ties away from zero and can't be used here.
+template <typename Bits, int kMantissaBits, int kExponentBias>
+uint16_t toHalfBits(Bits bits)
+{
+    constexpr int kExponentBits = int(sizeof(Bits)) * 8 - 1 - kMantissaBits;
+    constexpr Bits kMantissaMask = (Bits(1) << kMantissaBits) - 1;
+    constexpr int kMaxExponent = (1 << kExponentBits) - 1;
+
+    const uint16_t sign = static_cast<uint16_t>((bits >> (sizeof(Bits) * 8 - 16)) & 0x8000);
+    const int exponent = static_cast<int>((bits >> kMantissaBits) & Bits(kMaxExponent));
+    const Bits mantissa = bits & kMantissaMask;
+
+    if (exponent == kMaxExponent)
+    {
+        // Infinity, or a quiet NaN that keeps the top of the payload
+        return sign | (mantissa ? static_cast<uint16_t>(0x7E00 | (mantissa >> (kMantissaBits - 10))) : 0x7C00);
+    }
+    // Subnormal sources are far below the smallest half and flush to zero below
+    const int e = exponent == 0 ? -kExponentBias : exponent - kExponentBias;
+    if (e > 15)
+    {
+        return sign | 0x7C00;
+    }
+
+    // Number of source mantissa bits that don't fit, with the implicit bit made explicit. Half subnormals lose one
+    // more bit for each step of exponent below -14.
+    const int shift = kMantissaBits - 10 + std::max(0, -14 - e);
+    if (shift > kMantissaBits + 1)
+    {
+        return sign;
+    }
+    const Bits significand = exponent == 0 ? mantissa : mantissa | (Bits(1) << kMantissaBits);
+    const Bits halfway = Bits(1) << (shift - 1);
+    const Bits rest = significand & ((Bits(1) << shift) - 1);
+    uint32_t rounded = static_cast<uint32_t>(significand >> shift);
+    if (rest > halfway || (rest == halfway && (rounded & 1)))
+    {
+        ++rounded;
+    }
+    // The implicit bit of a normal result lands in the exponent field, and a carry out of the mantissa moves the
+    // value up to the next binade, or to infinity
+    const uint32_t magnitude = e < -14 ? rounded : (static_cast<uint32_t>(e + 14) << 10) + rounded;
+    return sign | static_cast<uint16_t>(std::min<uint32_t>(magnitude, 0x7C00));
+}
+
+inline void convertValue(float v, float16& h)
+{
+    uint32_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    h = halfFromBits(toHalfBits<uint32_t, 23, 127>(bits));
+}
+
+inline void convertValue(double v, float16& h)
+{
+    uint64_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    h = halfFromBits(toHalfBits<uint64_t, 52, 1023>(bits));
+}
+
+template <typename Src>
+inline void convertValue(Src v, float& f)
+{
+    f = float(v);
+}
+
+inline void merge(ConversionResult& into, const ConversionResult& from)
+{
+    into.foundNan |= from.foundNan;
+    if (into.firstOutOfRange < 0)
+    {
+        into.firstOutOfRange = from.firstOutOfRange;
+    }
+}
+
+inline void classify(float v, int64_t i, bool checkRange, ConversionResult& r)
+{
+    if (std::isnan(v))
+    {
+        r.foundNan = true;
+    }
+    else if (checkRange && std::isinf(v) && r.firstOutOfRange < 0)
+    {
+        r.firstOutOfRange = i;
+    }
+}
+
+inline void classify(float16 h, int64_t i, bool checkRange, ConversionResult& r)
+{
+    const uint16_t magnitude = halfBits(h) & 0x7FFF;
+    if (magnitude > 0x7C00)
+    {
+        r.foundNan = true;
+    }
+    else if (checkRange && magnitude == 0x7C00 && r.firstOutOfRange < 0)
+    {
+        r.firstOutOfRange = i;
+    }
+}
+
+// Classifies already converted values. The SIMD kernels only note that some value in their range was special,
+// and come back here to find out which.
+template <typename T>
+ConversionResult classifyRange(const T* values, int64_t begin, int64_t end, bool checkRange)
+{
+    ConversionResult r;
+    for (int64_t i = begin; i < end; ++i)
+    {
+        classify(values[i], i, checkRange, r);
+    }
+    return r;
+}
+
+template <typename Src, typename Dst>
+ConversionResult convertScalar(const Src* src, Dst* dst, int64_t begin, int64_t end)
+{
+    ConversionResult r;
+    for (int64_t i = begin; i < end; ++i)
+    {
+        convertValue(src[i], dst[i]);
+        classify(dst[i], i, true, r);
+    }
+    return r;
+}
+
+#ifdef TRT_CAFFE_X86_SIMD
+bool cpuHasAvx2F16C()
+{
+    static const bool supported = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("f16c");
+    return supported;
+}
+
+// Lanes of the result that are infinite or NaN
+TRT_CAFFE_TARGET_AVX2_F16C inline __m256 specialMask(__m256 v)
+{
+    const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+    const __m256 inf = _mm256_set1_ps(INFINITY);
+    return _mm256_or_ps(
+        _mm256_cmp_ps(v, v, _CMP_UNORD_Q), _mm256_cmp_ps(_mm256_and_ps(v, absMask), inf, _CMP_EQ_OQ));
+}
+
+TRT_CAFFE_TARGET_AVX2_F16C inline __m128i specialMask(__m128i h)
+{
+    const __m128i expMask = _mm_set1_epi16(0x7C00);
+    return _mm_cmpeq_epi16(_mm_and_si128(h, expMask), expMask);
+}
+
+TRT_CAFFE_TARGET_AVX2_F16C inline __m256 loadAsFloat(const float* p)
+{
+    return _mm256_loadu_ps(p);
+}
+
+TRT_CAFFE_TARGET_AVX2_F16C inline __m256 loadAsFloat(const float16* p)
+{
+    return _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+}
+
+TRT_CAFFE_TARGET_AVX2_F16C inline __m256 loadAsFloat(const double* p)
+{
+    return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm256_cvtpd_ps(_mm256_loadu_pd(p))),
+        _mm256_cvtpd_ps(_mm256_loadu_pd(p + 4)), 1);
+}
+
+TRT_CAFFE_TARGET_AVX2_F16C inline __m256 loadForHalf(const float* p)
+{
+    return loadAsFloat(p);
+}
+
+TRT_CAFFE_TARGET_AVX2_F16C inline __m256 loadForHalf(const float16* p)
+{
+    return loadAsFloat(p);
+}
+
+// Narrows four doubles to float, rounding to odd: inexact results are truncated and get their lowest mantissa bit
+// set. Float keeps more than two bits beyond half precision at every magnitude a half can represent, so rounding this
+// to half gives the same result as rounding the double directly, where going through a round to nearest float could
+// round twice.
+TRT_CAFFE_TARGET_AVX2_F16C inline __m128 narrowRoundToOdd(__m256d v)
+{
+    const __m256d absMask = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7FFFFFFFFFFFFFFFLL));
+    const __m128 nearest = _mm256_cvtpd_ps(v);
+    const __m256d widened = _mm256_cvtps_pd(nearest);
+    const __m256d inexact = _mm256_cmp_pd(widened, v, _CMP_NEQ_OQ);
+    const __m256d roundedUp
+        = _mm256_cmp_pd(_mm256_and_pd(widened, absMask), _mm256_and_pd(v, absMask), _CMP_GT_OQ);
+
+    // Keep the low half of each 64 bit mask to line the lanes up with the floats
+    const __m256i low = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+    const __m128i inexact32
+        = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(_mm256_castpd_si256(inexact), low));
+    const __m128i roundedUp32
+        = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(_mm256_castpd_si256(roundedUp), low));
+
+    // Floats are sign and magnitude, so subtracting one from the bits truncates a value that was rounded away from zero
+    __m128i bits = _mm_add_epi32(_mm_castps_si128(nearest), roundedUp32);
+    bits = _mm_or_si128(bits, _mm_and_si128(inexact32, _mm_set1_epi32(1)));
+    return _mm_castsi128_ps(bits);
+}
+
+TRT_CAFFE_TARGET_AVX2_F16C inline __m256 loadForHalf(const double* p)
+{
+    return _mm256_insertf128_ps(
+        _mm256_castps128_ps256(narrowRoundToOdd(_mm256_loadu_pd(p))), narrowRoundToOdd(_mm256_loadu_pd(p + 4)), 1);
+}
+
+template <typename Src>
+TRT_CAFFE_TARGET_AVX2_F16C ConversionResult convertAvx2(const Src* src, float* dst, int64_t begin, int64_t end)
+{
+    __m256 special = _mm256_setzero_ps();
+    int64_t i = begin;
+    for (; i + 8 <= end; i += 8)
+    {
+        const __m256 v = loadAsFloat(src + i);
+        _mm256_storeu_ps(dst + i, v);
+        special = _mm256_or_ps(special, specialMask(v));
+    }
+    ConversionResult r = _mm256_movemask_ps(special) ? classifyRange(dst, begin, i, true) : ConversionResult{};
+    merge(r, convertScalar(src, dst, i, end));
+    return r;
+}
+
+template <typename Src>
+TRT_CAFFE_TARGET_AVX2_F16C ConversionResult convertAvx2(const Src* src, float16* dst, int64_t begin, int64_t end)
+{
+    __m128i special = _mm_setzero_si128();
+    int64_t i = begin;
+    for (; i + 8 <= end; i += 8)
+    {
+        const __m128i h = _mm256_cvtps_ph(loadForHalf(src + i), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), h);
+        special = _mm_or_si128(special, specialMask(h));
+    }
+    ConversionResult r = _mm_testz_si128(special, special) ? ConversionResult{} : classifyRange(dst, begin, i, true);
+    merge(r, convertScalar(src, dst, i, end));
+    return r;
+}
+
+template <typename T>
+TRT_CAFFE_TARGET_AVX2_F16C ConversionResult checkAvx2(const T* src, int64_t begin, int64_t end)
+{
+    __m256 nan = _mm256_setzero_ps();
+    int64_t i = begin;
+    for (; i + 8 <= end; i += 8)
+    {
+        const __m256 v = loadAsFloat(src + i);
+        nan = _mm256_or_ps(nan, _mm256_cmp_ps(v, v, _CMP_UNORD_Q));
+    }
+    ConversionResult r;
+    r.foundNan = _mm256_movemask_ps(nan) != 0;
+    merge(r, classifyRange(src, i, end, false));
+    return r;
+}
+#endif // TRT_CAFFE_X86_SIMD
+
+// Worker threads shared by every conversion in the process. They are started by the first conversion large enough
+// to be split, and are never joined: the pool is leaked on purpose so that no thread is joined from a static
+// destructor or while the library is being unloaded.
+class ConversionPool
+{
+public:
+    using Range = std::function<ConversionResult(int64_t, int64_t)>;
+
+    static ConversionPool& instance()
+    {
+        static ConversionPool* pool = new ConversionPool(std::max(1U, std::thread::hardware_concurrency()) - 1);
+        return *pool;
+    }
+
+    // Runs fn over nbChunks chunks of [0, count) and returns their results in index order. The calling thread takes
+    // chunks as well, so a call completes even while every worker is busy with the chunks of other calls.
+    std::vector<ConversionResult> run(const Range& fn, int64_t count, int64_t chunk, int64_t nbChunks)
+    {
+        Job job{fn, count, chunk, nbChunks, 0, 0, std::vector<ConversionResult>(nbChunks)};
+        std::unique_lock<std::mutex> lock(mMutex);
+        mJobs.push_back(&job);
+        mWorkAvailable.notify_all();
+        int64_t index{0};
+        while (claim(job, index))
+        {
+            lock.unlock();
+            runChunk(job, index);
+            lock.lock();
+            ++job.nbDone;
+        }
+        mChunkDone.wait(lock, [&job]() { return job.nbDone == job.nbChunks; });
+        return std::move(job.results);
+    }
+
+private:
+    struct Job
+    {
+        const Range& fn;
+        int64_t count;
+        int64_t chunk;
+        int64_t nbChunks;
+        int64_t nbClaimed;
+        int64_t nbDone;
+        std::vector<ConversionResult> results;
+    };
+
+    explicit ConversionPool(unsigned nbWorkers)
+    {
+        for (unsigned w = 0; w < nbWorkers; ++w)
+        {
+            std::thread(&ConversionPool::work, this).detach();
+        }
+    }
+
+    // Takes the next chunk of job, with mMutex held. The job leaves the queue once all its chunks are taken.
+    bool claim(Job& job, int64_t& index)
+    {
+        if (job.nbClaimed == job.nbChunks)
+        {
+            return false;
+        }
+        index = job.nbClaimed++;
+        if (job.nbClaimed == job.nbChunks)
+        {
+            mJobs.erase(std::find(mJobs.begin(), mJobs.end(), &job));
+        }
+        return true;
+    }
+
+    static void runChunk(Job& job, int64_t index)
+    {
+        const int64_t begin = std::min(job.count, index * job.chunk);
+        job.results[index] = job.fn(begin, std::min(job.count, begin + job.chunk));
+    }
+
+    void work()
+    {
+        tSerialConversion = true;
+        std::unique_lock<std::mutex> lock(mMutex);
+        while (true)
+        {
+            mWorkAvailable.wait(lock, [this]() { return !mJobs.empty(); });
+            Job& job = *mJobs.front();
+            int64_t index{0};
+            claim(job, index);
+            lock.unlock();
+            runChunk(job, index);
+            lock.lock();
+            // The caller may return as soon as the last chunk is counted, so job is not touched after this
+            if (++job.nbDone == job.nbChunks)
+            {
+                mChunkDone.notify_all();
+            }
+        }
+    }
+
+    std::mutex mMutex;
+    std::condition_variable mWorkAvailable;
+    std::condition_variable mChunkDone;
+    std::deque<Job*> mJobs; // Jobs with chunks that no thread has taken yet
+};
+
+// Runs fn(begin, end) over [0, count), splitting large arrays across the shared workers unless the calling thread is
+// already one of a set of workers. Results are merged in index order, so the first out of range value is the same
+// whatever the number of threads.
+template <typename Fn>
+ConversionResult parallelFor(int64_t count, Fn fn)
+{
+    const int64_t nbThreads = tSerialConversion ? 1 : std::min<int64_t>(
+        std::max(1U, std::thread::hardware_concurrency()), (count + kParallelGrain - 1) / kParallelGrain);
+    if (nbThreads <= 1)
+    {
+        return fn(int64_t(0), count);
+    }
+
+    // Keep chunk boundaries on a multiple of the vector width so that only the last chunk has a scalar tail
+    const int64_t chunk = ((count + nbThreads - 1) / nbThreads + 7) / 8 * 8;
+    ConversionResult r;
+    for (const auto& result : ConversionPool::instance().run(fn, count, chunk, nbThreads))
+    {
+        merge(r, result);
+    }
+    return r;
+}
+
+template <typename Src, typename Dst>
+ConversionResult convert(const Src* src, Dst* dst, int64_t count)
+{
+    return parallelFor(count, [=](int64_t begin, int64_t end) -> ConversionResult {
+#ifdef TRT_CAFFE_X86_SIMD
+        if (cpuHasAvx2F16C())
+        {
+            return convertAvx2(src, dst, begin, end);
+        }
+#endif
+        return convertScalar(src, dst, begin, end);
+    });
+}
+
+template <typename T>
+ConversionResult check(const T* src, int64_t count)
+{
+    return parallelFor(count, [=](int64_t begin, int64_t end) -> ConversionResult {
+#ifdef TRT_CAFFE_X86_SIMD
+        if (cpuHasAvx2F16C())
+        {
+            return checkAvx2(src, begin, end);
+        }
+#endif
+        return classifyRange(src, begin, end, false);
+    });
+}
+} // namespace
+
+SerialConversionScope::SerialConversionScope(bool serial)
+    : mPrevious(tSerialConversion)
+{
+    tSerialConversion = mPrevious || serial;
+}
+
+SerialConversionScope::~SerialConversionScope()
+{
+    tSerialConversion = mPrevious;
+}
+
+ConversionResult convertWeights(const float* src, float16* dst, int64_t count)
+{
+    return convert(src, dst, count);
+}
+
+ConversionResult convertWeights(const float16* src, float* dst, int64_t count)
+{
+    return convert(src, dst, count);
+}
+
+ConversionResult convertWeights(const double* src, float* dst, int64_t count)
+{
+    return convert(src, dst, count);
+}
+
+ConversionResult convertWeights(const double* src, float16* dst, int64_t count)
+{
+    return convert(src, dst, count);
+}
+
+ConversionResult checkWeights(const float* src, int64_t count)
+{
+    return check(src, count);
+}
+
+ConversionResult checkWeights(const float16* src, int64_t count)
+{
+    return check(src, count);
+}
+} // namespace nvcaffeparser1
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TRT_CAFFE_PARSER_WEIGHT_CONVERSION_H
+#define TRT_CAFFE_PARSER_WEIGHT_CONVERSION_H
+
+#include <cstdint>
+
+#include "half.h"
+
+namespace nvcaffeparser1
+{
+// Outcome of a checked weight conversion. Range checking, NaN detection and the conversion itself are done in a
+// single pass over the data.
+struct ConversionResult
+{
+    int64_t firstOutOfRange{-1}; // index of the first value that doesn't fit in the destination type, or -1
+    bool foundNan{false};
+
+    bool inRange() const
+    {
+        return firstOutOfRange < 0;
+    }
+};
+
+// Each of these converts count values from src to dst. They use AVX2/F16C when the CPU has them, and split large
+// arrays across worker threads. Conversions to half round to nearest even whichever path they take, and doubles are
+// rounded to half in a single step. A value is out of range if it is infinite in the destination type.
+ConversionResult convertWeights(const float* src, float16* dst, int64_t count);
+ConversionResult convertWeights(const float16* src, float* dst, int64_t count);
+ConversionResult convertWeights(const double* src, float* dst, int64_t count);
+ConversionResult convertWeights(const double* src, float16* dst, int64_t count);
+
+// Only looks for NaNs, for weights that are used in place
+ConversionResult checkWeights(const float* src, int64_t count);
+ConversionResult checkWeights(const float16* src, int64_t count);
+
+// While one of these is alive with serial set, conversions on the current thread run on that thread alone. Callers
+// that already spread their work over a thread per core use it to keep each thread from starting workers of its own.
+class SerialConversionScope
+{
+public:
+    explicit SerialConversionScope(bool serial);
+    ~SerialConversionScope();
+    SerialConversionScope(const SerialConversionScope&) = delete;
+    SerialConversionScope& operator=(const SerialConversionScope&) = delete;
+
+private:
+    bool mPrevious;
+};
+} // namespace nvcaffeparser1
+#endif // TRT_CAFFE_PARSER_WEIGHT_CONVERSION_H
@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TRT_CAFFE_PARSER_MAPPED_FILE_H
+#define TRT_CAFFE_PARSER_MAPPED_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <vector>
+
+#ifndef _MSC_VER
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace nvcaffeparser1
+{
+//! Read-only view of a whole file. On POSIX systems the file is memory-mapped, so pages are only
+//! brought in when they are touched and are shared with the page cache. Elsewhere the file is read
+//! into a heap buffer.
+class MappedFile
+{
+public:
+    explicit MappedFile(const char* fileName)
+    {
+#ifndef _MSC_VER
+        int fd = open(fileName, O_RDONLY);
+        if (fd < 0)
+        {
+            return;
+        }
+        struct stat st;
+        if (fstat(fd, &st) == 0)
+        {
+            mSize = static_cast<size_t>(st.st_size);
+            void* addr = mSize ? mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, fd, 0) : nullptr;
+            if (addr != MAP_FAILED)
+            {
+                mData = static_cast<const uint8_t*>(addr);
+                mOpen = true;
+            }
+        }
+        close(fd);
+#else
+        std::ifstream stream(fileName, std::ios::in | std::ios::binary | std::ios::ate);
+        if (!stream)
+        {
+            return;
+        }
+        mBuffer.resize(static_cast<size_t>(stream.tellg()));
+        stream.seekg(0, std::ios::beg);
+        stream.read(reinterpret_cast<char*>(mBuffer.data()), mBuffer.size());
+        mData = mBuffer.data();
+        mSize = mBuffer.size();
+        mOpen = static_cast<bool>(stream);
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile()
+    {
+#ifndef _MSC_VER
+        if (mData && mSize)
+        {
+            munmap(const_cast<uint8_t*>(mData), mSize);
+        }
+#endif
+    }
+
+    bool isOpen() const
+    {
+        return mOpen;
+    }
+
+    const uint8_t* data() const
+    {
+        return mData;
+    }
+
+    size_t size() const
+    {
+        return mSize;
+    }
+
+private:
+    const uint8_t* mData{nullptr};
+    size_t mSize{0};
+    bool mOpen{false};
+#ifdef _MSC_VER
+    std::vector<uint8_t> mBuffer;
+#endif
+};
+} // namespace nvcaffeparser1
+#endif // TRT_CAFFE_PARSER_MAPPED_FILE_H
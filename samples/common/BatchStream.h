@@ -19,6 +19,7 @@
 
 #include "NvInfer.h"
 #include "common.h"
+#include "imagePreprocess.h"
 #include <algorithm>
 #include <assert.h>
 #include <stdio.h>
@@ -120,8 +121,10 @@ private:
         std::vector<uint8_t> rawData(numElements);
         file.read(reinterpret_cast<char*>(rawData.data()), numElements * sizeof(uint8_t));
         mData.resize(numElements);
-        std::transform(
-            rawData.begin(), rawData.end(), mData.begin(), [](uint8_t val) { return static_cast<float>(val) / 255.f; });
+        // The images have a single channel, so the whole set is converted as one tall image
+        samplesCommon::ImageNormalization norm;
+        norm.scale = 1.F / 255.F;
+        samplesCommon::normalizeImage(rawData.data(), numImages * imageH, imageW, 1, norm, mData.data());
     }
 
     void readLabelsFile(const std::string& labelsFilePath)
@@ -347,20 +350,16 @@ private:
             }
 
             std::vector<float> data(samplesCommon::volume(mDims));
-            const float scale = 2.0 / 255.0;
-            const float bias = 1.0;
-            long int volChl = mDims.d[2] * mDims.d[3];
 
-            // Normalize input data
+            // Normalize input data to [-1, 1], converting it from HWC to CHW
+            const std::vector<float> channelMeans(mDims.d[1], 127.5F);
+            samplesCommon::ImageNormalization norm;
+            norm.channelMeans = channelMeans.data();
+            norm.scale = 2.0F / 255.0F;
             for (int i = 0, volImg = mDims.d[1] * mDims.d[2] * mDims.d[3]; i < mBatchSize; ++i)
             {
-                for (int c = 0; c < mDims.d[1]; ++c)
-                {
-                    for (int j = 0; j < volChl; ++j)
-                    {
-                        data[i * volImg + c * volChl + j] = scale * float(ppms[i].buffer[j * mDims.d[1] + c]) - bias;
-                    }
-                }
+                samplesCommon::normalizeImage(
+                    ppms[i].buffer, mDims.d[2], mDims.d[3], mDims.d[1], norm, data.data() + i * volImg);
             }
 
             std::copy_n(data.data(), mDims.d[0] * mImageSize, getFileBatch());
@@ -0,0 +1,199 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TRT_IMAGE_PREPROCESS_H
+#define TRT_IMAGE_PREPROCESS_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "half.h"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define TRT_SAMPLES_X86_SIMD 1
+#include <immintrin.h>
+#define TRT_SAMPLES_TARGET_AVX2_F16C __attribute__((target("avx2,f16c")))
+#endif
+
+namespace samplesCommon
+{
+
+//!
+//! \brief Parameters of normalizeImage(). Each output value is (pixel - meanImage - channelMeans) * scale.
+//!
+struct ImageNormalization
+{
+    const float* meanImage{nullptr};    //!< Per-element mean in CHW layout, such as a Caffe mean blob, or nullptr
+    const float* channelMeans{nullptr}; //!< One mean per channel, or nullptr
+    float scale{1.0F};
+};
+
+namespace detail
+{
+
+inline float normalizePixel(const uint8_t* src, int32_t c, int64_t p, int32_t channels, int64_t planeSize,
+    const ImageNormalization& norm)
+{
+    float v = static_cast<float>(src[p * channels + c]);
+    if (norm.meanImage)
+    {
+        v -= norm.meanImage[c * planeSize + p];
+    }
+    if (norm.channelMeans)
+    {
+        v -= norm.channelMeans[c];
+    }
+    return v * norm.scale;
+}
+
+inline void storeNormalized(float* dst, float v)
+{
+    *dst = v;
+}
+
+//! Rounds to the nearest half with ties to even, like _mm256_cvtps_ph, so that the scalar loop and the vector loop
+//! agree. half_float::half rounds ties away from zero, so the value is first rounded in float arithmetic to a multiple
+//! of the half spacing around it, which half then stores exactly.
+inline half_float::half toHalf(float v)
+{
+    const float magnitude = std::fabs(v);
+    // Infinities, NaN and everything from the midpoint between the largest half and infinity up. The addition quiets
+    // signaling NaNs, which half would otherwise turn into infinity.
+    if (!(magnitude < 65520.0F))
+    {
+        return half_float::half(v + 0.0F);
+    }
+    // Adding a power of two whose float spacing is the half spacing at this magnitude rounds away the extra bits.
+    // Below the smallest normal half the spacing is fixed at 2^-24.
+    const float bias = std::ldexp(1.0F, std::max(std::ilogb(magnitude), -14) + 13);
+    const float rounded = (magnitude + bias) - bias;
+    return half_float::half(std::copysign(rounded, v));
+}
+
+inline void storeNormalized(half_float::half* dst, float v)
+{
+    *dst = toHalf(v);
+}
+
+//! Converts pixels [begin, end) of every channel one at a time
+template <typename T>
+void normalizeImageScalar(const uint8_t* src, int64_t begin, int64_t end, int32_t channels, int64_t planeSize,
+    const ImageNormalization& norm, T* dst)
+{
+    for (int32_t c = 0; c < channels; ++c)
+    {
+        for (int64_t p = begin; p < end; ++p)
+        {
+            storeNormalized(dst + c * planeSize + p, normalizePixel(src, c, p, channels, planeSize, norm));
+        }
+    }
+}
+
+#if TRT_SAMPLES_X86_SIMD
+TRT_SAMPLES_TARGET_AVX2_F16C inline void storeNormalized8(float* dst, __m256 v)
+{
+    _mm256_storeu_ps(dst, v);
+}
+
+TRT_SAMPLES_TARGET_AVX2_F16C inline void storeNormalized8(half_float::half* dst, __m256 v)
+{
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm256_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT));
+}
+
+//! Converts 8 pixels at a time and returns the number of pixels converted. Interleaved channels are picked out with
+//! 32-bit gathers, which read up to 3 bytes past the last pixel, so the last few pixels are left to the scalar loop.
+template <typename T>
+TRT_SAMPLES_TARGET_AVX2_F16C int64_t normalizeImageAVX2(
+    const uint8_t* src, int32_t channels, int64_t planeSize, const ImageNormalization& norm, T* dst)
+{
+    const int64_t srcSize = planeSize * channels;
+    int64_t vectorEnd = 0;
+    while (vectorEnd + 8 <= planeSize && (channels == 1 || (vectorEnd + 8) * channels + 3 <= srcSize))
+    {
+        vectorEnd += 8;
+    }
+
+    const __m256 scale = _mm256_set1_ps(norm.scale);
+    const __m256i offsets = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(channels));
+    const __m256i byteMask = _mm256_set1_epi32(0xFF);
+    for (int32_t c = 0; c < channels; ++c)
+    {
+        const __m256 channelMean = _mm256_set1_ps(norm.channelMeans ? norm.channelMeans[c] : 0.0F);
+        const float* meanPlane = norm.meanImage ? norm.meanImage + c * planeSize : nullptr;
+        T* dstPlane = dst + c * planeSize;
+        for (int64_t p = 0; p < vectorEnd; p += 8)
+        {
+            __m256i pixels;
+            if (channels == 1)
+            {
+                pixels = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + p)));
+            }
+            else
+            {
+                const int* base = reinterpret_cast<const int*>(src + p * channels + c);
+                pixels = _mm256_and_si256(_mm256_i32gather_epi32(base, offsets, 1), byteMask);
+            }
+            __m256 v = _mm256_cvtepi32_ps(pixels);
+            if (meanPlane)
+            {
+                v = _mm256_sub_ps(v, _mm256_loadu_ps(meanPlane + p));
+            }
+            storeNormalized8(dstPlane + p, _mm256_mul_ps(_mm256_sub_ps(v, channelMean), scale));
+        }
+    }
+    return vectorEnd;
+}
+
+inline bool hasAVX2F16C()
+{
+    static const bool supported = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("f16c");
+    return supported;
+}
+#endif
+
+} // namespace detail
+
+//!
+//! \brief Converts an interleaved (HWC) 8-bit image to planar (CHW) float or half values, subtracting the mean and
+//!        scaling in the same pass.
+//!
+//! Uses AVX2 when the CPU has it. Several images can be converted at once by passing their pixel count as
+//! height * width when they have a single channel.
+//!
+//! \param src The HWC image.
+//! \param height, width, channels The image dimensions.
+//! \param norm The means and scale to apply.
+//! \param dst The CHW output, with room for height * width * channels values.
+//!
+template <typename T>
+void normalizeImage(const uint8_t* src, int32_t height, int32_t width, int32_t channels,
+    const ImageNormalization& norm, T* dst)
+{
+    const int64_t planeSize = static_cast<int64_t>(height) * width;
+    int64_t done = 0;
+#if TRT_SAMPLES_X86_SIMD
+    if (detail::hasAVX2F16C())
+    {
+        done = detail::normalizeImageAVX2(src, channels, planeSize, norm, dst);
+    }
+#endif
+    detail::normalizeImageScalar(src, done, planeSize, channels, planeSize, norm, dst);
+}
+
+} // namespace samplesCommon
+
+#endif // TRT_IMAGE_PREPROCESS_H
@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cstring>
+
+#if !defined(_WIN32)
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+#include "sampleDataset.h"
+
+namespace sample
+{
+
+namespace
+{
+
+//!
+//! \brief List the regular files of a directory in name order, or return false if path is not a directory
+//!
+bool listDirectory(const std::string& path, std::vector<std::string>& files)
+{
+#if defined(_WIN32)
+    return false;
+#else
+    DIR* dir = opendir(path.c_str());
+    if (!dir)
+    {
+        return false;
+    }
+    while (const dirent* entry = readdir(dir))
+    {
+        const std::string fileName = path + "/" + entry->d_name;
+        struct stat status;
+        if (stat(fileName.c_str(), &status) == 0 && S_ISREG(status.st_mode))
+        {
+            files.push_back(fileName);
+        }
+    }
+    closedir(dir);
+    std::sort(files.begin(), files.end());
+    return true;
+#endif
+}
+
+} // namespace
+
+bool InputDataset::load(const std::string& path, size_t sampleSize, std::ostream& err)
+{
+    mSampleSize = sampleSize;
+    mFiles.clear();
+    mSamples.clear();
+    if (!sampleSize)
+    {
+        err << "Cannot replay a dataset for a network without inputs" << std::endl;
+        return false;
+    }
+
+    std::vector<std::string> fileNames;
+    const bool directory = listDirectory(path, fileNames);
+    if (!directory)
+    {
+        fileNames.push_back(path);
+    }
+    for (const auto& fileName : fileNames)
+    {
+        auto file = MappedInputFile::open(fileName);
+        if (!file)
+        {
+            err << "Cannot map dataset file " << fileName << std::endl;
+            return false;
+        }
+        if (directory ? file->size() != sampleSize : file->size() % sampleSize != 0)
+        {
+            err << "Dataset file " << fileName << " has " << file->size() << " bytes, but a sample of the inputs has "
+                << sampleSize << std::endl;
+            return false;
+        }
+        for (size_t offset = 0; offset < file->size(); offset += sampleSize)
+        {
+            mSamples.push_back(file->data() + offset);
+        }
+        mFiles.push_back(std::move(file));
+    }
+    if (mSamples.empty())
+    {
+        err << "Dataset " << path << " has no samples" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+DatasetFeeder::DatasetFeeder(const InputDataset& dataset, int64_t first, int64_t stride, int buffers)
+    : mDataset(dataset)
+    , mNext(first % dataset.getSize())
+    , mStride(stride)
+    , mBuffers(buffers)
+{
+    for (auto& buffer : mBuffers)
+    {
+        buffer.allocate(dataset.getSampleSize());
+    }
+    mThread = std::thread(&DatasetFeeder::prefetch, this);
+}
+
+DatasetFeeder::~DatasetFeeder()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStop = true;
+    }
+    mCondition.notify_all();
+    mThread.join();
+}
+
+const void* DatasetFeeder::acquire()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    mCondition.wait(lock, [this] { return mAcquired < mStaged; });
+    return mBuffers[mAcquired++ % mBuffers.size()].get();
+}
+
+void DatasetFeeder::release()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        ++mReleased;
+    }
+    mCondition.notify_all();
+}
+
+void DatasetFeeder::prefetch()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (true)
+    {
+        mCondition.wait(lock, [this] { return mStop || mStaged - mReleased < mBuffers.size(); });
+        if (mStop)
+        {
+            return;
+        }
+        void* buffer = mBuffers[mStaged % mBuffers.size()].get();
+
+        // The buffer is neither acquired nor waited for until it is staged, so it is filled unlocked
+        lock.unlock();
+        std::memcpy(buffer, mDataset.getSample(mNext), mDataset.getSampleSize());
+        mNext = (mNext + mStride) % mDataset.getSize();
+        lock.lock();
+
+        ++mStaged;
+        mCondition.notify_all();
+    }
+}
+
+} // namespace sample
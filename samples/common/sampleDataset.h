@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TRT_SAMPLE_DATASET_H
+#define TRT_SAMPLE_DATASET_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "sampleDevice.h"
+#include "sampleMappedFile.h"
+
+namespace sample
+{
+
+//!
+//! \class InputDataset
+//! \brief Input samples replayed during inference, mapped from a packed file or a directory of files
+//!
+//! A sample holds the values of all the inputs of the network one after the other, in binding order, each in the
+//! format --loadInputs reads. A packed file holds samples back to back. In a directory every file holds one sample,
+//! and files are replayed in name order.
+//!
+class InputDataset
+{
+public:
+    bool load(const std::string& path, size_t sampleSize, std::ostream& err);
+
+    int64_t getSize() const
+    {
+        return static_cast<int64_t>(mSamples.size());
+    }
+
+    size_t getSampleSize() const
+    {
+        return mSampleSize;
+    }
+
+    const uint8_t* getSample(int64_t index) const
+    {
+        return mSamples[index];
+    }
+
+private:
+    size_t mSampleSize{0};
+    std::vector<std::unique_ptr<MappedInputFile>> mFiles;
+    std::vector<const uint8_t*> mSamples;
+};
+
+//!
+//! \class DatasetFeeder
+//! \brief Stages the samples of one stream into pinned host buffers from a background thread
+//!
+//! The stream takes samples first, first + stride, first + 2 * stride, ... of the dataset, wrapping around. While the
+//! stream transfers a sample to the device, the thread copies the next ones out of the mapping, so page faults and
+//! copies stay off the inference thread, and transfers read pinned memory as they do from the bindings.
+//!
+//! Buffers are handed out in order by acquire(), and must be released in the same order once the transfer that reads
+//! them has completed.
+//!
+class DatasetFeeder
+{
+public:
+    DatasetFeeder(const InputDataset& dataset, int64_t first, int64_t stride, int buffers);
+
+    ~DatasetFeeder();
+
+    DatasetFeeder(const DatasetFeeder&) = delete;
+    DatasetFeeder& operator=(const DatasetFeeder&) = delete;
+
+    //!
+    //! \brief The next sample, waiting for it to be staged if needed
+    //!
+    const void* acquire();
+
+    //!
+    //! \brief Let the oldest acquired buffer be staged again
+    //!
+    void release();
+
+private:
+    void prefetch();
+
+    const InputDataset& mDataset;
+    int64_t mNext;
+    int64_t mStride;
+    std::vector<TrtHostBuffer> mBuffers;
+
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    // Buffers are used round robin, and these count the buffers staged, acquired and released so far
+    size_t mStaged{0};
+    size_t mAcquired{0};
+    size_t mReleased{0};
+    bool mStop{false};
+    std::thread mThread;
+};
+
+} // namespace sample
+
+#endif // TRT_SAMPLE_DATASET_H
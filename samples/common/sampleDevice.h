@@ -335,6 +335,14 @@ public:
         cudaCheck(cudaMemcpyAsync(mDeviceBuffer.get(), mHostBuffer.get(), mSize, cudaMemcpyHostToDevice, stream.get()));
     }
 
+    //!
+    //! \brief Copy to the device buffer from another host buffer of the same size
+    //!
+    void hostToDevice(TrtCudaStream& stream, const void* hostBuffer)
+    {
+        cudaCheck(cudaMemcpyAsync(mDeviceBuffer.get(), hostBuffer, mSize, cudaMemcpyHostToDevice, stream.get()));
+    }
+
     void deviceToHost(TrtCudaStream& stream)
     {
         cudaCheck(cudaMemcpyAsync(mHostBuffer.get(), mDeviceBuffer.get(), mSize, cudaMemcpyDeviceToHost, stream.get()));
@@ -0,0 +1,422 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <vector>
+
+#if defined(_WIN32)
+#include <direct.h>
+#include <io.h>
+#include <sys/utime.h>
+#else
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+#endif
+
+#include <cuda_runtime_api.h>
+
+#include "sampleEngineCache.h"
+#include "sampleEngines.h"
+#include "sampleMappedFile.h"
+
+using namespace nvinfer1;
+
+namespace sample
+{
+
+namespace
+{
+
+constexpr char kEntrySuffix[] = ".engine";
+constexpr char kTempInfix[] = ".tmp.";
+constexpr char kStatsFile[] = "stats";
+constexpr int64_t kStaleTempSeconds = 24 * 60 * 60;
+
+uint64_t rotl(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+uint64_t mix(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+// Four independent multiply-rotate lanes over 32-byte stripes, so that hashing a large model runs at memory speed
+uint64_t hashBytes(const void* data, size_t size, uint64_t seed)
+{
+    constexpr uint64_t k1 = 0x9e3779b185ebca87ULL;
+    constexpr uint64_t k2 = 0xc2b2ae3d27d4eb4fULL;
+    const auto* p = static_cast<const uint8_t*>(data);
+    uint64_t lanes[4] = {seed + k1, seed ^ k2, seed - k1, ~seed};
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32)
+    {
+        for (int l = 0; l < 4; ++l)
+        {
+            uint64_t w;
+            std::memcpy(&w, p + i + 8 * l, 8);
+            lanes[l] = rotl(lanes[l] + w * k2, 31) * k1;
+        }
+    }
+    uint64_t h = rotl(lanes[0], 1) + rotl(lanes[1], 7) + rotl(lanes[2], 12) + rotl(lanes[3], 18) + size;
+    for (; i < size; ++i)
+    {
+        h = rotl(h ^ (p[i] * k1), 11) * k2;
+    }
+    return mix(h);
+}
+
+//! Appends the size and hash of a file to the key, or returns false if it cannot be read
+bool describeFile(std::ostream& key, const char* what, const std::string& fileName)
+{
+    const auto file = MappedInputFile::open(fileName);
+    if (!file)
+    {
+        return false;
+    }
+    char hash[17];
+    snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(hashBytes(file->data(), file->size(), 0)));
+    key << what << " " << file->size() << " " << hash << std::endl;
+    return true;
+}
+
+void describeShapes(std::ostream& key, const char* what, const std::unordered_map<std::string, ShapeRange>& shapes)
+{
+    // Sorted, since the iteration order of the map is unspecified
+    const std::map<std::string, ShapeRange> sorted(shapes.begin(), shapes.end());
+    for (const auto& s : sorted)
+    {
+        key << what << " " << s.first.size() << ":" << s.first;
+        for (const auto& dims : s.second)
+        {
+            key << " ";
+            for (const auto d : dims)
+            {
+                key << d << "x";
+            }
+        }
+        key << std::endl;
+    }
+}
+
+void describeFormats(std::ostream& key, const char* what, const std::vector<IOFormat>& formats)
+{
+    for (const auto& f : formats)
+    {
+        key << what << " " << static_cast<int>(f.first) << " " << f.second << std::endl;
+    }
+}
+
+struct Entry
+{
+    std::string name;
+    int64_t size;
+    int64_t modified;
+};
+
+std::vector<Entry> listEntries(const std::string& directory)
+{
+    std::vector<Entry> entries;
+#if defined(_WIN32)
+    _finddata64_t data;
+    const intptr_t handle = _findfirst64((directory + "/*").c_str(), &data);
+    if (handle == -1)
+    {
+        return entries;
+    }
+    do
+    {
+        if (!(data.attrib & _A_SUBDIR))
+        {
+            entries.push_back({data.name, static_cast<int64_t>(data.size), static_cast<int64_t>(data.time_write)});
+        }
+    } while (_findnext64(handle, &data) == 0);
+    _findclose(handle);
+#else
+    DIR* dir = opendir(directory.c_str());
+    if (!dir)
+    {
+        return entries;
+    }
+    while (const dirent* d = readdir(dir))
+    {
+        struct stat status;
+        if (stat((directory + "/" + d->d_name).c_str(), &status) == 0 && S_ISREG(status.st_mode))
+        {
+            entries.push_back({d->d_name, static_cast<int64_t>(status.st_size), static_cast<int64_t>(status.st_mtime)});
+        }
+    }
+    closedir(dir);
+#endif
+    return entries;
+}
+
+bool isCacheEntry(const std::string& name)
+{
+    const size_t suffix = sizeof(kEntrySuffix) - 1;
+    return name.size() > suffix && name.compare(name.size() - suffix, suffix, kEntrySuffix) == 0
+        && name.find(kTempInfix) == std::string::npos;
+}
+
+} // namespace
+
+std::ostream& operator<<(std::ostream& os, const EngineCacheStats& stats)
+{
+    os << stats.hits << " hits, " << stats.misses << " misses, " << stats.evictions << " evictions; " << stats.entries
+       << " engines, " << (stats.bytes >> 20) << " MiB";
+    return os;
+}
+
+std::string makeEngineCacheKey(const ModelOptions& model, const BuildOptions& build, const SystemOptions& sys)
+{
+    std::ostringstream key;
+    key << "tensorrt " << getInferLibVersion() << std::endl;
+    cudaDeviceProp properties;
+    if (cudaGetDeviceProperties(&properties, sys.device) == cudaSuccess)
+    {
+        key << "device " << properties.name << " " << properties.major << "." << properties.minor << " "
+            << properties.multiProcessorCount << std::endl;
+    }
+
+    key << "format " << static_cast<int>(model.baseModel.format) << std::endl;
+    if (!describeFile(key, "model", model.baseModel.model)
+        || (!model.prototxt.empty() && !describeFile(key, "prototxt", model.prototxt)))
+    {
+        return "";
+    }
+    for (const auto& o : model.outputs)
+    {
+        key << "output " << o.size() << ":" << o << std::endl;
+    }
+    for (const auto& i : model.uffInputs.inputs)
+    {
+        key << "uffInput " << i.first.size() << ":" << i.first;
+        for (int d = 0; d < i.second.nbDims; ++d)
+        {
+            key << " " << i.second.d[d];
+        }
+        key << std::endl;
+    }
+    key << "uffNHWC " << model.uffInputs.NHWC << std::endl;
+
+    key << "build " << build.maxBatch << " " << build.workspace << " " << build.tf32 << " " << build.refittable << " "
+        << build.fp16 << " " << build.int8 << " " << build.safe << " " << static_cast<int>(build.nvtxMode) << " "
+        << build.enabledTactics << " " << build.disabledTactics << std::endl;
+    if (!build.calibration.empty() && !describeFile(key, "calibration", build.calibration))
+    {
+        return "";
+    }
+    describeShapes(key, "shape", build.shapes);
+    describeShapes(key, "calibrationShape", build.shapesCalib);
+    describeFormats(key, "inputFormat", build.inputFormats);
+    describeFormats(key, "outputFormat", build.outputFormats);
+
+    key << "dla " << sys.DLACore << " " << sys.fallback << std::endl;
+    for (const auto& p : sys.plugins)
+    {
+        if (!describeFile(key, "plugin", p))
+        {
+            return "";
+        }
+    }
+
+    const std::string text = key.str();
+    char hash[33];
+    snprintf(hash, sizeof(hash), "%016llx%016llx",
+        static_cast<unsigned long long>(hashBytes(text.data(), text.size(), 0x5bd1e995ULL)),
+        static_cast<unsigned long long>(hashBytes(text.data(), text.size(), 0x27d4eb2f165667c5ULL)));
+    return hash;
+}
+
+EngineCache::EngineCache(const std::string& directory, int64_t maxBytes)
+    : mDirectory(directory)
+    , mMaxBytes(maxBytes)
+{
+#if defined(_WIN32)
+    _mkdir(mDirectory.c_str());
+#else
+    mkdir(mDirectory.c_str(), 0777);
+#endif
+}
+
+std::string EngineCache::getPath(const std::string& key) const
+{
+    return mDirectory + "/" + key + kEntrySuffix;
+}
+
+ICudaEngine* EngineCache::load(const std::string& key, int DLACore, std::ostream& err)
+{
+    const std::string path = getPath(key);
+    ICudaEngine* engine{nullptr};
+    if (std::ifstream(path).good())
+    {
+        std::ostringstream loadErr;
+        engine = loadEngine(path, DLACore, loadErr);
+        if (engine)
+        {
+#if defined(_WIN32)
+            _utime(path.c_str(), nullptr);
+#else
+            utime(path.c_str(), nullptr);
+#endif
+        }
+        else
+        {
+            err << "Removing engine cache entry " << path << " that failed to load: " << loadErr.str();
+            std::remove(path.c_str());
+        }
+    }
+
+    mStats.entries = 0;
+    mStats.bytes = 0;
+    for (const auto& e : listEntries(mDirectory))
+    {
+        if (isCacheEntry(e.name))
+        {
+            ++mStats.entries;
+            mStats.bytes += e.size;
+        }
+    }
+    updateStats(engine ? 1 : 0, engine ? 0 : 1, 0);
+    return engine;
+}
+
+bool EngineCache::store(
+    const ICudaEngine& engine, const std::string& key, const std::string& metadata, std::ostream& err)
+{
+    const std::string path = getPath(key);
+    std::random_device random;
+    std::ostringstream tmpPath;
+    tmpPath << path << kTempInfix << std::hex << random() << random();
+    if (!saveEngineFile(engine, tmpPath.str(), err, metadata))
+    {
+        std::remove(tmpPath.str().c_str());
+        return false;
+    }
+#if defined(_WIN32)
+    // rename does not replace an existing file on Windows
+    std::remove(path.c_str());
+#endif
+    if (std::rename(tmpPath.str().c_str(), path.c_str()) != 0)
+    {
+        err << "Cannot add engine to cache: " << path << std::endl;
+        std::remove(tmpPath.str().c_str());
+        return false;
+    }
+    evict(key + kEntrySuffix);
+    return true;
+}
+
+void EngineCache::evict(const std::string& keep)
+{
+    std::vector<Entry> entries;
+    const int64_t now = static_cast<int64_t>(std::time(nullptr));
+    for (auto& e : listEntries(mDirectory))
+    {
+        if (isCacheEntry(e.name))
+        {
+            entries.push_back(std::move(e));
+        }
+        else if (e.name.find(kTempInfix) != std::string::npos && now - e.modified > kStaleTempSeconds)
+        {
+            // Left behind by a builder that did not finish
+            std::remove((mDirectory + "/" + e.name).c_str());
+        }
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+        return a.modified < b.modified || (a.modified == b.modified && a.name < b.name);
+    });
+    int64_t bytes = 0;
+    for (const auto& e : entries)
+    {
+        bytes += e.size;
+    }
+
+    int64_t evictions = 0;
+    int64_t remaining = static_cast<int64_t>(entries.size());
+    for (const auto& e : entries)
+    {
+        if (bytes <= mMaxBytes)
+        {
+            break;
+        }
+        // Another process may have evicted the entry already
+        if (e.name != keep && std::remove((mDirectory + "/" + e.name).c_str()) == 0)
+        {
+            bytes -= e.size;
+            --remaining;
+            ++evictions;
+        }
+    }
+    mStats.entries = remaining;
+    mStats.bytes = bytes;
+    updateStats(0, 0, evictions);
+}
+
+void EngineCache::updateStats(int64_t hits, int64_t misses, int64_t evictions)
+{
+    // The counters of all the runs are kept in a small text file, updated under a lock where the platform has one
+    const std::string path = mDirectory + "/" + kStatsFile;
+    long long totals[3] = {0, 0, 0};
+#if defined(_WIN32)
+    std::ifstream(path) >> totals[0] >> totals[1] >> totals[2];
+#else
+    const int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0666);
+    if (fd < 0)
+    {
+        return;
+    }
+    flock(fd, LOCK_EX);
+    char text[128] = {};
+    if (read(fd, text, sizeof(text) - 1) > 0)
+    {
+        sscanf(text, "%lld %lld %lld", &totals[0], &totals[1], &totals[2]);
+    }
+#endif
+    mStats.hits = totals[0] += hits;
+    mStats.misses = totals[1] += misses;
+    mStats.evictions = totals[2] += evictions;
+#if defined(_WIN32)
+    std::ofstream(path, std::ios::trunc) << totals[0] << " " << totals[1] << " " << totals[2] << std::endl;
+#else
+    const int length = snprintf(text, sizeof(text), "%lld %lld %lld\n", totals[0], totals[1], totals[2]);
+    // Losing an update only makes the counters approximate
+    const bool written = lseek(fd, 0, SEEK_SET) == 0 && ftruncate(fd, 0) == 0 && write(fd, text, length) == length;
+    static_cast<void>(written);
+    flock(fd, LOCK_UN);
+    close(fd);
+#endif
+}
+
+} // namespace sample
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TRT_SAMPLE_ENGINE_CACHE_H
+#define TRT_SAMPLE_ENGINE_CACHE_H
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+#include "NvInfer.h"
+#include "sampleOptions.h"
+
+namespace sample
+{
+
+//!
+//! \brief Counters of an engine cache. Hits, misses and evictions are totals over every run that used the directory.
+//!
+struct EngineCacheStats
+{
+    int64_t hits{0};
+    int64_t misses{0};
+    int64_t evictions{0};
+    int64_t entries{0}; //!< Engines in the cache after the last lookup or store
+    int64_t bytes{0};   //!< Size of those engines
+};
+
+std::ostream& operator<<(std::ostream& os, const EngineCacheStats& stats);
+
+//!
+//! \brief Computes the cache key of the engine that modelToEngine would build.
+//!
+//! The key is a 128-bit hash, in hexadecimal, of the contents of the model, prototxt, calibration cache and plugin
+//! files, of the options that change the engine, and of the TensorRT version and GPU. Options that only affect how
+//! long the build takes, and the paths of the files, are left out. Weights that an ONNX model keeps in external files
+//! are not part of the key.
+//!
+//! \return The key, or an empty string if a file cannot be read
+//!
+std::string makeEngineCacheKey(const ModelOptions& model, const BuildOptions& build, const SystemOptions& sys);
+
+//!
+//! \class EngineCache
+//! \brief Directory of engine files named after their cache key, with a size limit.
+//!
+//! Engines are stored with saveEngineFile, behind the header that records their metadata. Entries are written under
+//! a temporary name and renamed into place, so several processes can share a directory: readers only see complete
+//! files, and builders of the same key simply replace each other's entry. A hit refreshes the modification time of
+//! the entry, and storing an engine evicts the least recently used entries until the cache fits its size limit again.
+//!
+class EngineCache
+{
+public:
+    //!
+    //! \brief Uses directory as the cache, creating it if needed
+    //!
+    EngineCache(const std::string& directory, int64_t maxBytes);
+
+    //!
+    //! \brief Loads the engine cached under key, or returns nullptr on a miss. An entry that fails to load is
+    //!        removed and counted as a miss.
+    //!
+    nvinfer1::ICudaEngine* load(const std::string& key, int DLACore, std::ostream& err);
+
+    //!
+    //! \brief Adds an engine to the cache, then evicts entries until the cache fits its size limit
+    //!
+    bool store(const nvinfer1::ICudaEngine& engine, const std::string& key, const std::string& metadata,
+        std::ostream& err);
+
+    const EngineCacheStats& getStats() const
+    {
+        return mStats;
+    }
+
+private:
+    std::string getPath(const std::string& key) const;
+
+    void evict(const std::string& keep);
+
+    void updateStats(int64_t hits, int64_t misses, int64_t evictions);
+
+    std::string mDirectory;
+    int64_t mMaxBytes{0};
+    EngineCacheStats mStats;
+};
+
+} // namespace sample
+
+#endif // TRT_SAMPLE_ENGINE_CACHE_H
@@ -15,11 +15,15 @@
  */
 
 #include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <iterator>
 #include <map>
 #include <random>
+#include <sstream>
 #include <string>
 
 #include "NvCaffeParser.h"
@@ -28,7 +32,9 @@
 #include "NvUffParser.h"
 
 #include "logger.h"
+#include "sampleEngineCache.h"
 #include "sampleEngines.h"
+#include "sampleMappedFile.h"
 #include "sampleOptions.h"
 #include "sampleUtils.h"
 
@@ -629,25 +635,137 @@ void dumpRefittable(nvinfer1::ICudaEngine& engine)
     }
 }
 
+constexpr char EngineFileHeader::kMagic[8];
+
+namespace
+{
+
+std::string versionToString(int32_t version)
+{
+    return std::to_string(version / 1000) + "." + std::to_string(version / 100 % 10) + "."
+        + std::to_string(version % 100);
+}
+
+const char* dataTypeToString(DataType type)
+{
+    switch (type)
+    {
+    case DataType::kFLOAT: return "FP32";
+    case DataType::kHALF: return "FP16";
+    case DataType::kINT8: return "INT8";
+    case DataType::kINT32: return "INT32";
+    case DataType::kBOOL: return "BOOL";
+    }
+    return "UNKNOWN";
+}
+
+} // namespace
+
+uint32_t computeCrc32(const void* data, size_t size, uint32_t crc)
+{
+    // Slicing by 8: table[k][b] is the CRC of byte b followed by k zero bytes
+    static const std::vector<std::array<uint32_t, 256>> table = [] {
+        std::vector<std::array<uint32_t, 256>> t(8);
+        for (uint32_t b = 0; b < 256; ++b)
+        {
+            uint32_t c = b;
+            for (int bit = 0; bit < 8; ++bit)
+            {
+                c = (c >> 1) ^ (0xEDB88320U & (0U - (c & 1U)));
+            }
+            t[0][b] = c;
+        }
+        for (uint32_t b = 0; b < 256; ++b)
+        {
+            for (int k = 1; k < 8; ++k)
+            {
+                t[k][b] = (t[k - 1][b] >> 8) ^ t[0][t[k - 1][b] & 0xFF];
+            }
+        }
+        return t;
+    }();
+
+    const auto* p = static_cast<const uint8_t*>(data);
+    crc = ~crc;
+    for (; size >= 8; size -= 8, p += 8)
+    {
+        const uint32_t low = crc ^ (p[0] | p[1] << 8 | p[2] << 16 | static_cast<uint32_t>(p[3]) << 24);
+        crc = table[7][low & 0xFF] ^ table[6][(low >> 8) & 0xFF] ^ table[5][(low >> 16) & 0xFF] ^ table[4][low >> 24]
+            ^ table[3][p[4]] ^ table[2][p[5]] ^ table[1][p[6]] ^ table[0][p[7]];
+    }
+    for (; size; --size, ++p)
+    {
+        crc = (crc >> 8) ^ table[0][(crc ^ *p) & 0xFF];
+    }
+    return ~crc;
+}
+
+bool isEngineFile(const uint8_t* data, size_t size)
+{
+    return size >= sizeof(EngineFileHeader)
+        && std::equal(std::begin(EngineFileHeader::kMagic), std::end(EngineFileHeader::kMagic),
+            reinterpret_cast<const char*>(data));
+}
+
+bool readEngineFileHeader(const uint8_t* data, size_t size, EngineFileHeader& header, std::ostream& err)
+{
+    if (!isEngineFile(data, size))
+    {
+        err << "Not an engine file" << std::endl;
+        return false;
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (header.version != EngineFileHeader::kVersion)
+    {
+        err << "Unsupported engine file version " << header.version << std::endl;
+        return false;
+    }
+    if (header.metadataOffset > size || header.metadataSize > size - header.metadataOffset
+        || header.engineOffset > size || header.engineSize > size - header.engineOffset)
+    {
+        err << "Engine file is truncated" << std::endl;
+        return false;
+    }
+    if (computeCrc32(data + header.metadataOffset, header.metadataSize) != header.metadataCrc)
+    {
+        err << "Engine file metadata is corrupt" << std::endl;
+        return false;
+    }
+    return true;
+}
+
 ICudaEngine* loadEngine(const std::string& engine, int DLACore, std::ostream& err)
 {
-    std::ifstream engineFile(engine, std::ios::binary);
-    if (!engineFile)
+    const auto file = MappedInputFile::open(engine);
+    if (!file)
     {
         err << "Error opening engine file: " << engine << std::endl;
         return nullptr;
     }
 
-    engineFile.seekg(0, engineFile.end);
-    long int fsize = engineFile.tellg();
-    engineFile.seekg(0, engineFile.beg);
-
-    std::vector<char> engineData(fsize);
-    engineFile.read(engineData.data(), fsize);
-    if (!engineFile)
+    const uint8_t* engineData = file->data();
+    size_t engineSize = file->size();
+    if (isEngineFile(file->data(), file->size()))
     {
-        err << "Error loading engine file: " << engine << std::endl;
-        return nullptr;
+        EngineFileHeader header;
+        if (!readEngineFileHeader(file->data(), file->size(), header, err))
+        {
+            err << "Error loading engine file: " << engine << std::endl;
+            return nullptr;
+        }
+        if (header.tensorrtVersion != static_cast<uint32_t>(getInferLibVersion()))
+        {
+            err << "Engine file " << engine << " was saved by TensorRT " << versionToString(header.tensorrtVersion)
+                << ", but this is TensorRT " << versionToString(getInferLibVersion()) << std::endl;
+            return nullptr;
+        }
+        engineData = file->data() + header.engineOffset;
+        engineSize = header.engineSize;
+        if (computeCrc32(engineData, engineSize) != header.engineCrc)
+        {
+            err << "Engine file " << engine << " is corrupt: checksum mismatch" << std::endl;
+            return nullptr;
+        }
     }
 
     TrtUniquePtr<IRuntime> runtime{createInferRuntime(sample::gLogger.getTRTLogger())};
@@ -656,7 +774,7 @@ ICudaEngine* loadEngine(const std::string& engine, int DLACore, std::ostream& er
         runtime->setDLACore(DLACore);
     }
 
-    return runtime->deserializeCudaEngine(engineData.data(), fsize, nullptr);
+    return runtime->deserializeCudaEngine(engineData, engineSize, nullptr);
 }
 
 bool saveEngine(const ICudaEngine& engine, const std::string& fileName, std::ostream& err)
@@ -679,6 +797,82 @@ bool saveEngine(const ICudaEngine& engine, const std::string& fileName, std::ost
     return !engineFile.fail();
 }
 
+bool saveEngineFile(
+    const ICudaEngine& engine, const std::string& fileName, std::ostream& err, const std::string& metadata)
+{
+    std::ofstream engineFile(fileName, std::ios::binary);
+    if (!engineFile)
+    {
+        err << "Cannot open engine file: " << fileName << std::endl;
+        return false;
+    }
+
+    TrtUniquePtr<IHostMemory> serializedEngine{engine.serialize()};
+    if (serializedEngine == nullptr)
+    {
+        err << "Engine serialization failed" << std::endl;
+        return false;
+    }
+
+    EngineFileHeader header{};
+    std::copy(std::begin(EngineFileHeader::kMagic), std::end(EngineFileHeader::kMagic), header.magic);
+    header.version = EngineFileHeader::kVersion;
+    header.tensorrtVersion = static_cast<uint32_t>(getInferLibVersion());
+    header.metadataOffset = sizeof(header);
+    header.metadataSize = metadata.size();
+    header.engineOffset = roundUp<uint64_t>(header.metadataOffset + header.metadataSize, 64);
+    header.engineSize = serializedEngine->size();
+    header.metadataCrc = computeCrc32(metadata.data(), metadata.size());
+    header.engineCrc = computeCrc32(serializedEngine->data(), serializedEngine->size());
+
+    const std::string padding(header.engineOffset - header.metadataOffset - header.metadataSize, '\0');
+    engineFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    engineFile.write(metadata.data(), metadata.size());
+    engineFile.write(padding.data(), padding.size());
+    engineFile.write(static_cast<char*>(serializedEngine->data()), serializedEngine->size());
+    return !engineFile.fail();
+}
+
+std::string describeEngine(
+    const ICudaEngine& engine, const ModelOptions& model, const BuildOptions& build, const SystemOptions& sys)
+{
+    std::ostringstream json;
+    const auto boolToJSON = [](bool b) { return b ? "true" : "false"; };
+    // clang-format off
+    json << "{" << std::endl
+         << "  \"tensorrt\": \"" << versionToString(getInferLibVersion()) << "\"," << std::endl
+         << "  \"model\": " << toJSONString(model.baseModel.model) << "," << std::endl
+         << "  \"build\": {\"maxBatch\": " << build.maxBatch << ", \"workspaceMiB\": " << build.workspace
+         << ", \"tf32\": " << boolToJSON(build.tf32) << ", \"fp16\": " << boolToJSON(build.fp16)
+         << ", \"int8\": " << boolToJSON(build.int8) << ", \"calibration\": " << toJSONString(build.calibration)
+         << ", \"refittable\": " << boolToJSON(build.refittable) << ", \"safe\": " << boolToJSON(build.safe)
+         << ", \"dlaCore\": " << sys.DLACore << ", \"gpuFallback\": " << boolToJSON(sys.fallback) << "}," << std::endl
+         << "  \"implicitBatch\": " << boolToJSON(engine.hasImplicitBatchDimension()) << "," << std::endl
+         << "  \"plugins\": [";
+    // clang-format on
+    for (size_t p = 0; p < sys.plugins.size(); ++p)
+    {
+        json << (p ? ", " : "") << toJSONString(sys.plugins[p]);
+    }
+    json << "]," << std::endl << "  \"bindings\": [";
+    for (int b = 0; b < engine.getNbBindings(); ++b)
+    {
+        const auto dims = engine.getBindingDimensions(b);
+        const char* format = engine.getBindingFormatDesc(b);
+        json << (b ? "," : "") << std::endl
+             << "    {\"name\": " << toJSONString(engine.getBindingName(b))
+             << ", \"input\": " << boolToJSON(engine.bindingIsInput(b))
+             << ", \"type\": \"" << dataTypeToString(engine.getBindingDataType(b)) << "\", \"dims\": [";
+        for (int d = 0; d < dims.nbDims; ++d)
+        {
+            json << (d ? ", " : "") << dims.d[d];
+        }
+        json << "], \"format\": " << toJSONString(format ? format : "") << "}";
+    }
+    json << std::endl << "  ]" << std::endl << "}" << std::endl;
+    return json.str();
+}
+
 TrtUniquePtr<nvinfer1::ICudaEngine> getEngine(
     const ModelOptions& model, const BuildOptions& build, const SystemOptions& sys, std::ostream& err)
 {
@@ -687,6 +881,35 @@ TrtUniquePtr<nvinfer1::ICudaEngine> getEngine(
     {
         engine.reset(loadEngine(build.engine, sys.DLACore, err));
     }
+    else if (!build.engineCache.empty())
+    {
+        EngineCache cache(build.engineCache, static_cast<int64_t>(build.engineCacheSize) << 20);
+        const std::string key = makeEngineCacheKey(model, build, sys);
+        if (!key.empty())
+        {
+            engine.reset(cache.load(key, sys.DLACore, err));
+        }
+        const bool hit = static_cast<bool>(engine);
+        if (!hit)
+        {
+            engine.reset(modelToEngine(model, build, sys, err));
+        }
+        if (engine && !hit && !key.empty()
+            && !cache.store(*engine, key, describeEngine(*engine, model, build, sys), err))
+        {
+            sample::gLogWarning << "Engine was built but could not be added to the cache" << std::endl;
+        }
+        if (key.empty())
+        {
+            sample::gLogWarning << "Engine cache skipped: cannot read the model, calibration or plugin files"
+                                << std::endl;
+        }
+        else
+        {
+            sample::gLogInfo << "Engine cache " << (hit ? "hit" : "miss") << " for " << key << " ("
+                             << cache.getStats() << " of " << build.engineCacheSize << " MiB)" << std::endl;
+        }
+    }
     else
     {
         engine.reset(modelToEngine(model, build, sys, err));
@@ -696,7 +919,9 @@ TrtUniquePtr<nvinfer1::ICudaEngine> getEngine(
         err << "Engine creation failed" << std::endl;
         return nullptr;
     }
-    if (build.save && !saveEngine(*engine, build.engine, err))
+    if (build.save
+        && !(build.engineHeader ? saveEngineFile(*engine, build.engine, err, describeEngine(*engine, model, build, sys))
+                                : saveEngine(*engine, build.engine, err)))
     {
         err << "Saving engine to file failed" << std::endl;
         return nullptr;
@@ -17,7 +17,9 @@
 #ifndef TRT_SAMPLE_ENGINES_H
 #define TRT_SAMPLE_ENGINES_H
 
+#include <cstdint>
 #include <iostream>
+#include <string>
 
 #include "NvCaffeParser.h"
 #include "NvInfer.h"
@@ -74,19 +76,81 @@ nvinfer1::ICudaEngine* modelToEngine(
 void dumpRefittable(nvinfer1::ICudaEngine& engine);
 
 //!
-//! \brief Load a serialized engine
+//! \struct EngineFileHeader
+//! \brief Header of the engine files written by saveEngineFile, stored little-endian
+//!
+//! The header is followed by metadata, a JSON description of how the engine was built and of its bindings, and then
+//! by the serialized engine. The engine starts at a multiple of 64 bytes, so that it can be deserialized straight from
+//! a mapping of the file. Both are covered by CRC-32 checksums as computed by zlib, so that a truncated or corrupt file
+//! is detected before deserialization.
+//!
+struct EngineFileHeader
+{
+    static constexpr char kMagic[8]{'T', 'R', 'T', 'E', 'N', 'G', 'I', 'N'};
+    static constexpr uint32_t kVersion{1};
+
+    char magic[8];
+    uint32_t version;
+    uint32_t tensorrtVersion; // As returned by getInferLibVersion() when the engine was saved
+    uint64_t metadataOffset;
+    uint64_t metadataSize;
+    uint64_t engineOffset;
+    uint64_t engineSize;
+    uint32_t metadataCrc;
+    uint32_t engineCrc;
+    uint64_t reserved;
+};
+
+static_assert(sizeof(EngineFileHeader) == 64, "The engine file header layout is fixed");
+
+//!
+//! \brief Whether data starts like an engine file rather than a raw serialized engine
+//!
+bool isEngineFile(const uint8_t* data, size_t size);
+
+//!
+//! \brief Read and check the header of an engine file, and its metadata checksum
+//!
+//! \return False if the file is not an engine file, is truncated, is corrupt, or is for another version of the format
+//!
+bool readEngineFileHeader(const uint8_t* data, size_t size, EngineFileHeader& header, std::ostream& err);
+
+//!
+//! \brief CRC-32 of data, as computed by zlib
+//!
+uint32_t computeCrc32(const void* data, size_t size, uint32_t crc = 0);
+
+//!
+//! \brief Load an engine saved by saveEngineFile, or a raw serialized engine as saved by saveEngine
+//!
+//! The file is mapped and the engine deserialized from the mapping without a copy. The header, checksums and
+//! TensorRT version of an engine file are checked first.
 //!
 //! \return Pointer to the engine loaded or nullptr if the operation failed
 //!
 nvinfer1::ICudaEngine* loadEngine(const std::string& engine, int DLACore, std::ostream& err);
 
 //!
-//! \brief Save an engine into a file
+//! \brief Save the raw serialized engine to a file
 //!
 //! \return boolean Return true if the engine was successfully saved
 //!
 bool saveEngine(const nvinfer1::ICudaEngine& engine, const std::string& fileName, std::ostream& err);
 
+//!
+//! \brief Save an engine into an engine file, after a header with metadata such as made by describeEngine
+//!
+//! \return boolean Return true if the engine was successfully saved
+//!
+bool saveEngineFile(const nvinfer1::ICudaEngine& engine, const std::string& fileName, std::ostream& err,
+    const std::string& metadata = "{}");
+
+//!
+//! \brief Describe the build options, plugins and bindings of an engine in JSON, for the metadata of engine files
+//!
+std::string describeEngine(const nvinfer1::ICudaEngine& engine, const ModelOptions& model, const BuildOptions& build,
+    const SystemOptions& sys);
+
 //!
 //! \brief Create an engine from model or serialized file, and optionally save engine
 //!
@@ -17,11 +17,14 @@
 #include <algorithm>
 #include <array>
 #include <chrono>
+#include <cmath>
+#include <fstream>
 #include <functional>
 #include <limits>
 #include <memory>
 #include <mutex>
 #include <numeric>
+#include <random>
 #include <thread>
 #include <utility>
 #include <vector>
@@ -29,15 +32,57 @@
 #include "NvInfer.h"
 
 #include "logger.h"
+#include "sampleDataset.h"
 #include "sampleDevice.h"
 #include "sampleInference.h"
 #include "sampleOptions.h"
 #include "sampleReporting.h"
+#include "sampleSimulation.h"
 #include "sampleUtils.h"
 
 namespace sample
 {
 
+namespace
+{
+
+bool loadArrivalTimes(const std::string& fileName, std::vector<double>& arrivalTimes)
+{
+    std::ifstream file(fileName);
+    if (!file.is_open())
+    {
+        sample::gLogError << "Cannot open arrival times file " << fileName << std::endl;
+        return false;
+    }
+    arrivalTimes.clear();
+    double t{0};
+    while (file >> t)
+    {
+        if (!arrivalTimes.empty() && t < arrivalTimes.back())
+        {
+            sample::gLogError << "Arrival times in " << fileName << " are not in increasing order" << std::endl;
+            return false;
+        }
+        arrivalTimes.push_back(t);
+    }
+    if (!file.eof() || arrivalTimes.empty())
+    {
+        sample::gLogError << "Arrival times file " << fileName << " is empty or not a list of numbers" << std::endl;
+        return false;
+    }
+    // Replay relative to the first arrival
+    const double first = arrivalTimes.front();
+    for (auto& a : arrivalTimes)
+    {
+        a -= first;
+    }
+    return true;
+}
+
+std::unique_ptr<InferenceBackend> createTrtBackend(InferenceEnvironment& iEnv);
+
+} // namespace
+
 bool setUpInference(InferenceEnvironment& iEnv, const InferenceOptions& inference)
 {
     for (int s = 0; s < inference.streams; ++s)
@@ -151,14 +196,30 @@ bool setUpInference(InferenceEnvironment& iEnv, const InferenceOptions& inferenc
         }
     }
 
+    if (!inference.inputDataset.empty())
+    {
+        iEnv.dataset.reset(new InputDataset);
+        if (!iEnv.dataset->load(inference.inputDataset, iEnv.bindings.front()->getInputSize(), sample::gLogError))
+        {
+            return false;
+        }
+        sample::gLogInfo << "Replaying " << iEnv.dataset->getSize() << " input samples from " << inference.inputDataset
+                         << std::endl;
+    }
+
+    iEnv.backend = createTrtBackend(iEnv);
+
+    if (inference.arrivals == ArrivalProcess::kREPLAY && !loadArrivalTimes(inference.arrivalTimes, iEnv.arrivalTimes))
+    {
+        return false;
+    }
+
     return true;
 }
 
 namespace
 {
 
-using TimePoint = std::chrono::time_point<std::chrono::high_resolution_clock>;
-
 //!
 //! \struct SyncStruct
 //! \brief Threads synchronization structure
@@ -166,10 +227,7 @@ using TimePoint = std::chrono::time_point<std::chrono::high_resolution_clock>;
 struct SyncStruct
 {
     std::mutex mutex;
-    TrtCudaStream mainStream;
-    TrtCudaEvent gpuStart{cudaEventBlockingSync};
-    TimePoint cpuStart{};
-    int sleep{0};
+    TimePoint origin{};
 };
 
 struct Enqueue
@@ -275,160 +333,119 @@ using MultiEvent = std::array<std::unique_ptr<TrtCudaEvent>, static_cast<int>(Ev
 using EnqueueTimes = std::array<TimePoint, 2>;
 
 //!
-//! \class Iteration
-//! \brief Inference iteration and streams management
+//! \class TrtInferenceStream
+//! \brief Inferences of one execution context, with separate CUDA streams for input copies, compute and output copies
 //!
-class Iteration
+class TrtInferenceStream : public InferenceStream
 {
 
 public:
-    Iteration(int id, const InferenceOptions& inference, nvinfer1::IExecutionContext& context, Bindings& bindings)
+    TrtInferenceStream(const InferenceOptions& inference, nvinfer1::IExecutionContext& context, Bindings& bindings,
+        TrtCudaEvent& gpuStart, const TimePoint& cpuStart, const InputDataset* dataset, int id)
         : mBindings(bindings)
-        , mStreamId(id)
-        , mDepth(1 + inference.overlap)
-        , mActive(mDepth)
-        , mEvents(mDepth)
-        , mEnqueueTimes(mDepth)
+        , mGpuStart(gpuStart)
+        , mCpuStart(cpuStart)
+        , mEvents(1 + inference.overlap)
+        , mEnqueueTimes(1 + inference.overlap)
     {
-        for (int d = 0; d < mDepth; ++d)
+        for (auto& slotEvents : mEvents)
         {
-            for (int e = 0; e < static_cast<int>(EventType::kNUM); ++e)
+            for (auto& event : slotEvents)
             {
-                mEvents[d][e].reset(new TrtCudaEvent(!inference.spin));
+                event.reset(new TrtCudaEvent(!inference.spin));
             }
         }
+        if (dataset)
+        {
+            // One buffer per inference in flight and one more being staged
+            mFeeder.reset(new DatasetFeeder(*dataset, id, inference.streams, 2 + inference.overlap));
+        }
         createEnqueueFunction(inference, context, bindings);
+        getStream(StreamType::kINPUT).wait(gpuStart);
     }
 
-    void query(bool skipTransfers)
+    void enqueue(int slot, bool skipTransfers) override
     {
-        if (mActive[mNext])
-        {
-            return;
-        }
-
         if (!skipTransfers)
         {
-            record(EventType::kINPUT_S, StreamType::kINPUT);
-            mBindings.transferInputToDevice(getStream(StreamType::kINPUT));
-            record(EventType::kINPUT_E, StreamType::kINPUT);
-            wait(EventType::kINPUT_E, StreamType::kCOMPUTE); // Wait for input DMA before compute
+            const void* sample = mFeeder ? mFeeder->acquire() : nullptr;
+            record(slot, EventType::kINPUT_S, StreamType::kINPUT);
+            if (sample)
+            {
+                mBindings.transferInputToDevice(getStream(StreamType::kINPUT), sample);
+            }
+            else
+            {
+                mBindings.transferInputToDevice(getStream(StreamType::kINPUT));
+            }
+            record(slot, EventType::kINPUT_E, StreamType::kINPUT);
+            wait(slot, EventType::kINPUT_E, StreamType::kCOMPUTE); // Wait for input DMA before compute
         }
 
-        record(EventType::kCOMPUTE_S, StreamType::kCOMPUTE);
-        recordEnqueueTime();
+        record(slot, EventType::kCOMPUTE_S, StreamType::kCOMPUTE);
+        mEnqueueTimes[slot][0] = std::chrono::high_resolution_clock::now();
         mEnqueue(getStream(StreamType::kCOMPUTE));
-        recordEnqueueTime();
-        record(EventType::kCOMPUTE_E, StreamType::kCOMPUTE);
+        mEnqueueTimes[slot][1] = std::chrono::high_resolution_clock::now();
+        record(slot, EventType::kCOMPUTE_E, StreamType::kCOMPUTE);
 
         if (!skipTransfers)
         {
-            wait(EventType::kCOMPUTE_E, StreamType::kOUTPUT); // Wait for compute before output DMA
-            record(EventType::kOUTPUT_S, StreamType::kOUTPUT);
+            wait(slot, EventType::kCOMPUTE_E, StreamType::kOUTPUT); // Wait for compute before output DMA
+            record(slot, EventType::kOUTPUT_S, StreamType::kOUTPUT);
             mBindings.transferOutputToHost(getStream(StreamType::kOUTPUT));
-            record(EventType::kOUTPUT_E, StreamType::kOUTPUT);
+            record(slot, EventType::kOUTPUT_E, StreamType::kOUTPUT);
         }
-
-        mActive[mNext] = true;
-        moveNext();
     }
 
-    float sync(
-        const TimePoint& cpuStart, const TrtCudaEvent& gpuStart, std::vector<InferenceTrace>& trace, bool skipTransfers)
+    InferenceTrace synchronize(int slot, bool skipTransfers) override
     {
-        if (mActive[mNext])
+        getEvent(slot, skipTransfers ? EventType::kCOMPUTE_E : EventType::kOUTPUT_E).synchronize();
+        if (mFeeder)
         {
-            if (skipTransfers)
-            {
-                getEvent(EventType::kCOMPUTE_E).synchronize();
-            }
-            else
-            {
-                getEvent(EventType::kOUTPUT_E).synchronize();
-            }
-            trace.emplace_back(getTrace(cpuStart, gpuStart, skipTransfers));
-            mActive[mNext] = false;
-            return getEvent(EventType::kCOMPUTE_S) - gpuStart;
+            mFeeder->release();
         }
-        return 0;
-    }
 
-    void syncAll(
-        const TimePoint& cpuStart, const TrtCudaEvent& gpuStart, std::vector<InferenceTrace>& trace, bool skipTransfers)
-    {
-        for (int d = 0; d < mDepth; ++d)
-        {
-            sync(cpuStart, gpuStart, trace, skipTransfers);
-            moveNext();
-        }
+        const auto sinceGpuStart = [this, slot](EventType e) { return getEvent(slot, e) - mGpuStart; };
+        const auto sinceCpuStart = [this](const TimePoint& t) {
+            return std::chrono::duration<float, std::milli>(t - mCpuStart).count();
+        };
+        float is = skipTransfers ? sinceGpuStart(EventType::kCOMPUTE_S) : sinceGpuStart(EventType::kINPUT_S);
+        float ie = skipTransfers ? sinceGpuStart(EventType::kCOMPUTE_S) : sinceGpuStart(EventType::kINPUT_E);
+        float os = skipTransfers ? sinceGpuStart(EventType::kCOMPUTE_E) : sinceGpuStart(EventType::kOUTPUT_S);
+        float oe = skipTransfers ? sinceGpuStart(EventType::kCOMPUTE_E) : sinceGpuStart(EventType::kOUTPUT_E);
+        return InferenceTrace(0, 0, sinceCpuStart(mEnqueueTimes[slot][0]), sinceCpuStart(mEnqueueTimes[slot][1]), is,
+            ie, sinceGpuStart(EventType::kCOMPUTE_S), sinceGpuStart(EventType::kCOMPUTE_E), os, oe);
     }
 
-    void wait(TrtCudaEvent& gpuStart)
-    {
-        getStream(StreamType::kINPUT).wait(gpuStart);
-    }
-
-    void setInputData()
+    void setInputData() override
     {
         mBindings.transferInputToDevice(getStream(StreamType::kINPUT));
     }
 
-    void fetchOutputData()
+    void fetchOutputData() override
     {
         mBindings.transferOutputToHost(getStream(StreamType::kOUTPUT));
     }
 
 private:
-    void moveNext()
-    {
-        mNext = mDepth - 1 - mNext;
-    }
-
     TrtCudaStream& getStream(StreamType t)
     {
         return mStream[static_cast<int>(t)];
     }
 
-    TrtCudaEvent& getEvent(EventType t)
-    {
-        return *mEvents[mNext][static_cast<int>(t)];
-    }
-
-    void record(EventType e, StreamType s)
-    {
-        getEvent(e).record(getStream(s));
-    }
-
-    void recordEnqueueTime()
-    {
-        mEnqueueTimes[mNext][enqueueStart] = std::chrono::high_resolution_clock::now();
-        enqueueStart = 1 - enqueueStart;
-    }
-
-    TimePoint getEnqueueTime(bool start)
+    TrtCudaEvent& getEvent(int slot, EventType t)
     {
-        return mEnqueueTimes[mNext][start ? 0 : 1];
+        return *mEvents[slot][static_cast<int>(t)];
     }
 
-    void wait(EventType e, StreamType s)
+    void record(int slot, EventType e, StreamType s)
     {
-        getStream(s).wait(getEvent(e));
+        getEvent(slot, e).record(getStream(s));
     }
 
-    InferenceTrace getTrace(const TimePoint& cpuStart, const TrtCudaEvent& gpuStart, bool skipTransfers)
+    void wait(int slot, EventType e, StreamType s)
     {
-        float is
-            = skipTransfers ? getEvent(EventType::kCOMPUTE_S) - gpuStart : getEvent(EventType::kINPUT_S) - gpuStart;
-        float ie
-            = skipTransfers ? getEvent(EventType::kCOMPUTE_S) - gpuStart : getEvent(EventType::kINPUT_E) - gpuStart;
-        float os
-            = skipTransfers ? getEvent(EventType::kCOMPUTE_E) - gpuStart : getEvent(EventType::kOUTPUT_S) - gpuStart;
-        float oe
-            = skipTransfers ? getEvent(EventType::kCOMPUTE_E) - gpuStart : getEvent(EventType::kOUTPUT_E) - gpuStart;
-        return InferenceTrace(mStreamId,
-            std::chrono::duration<float, std::milli>(getEnqueueTime(true) - cpuStart).count(),
-            std::chrono::duration<float, std::milli>(getEnqueueTime(false) - cpuStart).count(), is, ie,
-            getEvent(EventType::kCOMPUTE_S) - gpuStart, getEvent(EventType::kCOMPUTE_E) - gpuStart, os, oe);
+        getStream(s).wait(getEvent(slot, e));
     }
 
     void createEnqueueFunction(
@@ -455,26 +472,156 @@ private:
     }
 
     Bindings& mBindings;
+    TrtCudaEvent& mGpuStart;
+    const TimePoint& mCpuStart;
 
     TrtCudaGraph mGraph;
     EnqueueFunction mEnqueue;
 
+    MultiStream mStream;
+    std::vector<MultiEvent> mEvents;
+    std::vector<EnqueueTimes> mEnqueueTimes;
+    std::unique_ptr<DatasetFeeder> mFeeder;
+};
+
+//!
+//! \class TrtInferenceBackend
+//! \brief Runs inference with the execution contexts and bindings of an InferenceEnvironment, one per stream
+//!
+class TrtInferenceBackend : public InferenceBackend
+{
+
+public:
+    explicit TrtInferenceBackend(InferenceEnvironment& iEnv)
+        : mEnv(iEnv)
+    {
+        cudaCheck(cudaGetDevice(&mDevice));
+    }
+
+    TimePoint start(int sleepMs) override
+    {
+        mSleep = sleepMs;
+        mMainStream.sleep(&mSleep);
+        mCpuStart = std::chrono::high_resolution_clock::now();
+        mGpuStart.record(mMainStream);
+        return mCpuStart + std::chrono::milliseconds(sleepMs);
+    }
+
+    void setUpThread() override
+    {
+        cudaCheck(cudaSetDevice(mDevice));
+    }
+
+    std::unique_ptr<InferenceStream> createStream(const InferenceOptions& inference, int id) override
+    {
+        return std::unique_ptr<InferenceStream>(
+            new TrtInferenceStream(inference, *mEnv.context[id], *mEnv.bindings[id], mGpuStart, mCpuStart,
+                mEnv.dataset.get(), id));
+    }
+
+private:
+    InferenceEnvironment& mEnv;
+    int mDevice{0};
+    int mSleep{0};
+    TrtCudaStream mMainStream;
+    TrtCudaEvent mGpuStart{cudaEventBlockingSync};
+    TimePoint mCpuStart{};
+};
+
+std::unique_ptr<InferenceBackend> createTrtBackend(InferenceEnvironment& iEnv)
+{
+    return std::unique_ptr<InferenceBackend>(new TrtInferenceBackend(iEnv));
+}
+
+//!
+//! \class Iteration
+//! \brief Inference iteration and streams management
+//!
+class Iteration
+{
+
+public:
+    Iteration(int id, const InferenceOptions& inference, std::unique_ptr<InferenceStream> stream)
+        : mStream(std::move(stream))
+        , mStreamId(id)
+        , mDepth(1 + inference.overlap)
+        , mOpenLoop(inference.arrivals != ArrivalProcess::kCLOSED)
+        , mActive(mDepth)
+        , mArrivals(mDepth)
+    {
+    }
+
+    //!
+    //! \brief Issue an inference, unless the oldest one is still outstanding
+    //!
+    //! \param arrivalMs The scheduled arrival of the inference in an open-loop run
+    //!
+    void query(bool skipTransfers, float arrivalMs = 0)
+    {
+        if (mActive[mNext])
+        {
+            return;
+        }
+        mArrivals[mNext] = arrivalMs;
+        mStream->enqueue(mNext, skipTransfers);
+        mActive[mNext] = true;
+        moveNext();
+    }
+
+    float sync(InferenceStatistics& statistics, bool skipTransfers)
+    {
+        if (mActive[mNext])
+        {
+            InferenceTrace trace = mStream->synchronize(mNext, skipTransfers);
+            trace.stream = mStreamId;
+            trace.arrival = mOpenLoop ? mArrivals[mNext] : trace.inStart;
+            statistics.add(trace);
+            mActive[mNext] = false;
+            return trace.computeStart;
+        }
+        return 0;
+    }
+
+    void syncAll(InferenceStatistics& statistics, bool skipTransfers)
+    {
+        for (int d = 0; d < mDepth; ++d)
+        {
+            sync(statistics, skipTransfers);
+            moveNext();
+        }
+    }
+
+    void setInputData()
+    {
+        mStream->setInputData();
+    }
+
+    void fetchOutputData()
+    {
+        mStream->fetchOutputData();
+    }
+
+private:
+    void moveNext()
+    {
+        mNext = mDepth - 1 - mNext;
+    }
+
+    std::unique_ptr<InferenceStream> mStream;
+
     int mStreamId{0};
     int mNext{0};
     int mDepth{2}; // default to double buffer to hide DMA transfers
+    bool mOpenLoop{false};
 
     std::vector<bool> mActive;
-    MultiStream mStream;
-    std::vector<MultiEvent> mEvents;
-
-    int enqueueStart{0};
-    std::vector<EnqueueTimes> mEnqueueTimes;
+    std::vector<float> mArrivals;
 };
 
 using IterationStreams = std::vector<std::unique_ptr<Iteration>>;
 
-void inferenceLoop(IterationStreams& iStreams, const TimePoint& cpuStart, const TrtCudaEvent& gpuStart, int iterations,
-    float maxDurationMs, float warmupMs, std::vector<InferenceTrace>& trace, bool skipTransfers)
+void inferenceLoop(IterationStreams& iStreams, int iterations, float maxDurationMs, float warmupMs,
+    InferenceStatistics& statistics, bool skipTransfers)
 {
     float durationMs = 0;
     int skip = 0;
@@ -487,7 +634,7 @@ void inferenceLoop(IterationStreams& iStreams, const TimePoint& cpuStart, const
         }
         for (auto& s : iStreams)
         {
-            durationMs = std::max(durationMs, s->sync(cpuStart, gpuStart, trace, skipTransfers));
+            durationMs = std::max(durationMs, s->sync(statistics, skipTransfers));
         }
         if (durationMs < warmupMs) // Warming up
         {
@@ -500,22 +647,130 @@ void inferenceLoop(IterationStreams& iStreams, const TimePoint& cpuStart, const
     }
     for (auto& s : iStreams)
     {
-        s->syncAll(cpuStart, gpuStart, trace, skipTransfers);
+        s->syncAll(statistics, skipTransfers);
+    }
+}
+
+//!
+//! \class ArrivalSchedule
+//! \brief Arrival times of the inferences of one thread in an open-loop run, in ms from the start of inference
+//!
+//! Every thread walks the same sequence of arrivals and takes every stride-th one, so the arrivals of all the threads
+//! together follow the requested process whatever the number of threads.
+//!
+class ArrivalSchedule
+{
+
+public:
+    ArrivalSchedule(const InferenceOptions& inference, const std::vector<double>& replay, int offset, int stride)
+        : mProcess(inference.arrivals)
+        , mIntervalMs(inference.arrivalRates.empty() ? 0 : 1000.0 / inference.arrivalRates.front())
+        , mReplay(replay)
+        , mIndex(offset)
+        , mStride(stride)
+    {
+    }
+
+    //!
+    //! \brief The next arrival, or infinity once a replay has run out of arrivals
+    //!
+    double next()
+    {
+        double arrival{0};
+        switch (mProcess)
+        {
+        case ArrivalProcess::kFIXED: arrival = mIndex * mIntervalMs; break;
+        case ArrivalProcess::kPOISSON:
+            for (; mGenerated <= mIndex; ++mGenerated)
+            {
+                mPoissonMs += mExponential(mGenerator) * mIntervalMs;
+            }
+            arrival = mPoissonMs;
+            break;
+        case ArrivalProcess::kREPLAY:
+            arrival = mIndex < static_cast<int64_t>(mReplay.size()) ? mReplay[mIndex]
+                                                                     : std::numeric_limits<double>::infinity();
+            break;
+        case ArrivalProcess::kCLOSED: break;
+        }
+        mIndex += mStride;
+        return arrival;
+    }
+
+private:
+    ArrivalProcess mProcess;
+    double mIntervalMs;
+    const std::vector<double>& mReplay;
+    int64_t mIndex;
+    int64_t mStride;
+
+    // Identical seeds keep the Poisson sequences of all the threads, and of successive runs, the same
+    std::mt19937_64 mGenerator{0};
+    std::exponential_distribution<double> mExponential{1.0};
+    int64_t mGenerated{0};
+    double mPoissonMs{0};
+};
+
+//!
+//! \brief Wait for a point in time, sleeping while it is far enough to not oversleep
+//!
+void waitUntil(const TimePoint& t)
+{
+    const auto spinTime = std::chrono::microseconds(200);
+    const auto now = std::chrono::high_resolution_clock::now();
+    if (t - now > spinTime)
+    {
+        std::this_thread::sleep_for(t - now - spinTime);
+    }
+    while (std::chrono::high_resolution_clock::now() < t)
+    {
+    }
+}
+
+//!
+//! \brief Issue inferences at their scheduled arrival times, round robin over the streams
+//!
+//! An inference that arrives while its stream is still busy waits for it, but later arrivals are not postponed, so
+//! the time an inference spends queued is part of its end to end latency.
+//!
+void openLoop(IterationStreams& iStreams, const TimePoint& origin, ArrivalSchedule& arrivals, int iterations,
+    float maxDurationMs, float warmupMs, InferenceStatistics& statistics, bool skipTransfers)
+{
+    int measured = 0;
+    for (size_t s = 0;; s = (s + 1) % iStreams.size())
+    {
+        const double arrivalMs = arrivals.next();
+        if (std::isinf(arrivalMs) || (measured >= iterations && arrivalMs >= maxDurationMs))
+        {
+            break;
+        }
+        measured += arrivalMs >= warmupMs;
+
+        waitUntil(origin
+            + std::chrono::duration_cast<TimePoint::duration>(std::chrono::duration<double, std::milli>(arrivalMs)));
+        iStreams[s]->sync(statistics, skipTransfers);
+        iStreams[s]->query(skipTransfers, static_cast<float>(arrivalMs));
+    }
+    for (auto& s : iStreams)
+    {
+        s->syncAll(statistics, skipTransfers);
     }
 }
 
 void inferenceExecution(const InferenceOptions& inference, InferenceEnvironment& iEnv, SyncStruct& sync, int offset,
-    int streams, int device, std::vector<InferenceTrace>& trace)
+    int streams, InferenceStatistics& statistics)
 {
     float warmupMs = static_cast<float>(inference.warmup);
     float durationMs = static_cast<float>(inference.duration) * 1000 + warmupMs;
 
-    cudaCheck(cudaSetDevice(device));
+    InferenceBackend& backend = *iEnv.backend;
+    backend.setUpThread();
 
     IterationStreams iStreams;
     for (int s = 0; s < streams; ++s)
     {
-        Iteration* iteration = new Iteration(offset + s, inference, *iEnv.context[offset], *iEnv.bindings[offset]);
+        const int id = offset + s;
+        Iteration* iteration = new Iteration(id, inference, backend.createStream(inference, id));
         if (inference.skipTransfers)
         {
             iteration->setInputData();
@@ -523,14 +778,20 @@ void inferenceExecution(const InferenceOptions& inference, InferenceEnvironment&
         iStreams.emplace_back(iteration);
     }
 
-    for (auto& s : iStreams)
+    // Copying the cleared statistics of the run gives an empty set with the same settings
+    InferenceStatistics localStatistics(statistics);
+    if (inference.arrivals == ArrivalProcess::kCLOSED)
     {
-        s->wait(sync.gpuStart);
+        inferenceLoop(
+            iStreams, inference.iterations, durationMs, warmupMs, localStatistics, inference.skipTransfers);
+    }
+    else
+    {
+        // Threads share the arrivals out, each driving a single stream
+        ArrivalSchedule arrivals(inference, iEnv.arrivalTimes, offset, inference.threads ? inference.streams : 1);
+        openLoop(iStreams, sync.origin, arrivals, inference.iterations, durationMs, warmupMs, localStatistics,
+            inference.skipTransfers);
     }
-
-    std::vector<InferenceTrace> localTrace;
-    inferenceLoop(iStreams, sync.cpuStart, sync.gpuStart, inference.iterations, durationMs, warmupMs, localTrace,
-        inference.skipTransfers);
 
     if (inference.skipTransfers)
     {
@@ -541,29 +802,41 @@ void inferenceExecution(const InferenceOptions& inference, InferenceEnvironment&
     }
 
     sync.mutex.lock();
-    trace.insert(trace.end(), localTrace.begin(), localTrace.end());
+    statistics.merge(std::move(localStatistics));
     sync.mutex.unlock();
 }
 
 inline std::thread makeThread(const InferenceOptions& inference, InferenceEnvironment& iEnv, SyncStruct& sync,
-    int thread, int streamsPerThread, int device, std::vector<InferenceTrace>& trace)
+    int thread, int streamsPerThread, InferenceStatistics& statistics)
 {
     return std::thread(inferenceExecution, std::cref(inference), std::ref(iEnv), std::ref(sync), thread,
-        streamsPerThread, device, std::ref(trace));
+        streamsPerThread, std::ref(statistics));
 }
 
 } // namespace
 
-void runInference(
-    const InferenceOptions& inference, InferenceEnvironment& iEnv, int device, std::vector<InferenceTrace>& trace)
+bool setUpSimulation(InferenceEnvironment& iEnv, const InferenceOptions& inference)
+{
+    iEnv.backend.reset(new SimulationBackend(inference.simulation));
+
+    if (inference.arrivals == ArrivalProcess::kREPLAY && !loadArrivalTimes(inference.arrivalTimes, iEnv.arrivalTimes))
+    {
+        return false;
+    }
+
+    return true;
+}
+
+void runInference(const InferenceOptions& inference, InferenceEnvironment& iEnv, InferenceStatistics& statistics)
 {
-    trace.resize(0);
+    statistics.clear();
 
     SyncStruct sync;
-    sync.sleep = inference.sleep;
-    sync.mainStream.sleep(&sync.sleep);
-    sync.cpuStart = std::chrono::high_resolution_clock::now();
-    sync.gpuStart.record(sync.mainStream);
+    sync.origin = iEnv.backend->start(inference.sleep);
+    if (statistics.getTimeline())
+    {
+        statistics.getTimeline()->startRun(sync.origin);
+    }
 
     int threadsNum = inference.threads ? inference.streams : 1;
     int streamsPerThread = inference.streams / threadsNum;
@@ -571,15 +844,12 @@ void runInference(
     std::vector<std::thread> threads;
     for (int t = 0; t < threadsNum; ++t)
     {
-        threads.emplace_back(makeThread(inference, iEnv, sync, t, streamsPerThread, device, trace));
+        threads.emplace_back(makeThread(inference, iEnv, sync, t, streamsPerThread, statistics));
     }
     for (auto& th : threads)
     {
         th.join();
     }
-
-    auto cmpTrace = [](const InferenceTrace& a, const InferenceTrace& b) { return a.inStart < b.inStart; };
-    std::sort(trace.begin(), trace.end(), cmpTrace);
 }
 
 } // namespace sample
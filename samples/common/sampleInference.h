@@ -17,6 +17,7 @@
 #ifndef TRT_SAMPLE_INFERENCE_H
 #define TRT_SAMPLE_INFERENCE_H
 
+#include <chrono>
 #include <iostream>
 #include <memory>
 #include <string>
@@ -24,18 +25,86 @@
 
 #include "NvInfer.h"
 
+#include "sampleDataset.h"
 #include "sampleReporting.h"
 #include "sampleUtils.h"
 
 namespace sample
 {
 
+using TimePoint = std::chrono::time_point<std::chrono::high_resolution_clock>;
+
+//!
+//! \class InferenceStream
+//! \brief A stream of inferences run by an InferenceBackend, with several inferences in flight
+//!
+//! Inferences are identified by the slot they occupy, from 0 to the depth of the stream. A slot is reused only after
+//! its inference has been synchronized.
+//!
+class InferenceStream
+{
+public:
+    virtual ~InferenceStream() = default;
+
+    //!
+    //! \brief Issue the input copy, compute and output copy of the inference in slot, without waiting for them
+    //!
+    virtual void enqueue(int slot, bool skipTransfers) = 0;
+
+    //!
+    //! \brief Wait for the inference in slot to complete and return its timing
+    //!
+    //! Times are in ms from the start of the run. The stream and arrival of the trace are left to the caller.
+    //!
+    virtual InferenceTrace synchronize(int slot, bool skipTransfers) = 0;
+
+    //!
+    //! \brief Copy the inputs once, for runs that skip transfers
+    //!
+    virtual void setInputData() = 0;
+
+    //!
+    //! \brief Copy the outputs once, for runs that skip transfers
+    //!
+    virtual void fetchOutputData() = 0;
+};
+
+//!
+//! \class InferenceBackend
+//! \brief Executes the inferences scheduled by runInference
+//!
+class InferenceBackend
+{
+public:
+    virtual ~InferenceBackend() = default;
+
+    //!
+    //! \brief Start the clock of a run. Inferences do not begin before sleepMs have passed.
+    //!
+    //! \return The host time that time 0 of the traces corresponds to
+    //!
+    virtual TimePoint start(int sleepMs) = 0;
+
+    //!
+    //! \brief Prepare a thread that drives streams, such as by selecting the device
+    //!
+    virtual void setUpThread() = 0;
+
+    //!
+    //! \brief Create stream id of a run. Called after start(), by the thread that drives the stream.
+    //!
+    virtual std::unique_ptr<InferenceStream> createStream(const InferenceOptions& inference, int id) = 0;
+};
+
 struct InferenceEnvironment
 {
     TrtUniquePtr<nvinfer1::ICudaEngine> engine;
     std::unique_ptr<Profiler> profiler;
     std::vector<TrtUniquePtr<nvinfer1::IExecutionContext>> context;
     std::vector<std::unique_ptr<Bindings>> bindings;
+    std::unique_ptr<InferenceBackend> backend;
+    std::vector<double> arrivalTimes; // Replayed by ArrivalProcess::kREPLAY, in ms from the first arrival
+    std::unique_ptr<InputDataset> dataset; // Replayed instead of the inputs of the bindings, if set
 };
 
 //!
@@ -44,10 +113,16 @@ struct InferenceEnvironment
 bool setUpInference(InferenceEnvironment& iEnv, const InferenceOptions& inference);
 
 //!
-//! \brief Run inference and collect timing
+//! \brief Set up a CPU simulation of inference instead of an engine, as described by inference.simulation
+//!
+bool setUpSimulation(InferenceEnvironment& iEnv, const InferenceOptions& inference);
+
+//!
+//! \brief Run inference and collect timing. The statistics are cleared first.
+//!
+//! An open-loop run with fixed or Poisson arrivals offers the first of inference.arrivalRates.
 //!
-void runInference(
-    const InferenceOptions& inference, InferenceEnvironment& iEnv, int device, std::vector<InferenceTrace>& trace);
+void runInference(const InferenceOptions& inference, InferenceEnvironment& iEnv, InferenceStatistics& statistics);
 
 } // namespace sample
 
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <fstream>
+
+#if defined(_WIN32)
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "sampleMappedFile.h"
+
+namespace sample
+{
+
+std::unique_ptr<MappedInputFile> MappedInputFile::open(const std::string& fileName)
+{
+    std::unique_ptr<MappedInputFile> file(new MappedInputFile);
+#if defined(_WIN32)
+    std::ifstream stream(fileName, std::ios::in | std::ios::binary);
+    if (!stream.is_open())
+    {
+        return nullptr;
+    }
+    file->mCopy.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+    file->mData = file->mCopy.data();
+    file->mSize = file->mCopy.size();
+#else
+    const int fd = ::open(fileName.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return nullptr;
+    }
+    struct stat status;
+    if (fstat(fd, &status) != 0)
+    {
+        close(fd);
+        return nullptr;
+    }
+    file->mSize = static_cast<size_t>(status.st_size);
+    if (file->mSize)
+    {
+        void* data = mmap(nullptr, file->mSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED)
+        {
+            close(fd);
+            return nullptr;
+        }
+        file->mData = static_cast<const uint8_t*>(data);
+    }
+    close(fd);
+#endif
+    return file;
+}
+
+MappedInputFile::~MappedInputFile()
+{
+#if !defined(_WIN32)
+    if (mData)
+    {
+        munmap(const_cast<uint8_t*>(mData), mSize);
+    }
+#endif
+}
+
+} // namespace sample
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TRT_SAMPLE_MAPPED_FILE_H
+#define TRT_SAMPLE_MAPPED_FILE_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace sample
+{
+
+//!
+//! \class MappedInputFile
+//! \brief Read-only memory mapping of a whole file
+//!
+class MappedInputFile
+{
+public:
+    //!
+    //! \brief Map a file, or return nullptr if it cannot be opened or mapped
+    //!
+    static std::unique_ptr<MappedInputFile> open(const std::string& fileName);
+
+    ~MappedInputFile();
+
+    MappedInputFile(const MappedInputFile&) = delete;
+    MappedInputFile& operator=(const MappedInputFile&) = delete;
+
+    const uint8_t* data() const
+    {
+        return mData;
+    }
+
+    size_t size() const
+    {
+        return mSize;
+    }
+
+private:
+    MappedInputFile() = default;
+
+    const uint8_t* mData{nullptr};
+    size_t mSize{0};
+    std::vector<uint8_t> mCopy; // Contents of the file where it cannot be mapped
+};
+
+} // namespace sample
+
+#endif // TRT_SAMPLE_MAPPED_FILE_H
@@ -18,6 +18,7 @@
 #include <cstring>
 #include <functional>
 #include <iostream>
+#include <sstream>
 #include <stdexcept>
 #include <string>
 #include <vector>
@@ -87,6 +88,17 @@ std::vector<int> stringToValue<std::vector<int>>(const std::string& option)
     return shape;
 }
 
+template <>
+std::vector<float> stringToValue<std::vector<float>>(const std::string& option)
+{
+    std::vector<float> values;
+    for (const auto& v : splitToStringVec(option, ','))
+    {
+        values.push_back(stringToValue<float>(v));
+    }
+    return values;
+}
+
 template <>
 nvinfer1::DataType stringToValue<nvinfer1::DataType>(const std::string& option)
 {
@@ -174,6 +186,17 @@ const char* boolToEnabled(bool enable)
     return enable ? "Enabled" : "Disabled";
 }
 
+template <typename T>
+std::string joinValuesToString(const std::vector<T>& values, const std::string& separator)
+{
+    std::ostringstream os;
+    for (size_t i = 0; i < values.size(); ++i)
+    {
+        os << (i ? separator : "") << values[i];
+    }
+    return os.str();
+}
+
 template <typename T>
 bool checkEraseOption(Arguments& arguments, const std::string& option, T& value)
 {
@@ -597,6 +620,17 @@ void BuildOptions::parse(Arguments& arguments)
     {
         throw std::invalid_argument("Incompatible load and save engine options selected");
     }
+    checkEraseOption(arguments, "--engineHeader", engineHeader);
+    if (engineHeader && !save)
+    {
+        throw std::invalid_argument("--engineHeader requires --saveEngine");
+    }
+    checkEraseOption(arguments, "--engineCache", engineCache);
+    checkEraseOption(arguments, "--engineCacheSize", engineCacheSize);
+    if (load && !engineCache.empty())
+    {
+        throw std::invalid_argument("Incompatible load engine and engine cache options selected");
+    }
 
     std::string tacticSourceArgs;
     if (checkEraseOption(arguments, "--tacticSources", tacticSourceArgs))
@@ -683,9 +717,71 @@ void InferenceOptions::parse(Arguments& arguments)
     checkEraseOption(arguments, "--loadInputs", list);
     std::vector<std::string> inputsList{splitToStringVec(list, ',')};
     splitInsertKeyValue(inputsList, inputs);
+    checkEraseOption(arguments, "--inputDataset", inputDataset);
 
     getShapesInference(arguments, shapes, "--shapes");
 
+    checkEraseOption(arguments, "--arrivalRate", arrivalRates);
+    checkEraseOption(arguments, "--arrivalTimes", arrivalTimes);
+    std::string arrivalsString;
+    checkEraseOption(arguments, "--arrivals", arrivalsString);
+    if (!arrivalTimes.empty())
+    {
+        if (!arrivalRates.empty() || !arrivalsString.empty())
+        {
+            throw std::invalid_argument("--arrivalTimes replays its own arrivals and cannot be combined with "
+                                        "--arrivalRate or --arrivals");
+        }
+        arrivals = ArrivalProcess::kREPLAY;
+    }
+    else if (!arrivalRates.empty())
+    {
+        if (arrivalsString.empty() || arrivalsString == "fixed")
+        {
+            arrivals = ArrivalProcess::kFIXED;
+        }
+        else if (arrivalsString == "poisson")
+        {
+            arrivals = ArrivalProcess::kPOISSON;
+        }
+        else
+        {
+            throw std::invalid_argument(std::string("Unknown arrival process ") + arrivalsString);
+        }
+        for (const auto rate : arrivalRates)
+        {
+            if (rate <= 0)
+            {
+                throw std::invalid_argument(std::string("Arrival rate ") + std::to_string(rate) + " is not positive");
+            }
+        }
+    }
+    else if (!arrivalsString.empty())
+    {
+        throw std::invalid_argument("--arrivals requires --arrivalRate");
+    }
+
+    std::vector<float> simulationTimes;
+    if (checkEraseOption(arguments, "--simulate", simulationTimes))
+    {
+        if (simulationTimes.empty() || simulationTimes.size() > 3
+            || std::any_of(simulationTimes.begin(), simulationTimes.end(), [](float t) { return t < 0; }))
+        {
+            throw std::invalid_argument("--simulate takes one to three times that are not negative");
+        }
+        simulationTimes.resize(3, 0);
+        simulation.enabled = true;
+        simulation.computeMs = simulationTimes[0];
+        simulation.inputMs = simulationTimes[1];
+        simulation.outputMs = simulationTimes[2];
+    }
+
+    if (!inputDataset.empty() && (!inputs.empty() || skipTransfers || simulation.enabled))
+    {
+        throw std::invalid_argument(
+            "--inputDataset cannot be combined with --loadInputs, --noDataTransfers or --simulate");
+    }
+
     int batchOpt{0};
     checkEraseOption(arguments, "--batch", batchOpt);
     if (!shapes.empty() && batchOpt)
@@ -708,7 +804,7 @@ void InferenceOptions::parse(Arguments& arguments)
 
 void ReportingOptions::parse(Arguments& arguments)
 {
-    checkEraseOption(arguments, "--percentile", percentile);
+    checkEraseOption(arguments, "--percentile", percentiles);
     checkEraseOption(arguments, "--avgRuns", avgs);
     checkEraseOption(arguments, "--verbose", verbose);
     checkEraseOption(arguments, "--dumpRefit", refit);
@@ -716,10 +812,15 @@ void ReportingOptions::parse(Arguments& arguments)
     checkEraseOption(arguments, "--dumpProfile", profile);
     checkEraseOption(arguments, "--exportTimes", exportTimes);
     checkEraseOption(arguments, "--exportOutput", exportOutput);
+    checkEraseOption(arguments, "--exportOutputNpy", exportOutputNpy);
     checkEraseOption(arguments, "--exportProfile", exportProfile);
-    if (percentile < 0 || percentile > 100)
+    checkEraseOption(arguments, "--exportTimeline", exportTimeline);
+    for (const auto percentile : percentiles)
     {
-        throw std::invalid_argument(std::string("Percentile ") + std::to_string(percentile) + "is not in [0,100]");
+        if (percentile < 0 || percentile > 100)
+        {
+            throw std::invalid_argument(std::string("Percentile ") + std::to_string(percentile) + " is not in [0,100]");
+        }
     }
 }
 
@@ -800,7 +901,7 @@ void AllOptions::parse(Arguments& arguments)
 
     if (!helps)
     {
-        if (!build.load && model.baseModel.format == ModelFormat::kANY)
+        if (!build.load && !inference.simulation.enabled && model.baseModel.format == ModelFormat::kANY)
         {
             throw std::invalid_argument("Model missing or format not recognized");
         }
@@ -1034,7 +1135,10 @@ std::ostream& operator<<(std::ostream& os, const BuildOptions& options)
           "Refit: "          << boolToEnabled(options.refittable)                                                       << std::endl <<
           "Safe mode: "      << boolToEnabled(options.safe)                                                             << std::endl <<
           "Save engine: "    << (options.save ? options.engine : "")                                                    << std::endl <<
+          "Engine header: "  << boolToEnabled(options.engineHeader)                                                     << std::endl <<
           "Load engine: "    << (options.load ? options.engine : "")                                                    << std::endl <<
+          "Engine cache: "   << options.engineCache << (options.engineCache.empty() ? "" : " (")
+                             << (options.engineCache.empty() ? "" : std::to_string(options.engineCacheSize) + " MiB)") << std::endl <<
           "Builder Cache: "  << boolToEnabled(options.builderCache)                                                     << std::endl <<
           "NVTX verbosity: " << static_cast<int>(options.nvtxMode)                                                      << std::endl <<
           "Tactic sources: ";   printTacticSources(os, options.enabledTactics, options.disabledTactics)                 << std::endl;
@@ -1108,7 +1212,23 @@ std::ostream& operator<<(std::ostream& os, const InferenceOptions& options)
           "Multithreading: "      << boolToEnabled(options.threads)        << std::endl <<
           "CUDA Graph: "          << boolToEnabled(options.graph)          << std::endl <<
           "Separate profiling: "  << boolToEnabled(options.rerun)          << std::endl <<
-          "Skip inference: "      << boolToEnabled(options.skip)           << std::endl;
+          "Skip inference: "      << boolToEnabled(options.skip)           << std::endl <<
+          "Arrivals: ";
+    switch (options.arrivals)
+    {
+    case ArrivalProcess::kCLOSED:  os << "Closed loop"                                                    << std::endl; break;
+    case ArrivalProcess::kFIXED:   os << "Fixed rate of " << joinValuesToString(options.arrivalRates, ",")
+                                      << " inferences/s"                                                  << std::endl; break;
+    case ArrivalProcess::kPOISSON: os << "Poisson at " << joinValuesToString(options.arrivalRates, ",")
+                                      << " inferences/s"                                                  << std::endl; break;
+    case ArrivalProcess::kREPLAY:  os << "Replay of " << options.arrivalTimes                             << std::endl; break;
+    }
+    if (options.simulation.enabled)
+    {
+        os << "Simulation: "          << options.simulation.computeMs << "ms compute, "
+                                      << options.simulation.inputMs   << "ms input copy, "
+                                      << options.simulation.outputMs  << "ms output copy"             << std::endl;
+    }
 
     // clang-format on
     os << "Inputs:" << std::endl;
@@ -1116,6 +1236,10 @@ std::ostream& operator<<(std::ostream& os, const InferenceOptions& options)
     {
         os << input.first << "<-" << input.second << std::endl;
     }
+    if (!options.inputDataset.empty())
+    {
+        os << "Input dataset: " << options.inputDataset << std::endl;
+    }
 
     return os;
 }
@@ -1127,13 +1251,15 @@ std::ostream& operator<<(std::ostream& os, const ReportingOptions& options)
 
           "Verbose: "                          << boolToEnabled(options.verbose)    << std::endl <<
           "Averages: "                         << options.avgs << " inferences"     << std::endl <<
-          "Percentile: "                       << options.percentile                << std::endl <<
+          "Percentiles: "                      << joinValuesToString(options.percentiles, ",") << std::endl <<
           "Dump refittable layers:"            << boolToEnabled(options.refit)      << std::endl <<
           "Dump output: "                      << boolToEnabled(options.output)     << std::endl <<
           "Profile: "                          << boolToEnabled(options.profile)    << std::endl <<
           "Export timing to JSON file: "       << options.exportTimes               << std::endl <<
           "Export output to JSON file: "       << options.exportOutput              << std::endl <<
-          "Export profile to JSON file: "      << options.exportProfile             << std::endl;
+          "Export output to NPY files: "       << options.exportOutputNpy           << std::endl <<
+          "Export profile to JSON file: "      << options.exportProfile             << std::endl <<
+          "Export timeline to JSON file: "     << options.exportTimeline            << std::endl;
     // clang-format on
 
     return os;
@@ -1228,7 +1354,12 @@ void BuildOptions::help(std::ostream& os)
           "  --calib=<file>              Read INT8 calibration cache file"                                                                   << std::endl <<
           "  --safe                      Only test the functionality available in safety restricted flows"                                   << std::endl <<
           "  --saveEngine=<file>         Save the serialized engine"                                                                         << std::endl <<
-          "  --loadEngine=<file>         Load a serialized engine"                                                                           << std::endl <<
+          "  --engineHeader              Save the engine after a header that describes it and checksums it (default = disabled)"             << std::endl <<
+          "  --loadEngine=<file>         Load a serialized engine, with or without a header"                                                 << std::endl <<
+          "  --engineCache=<dir>         Reuse engines built from the same model files and build options, keeping them in dir"               << std::endl <<
+          "                              Entries are shared safely by concurrent runs, and hits and misses are counted across runs."         << std::endl <<
+          "  --engineCacheSize=N         Evict the least recently used engines from the cache beyond N megabytes (default = "
+                                                                                                     << defaultEngineCacheSize << ")"        << std::endl <<
           "  --tacticSources=tactics     Specify the tactics to be used by adding (+) or removing (-) tactics from the default "             << std::endl <<
           "                              tactic sources (default = all available tactics)."                                                  << std::endl <<
           "                              Note: Currently only cuBLAS and cuBLAS LT are listed as optional tactics."                          << std::endl <<
@@ -1267,6 +1398,9 @@ void InferenceOptions::help(std::ostream& os)
                                                                                        "wrapped with single quotes (ex: 'Input:0')" << std::endl <<
           "                              Input values spec ::= Ival[\",\"spec]"                                                     << std::endl <<
           "                                           Ival ::= name\":\"file"                                                       << std::endl <<
+          "  --inputDataset=<path>       Replay input samples from a file, or a directory with a file per sample, cycling"          << std::endl <<
+          "                              through them across iterations (default = same inputs in every iteration)."                << std::endl <<
+          "                              A sample holds all the inputs one after the other, in binding order"                       << std::endl <<
           "  --iterations=N              Run at least N inference iterations (default = "               << defaultIterations << ")" << std::endl <<
           "  --warmUp=N                  Run for N milliseconds to warmup before measuring performance (default = "
                                                                                                             << defaultWarmUp << ")" << std::endl <<
@@ -1283,7 +1417,15 @@ void InferenceOptions::help(std::ostream& os)
           "  --useCudaGraph              Use cuda graph to capture engine execution and then launch inference (default = disabled)" << std::endl <<
           "  --separateProfileRun        Do not attach the profiler in the benchmark run; if profiling is enabled, a second "
                                                                                 "profile run will be executed (default = disabled)" << std::endl <<
-          "  --buildOnly                 Skip inference perf measurement (default = disabled)"                                      << std::endl;
+          "  --buildOnly                 Skip inference perf measurement (default = disabled)"                                      << std::endl <<
+          "  --arrivalRate=R[,R]*        Run open loop: issue R inferences per second whether or not earlier ones have completed,"  << std::endl <<
+          "                              and measure end to end latency from the scheduled arrival of each inference."              << std::endl <<
+          "                              Several rates run one after the other and report latency against offered load"             << std::endl <<
+          "                              (default = closed loop, each stream issues when its previous inference completes)"         << std::endl <<
+          "  --arrivals=fixed|poisson    Space open-loop arrivals evenly or as a Poisson process (default = fixed)"                 << std::endl <<
+          "  --arrivalTimes=<file>       Run open loop with the arrival times in file, in milliseconds separated by whitespace"     << std::endl <<
+          "  --simulate=C[,I[,O]]        Do not build or load an engine, and simulate on the CPU an engine that computes in C ms"   << std::endl <<
+          "                              and copies inputs and outputs in I and O ms, to measure the harness itself"                << std::endl;
     // clang-format on
 }
 
@@ -1294,9 +1436,9 @@ void ReportingOptions::help(std::ostream& os)
           "  --verbose                   Use verbose logging (default = false)"                          << std::endl <<
           "  --avgRuns=N                 Report performance measurements averaged over N consecutive "
                                                        "iterations (default = " << defaultAvgRuns << ")" << std::endl <<
-          "  --percentile=P              Report performance for the P percentage (0<=P<=100, 0 "
-                                        "representing max perf, and 100 representing min perf; (default"
-                                                                      " = " << defaultPercentile << "%)" << std::endl <<
+          "  --percentile=P[,P]*         Report performance for the P percentage (0<=P<=100, 0 "
+                                        "representing max perf, and 100 representing min perf), e.g. "
+                                        "50,90,99,99.9 (default = " << defaultPercentile << "%)"         << std::endl <<
           "  --dumpRefit                 Print the refittable layers and weights from a refittable "
                                         "engine"                                                         << std::endl <<
           "  --dumpOutput                Print the output tensor(s) of the last inference iteration "
@@ -1304,8 +1446,12 @@ void ReportingOptions::help(std::ostream& os)
           "  --dumpProfile               Print profile information per layer (default = disabled)"       << std::endl <<
           "  --exportTimes=<file>        Write the timing results in a json file (default = disabled)"   << std::endl <<
           "  --exportOutput=<file>       Write the output tensors to a json file (default = disabled)"   << std::endl <<
+          "  --exportOutputNpy=<prefix>  Write each output tensor to the NPY file <prefix><name>.npy, as is "
+                                                                                  "(default = disabled)" << std::endl <<
           "  --exportProfile=<file>      Write the profile information per layer in a json file "
-                                                                              "(default = disabled)"     << std::endl;
+                                                                              "(default = disabled)"     << std::endl <<
+          "  --exportTimeline=<file>     Write the inferences and layers as a timeline in Chrome trace "
+                                          "format, for chrome://tracing or Perfetto (default = disabled)" << std::endl;
     // clang-format on
 }
 
@@ -36,6 +36,7 @@ constexpr int defaultMaxBatch{1};
 constexpr int defaultWorkspace{16};
 constexpr int defaultMinTiming{1};
 constexpr int defaultAvgTiming{8};
+constexpr int defaultEngineCacheSize{4096};
 
 // System default params
 constexpr int defaultDevice{0};
@@ -60,6 +61,25 @@ enum class ModelFormat
     kUFF
 };
 
+enum class ArrivalProcess
+{
+    kCLOSED,  // Each stream issues a query as soon as its previous one completes
+    kFIXED,   // Open loop, evenly spaced arrivals
+    kPOISSON, // Open loop, exponentially distributed gaps between arrivals
+    kREPLAY   // Open loop, arrivals read from a file
+};
+
+//!
+//! \brief Stage times of the CPU simulation that replaces the engine in --simulate runs
+//!
+struct SimulationOptions
+{
+    bool enabled{false};
+    float computeMs{0};
+    float inputMs{0};  // Host to device copy
+    float outputMs{0}; // Device to host copy
+};
+
 using Arguments = std::unordered_multimap<std::string, std::string>;
 
 using IOFormat = std::pair<nvinfer1::DataType, nvinfer1::TensorFormats>;
@@ -116,10 +136,13 @@ struct BuildOptions : public Options
     bool safe{false};
     bool save{false};
     bool load{false};
+    bool engineHeader{false};
     bool builderCache{true};
     nvinfer1::ProfilingVerbosity nvtxMode{nvinfer1::ProfilingVerbosity::kDEFAULT};
     std::string engine;
     std::string calibration;
+    std::string engineCache;
+    int engineCacheSize{defaultEngineCacheSize}; // MiB
     std::unordered_map<std::string, ShapeRange> shapes;
     std::unordered_map<std::string, ShapeRange> shapesCalib;
     std::vector<IOFormat> inputFormats;
@@ -159,7 +182,12 @@ struct InferenceOptions : public Options
     bool skip{false};
     bool rerun{false};
     std::unordered_map<std::string, std::string> inputs;
+    std::string inputDataset;
     std::unordered_map<std::string, std::vector<int>> shapes;
+    ArrivalProcess arrivals{ArrivalProcess::kCLOSED};
+    std::vector<float> arrivalRates; // Inferences per second, one open-loop run per rate
+    std::string arrivalTimes;
+    SimulationOptions simulation;
 
     void parse(Arguments& arguments) override;
 
@@ -170,13 +198,15 @@ struct ReportingOptions : public Options
 {
     bool verbose{false};
     int avgs{defaultAvgRuns};
-    float percentile{defaultPercentile};
+    std::vector<float> percentiles{defaultPercentile};
     bool refit{false};
     bool output{false};
     bool profile{false};
     std::string exportTimes;
     std::string exportOutput;
+    std::string exportOutputNpy;
     std::string exportProfile;
+    std::string exportTimeline;
 
     void parse(Arguments& arguments) override;
 
@@ -15,10 +15,14 @@
  */
 
 #include <algorithm>
+#include <cctype>
+#include <cmath>
 #include <fstream>
+#include <functional>
 #include <iomanip>
 #include <iostream>
 #include <numeric>
+#include <sstream>
 #include <utility>
 
 #include "sampleInference.h"
@@ -33,189 +37,506 @@ namespace sample
 namespace
 {
 
-//!
-//! \brief Find percentile in an ascending sequence of timings
-//!
-template <typename T>
-float findPercentile(float percentage, const std::vector<InferenceTime>& timings, const T& toFloat)
+const char* toNpyType(nvinfer1::DataType dataType)
 {
-    const int all = static_cast<int>(timings.size());
-    const int exclude = static_cast<int>((1 - percentage / 100) * all);
-    if (0 <= exclude && exclude <= all)
+    switch (dataType)
     {
-        return toFloat(timings[std::max(all - 1 - exclude, 0)]);
+    case nvinfer1::DataType::kFLOAT: return "<f4";
+    case nvinfer1::DataType::kHALF: return "<f2";
+    case nvinfer1::DataType::kINT8: return "|i1";
+    case nvinfer1::DataType::kINT32: return "<i4";
+    case nvinfer1::DataType::kBOOL: return "|b1";
     }
-    return std::numeric_limits<float>::infinity();
+    return "|u1";
 }
 
 //!
-//! \brief Find median in a sorted sequence of timings
+//! \brief Header of an NPY 1.0 file, padded for the data to start at a multiple of 64 bytes
 //!
-template <typename T>
-float findMedian(const std::vector<InferenceTime>& timings, const T& toFloat)
+std::string makeNpyHeader(const char* type, const std::vector<int64_t>& shape)
 {
-    if (timings.empty())
+    std::ostringstream dict;
+    dict << "{'descr': '" << type << "', 'fortran_order': False, 'shape': (";
+    for (const auto d : shape)
     {
-        return std::numeric_limits<float>::infinity();
+        dict << d << ",";
     }
+    dict << "), }";
 
-    const int m = timings.size() / 2;
-    if (timings.size() % 2)
-    {
-        return toFloat(timings[m]);
-    }
+    constexpr size_t kPreamble{10};
+    std::string header = dict.str();
+    header.append(63 - (kPreamble + header.size()) % 64, ' ');
+    header += '\n';
 
-    return (toFloat(timings[m - 1]) + toFloat(timings[m])) / 2;
+    const auto length = static_cast<uint16_t>(header.size());
+    const char preamble[kPreamble]
+        = {'\x93', 'N', 'U', 'M', 'P', 'Y', 1, 0, static_cast<char>(length & 0xFF), static_cast<char>(length >> 8)};
+    return std::string(preamble, kPreamble) + header;
 }
 
 inline InferenceTime traceToTiming(const InferenceTrace& a)
 {
     return InferenceTime((a.enqEnd - a.enqStart), (a.inEnd - a.inStart), (a.computeEnd - a.computeStart),
-        (a.outEnd - a.outStart), (a.outEnd - a.inStart));
+        (a.outEnd - a.outStart), (a.outEnd - a.arrival));
 };
 
 } // namespace
 
-void printProlog(int warmups, int timings, float warmupMs, float benchTimeMs, std::ostream& os)
+int LatencyHistogram::toBucket(uint64_t ns)
 {
-    os << "Warmup completed " << warmups << " queries over " << warmupMs << " ms" << std::endl;
-    os << "Timing trace has " << timings << " queries over " << benchTimeMs / 1000 << " s" << std::endl;
+    ns = std::min(ns, (uint64_t(1) << kMaxBits) - 1);
+    if (ns < kSubBuckets)
+    {
+        return static_cast<int>(ns);
+    }
+    // Each power of two from kSubBuckets up is split into kSubBuckets buckets of equal width
+    int msb = 0;
+    while (ns >> (msb + 1))
+    {
+        ++msb;
+    }
+    const int shift = msb - kSubBucketBits;
+    return ((shift + 1) << kSubBucketBits) + static_cast<int>((ns >> shift) - kSubBuckets);
+}
+
+float LatencyHistogram::bucketMidpointMs(int bucket)
+{
+    if (bucket < kSubBuckets)
+    {
+        return bucket * 1e-6F;
+    }
+    const int shift = (bucket >> kSubBucketBits) - 1;
+    const uint64_t lower = static_cast<uint64_t>((bucket & (kSubBuckets - 1)) + kSubBuckets) << shift;
+    return static_cast<float>((lower + (uint64_t(1) << shift) / 2) * 1e-6);
+}
+
+void LatencyHistogram::add(float ms)
+{
+    const uint64_t ns = ms > 0 ? static_cast<uint64_t>(static_cast<double>(ms) * 1e6 + 0.5) : 0;
+    const int bucket = toBucket(ns);
+    if (bucket >= static_cast<int>(mCounts.size()))
+    {
+        mCounts.resize(bucket + 1);
+    }
+    ++mCounts[bucket];
+    // Welford's update of the squared deviations
+    const double delta = ms - (mCount ? mSum / mCount : 0.0);
+    ++mCount;
+    mSum += ms;
+    mSquares += delta * (ms - mSum / mCount);
+    mMin = std::min(mMin, ms);
+    mMax = std::max(mMax, ms);
 }
 
-void printTiming(const std::vector<InferenceTime>& timings, int runsPerAvg, std::ostream& os)
+void LatencyHistogram::merge(const LatencyHistogram& other)
 {
-    int count = 0;
-    InferenceTime sum;
+    if (!other.mCount)
+    {
+        return;
+    }
+    if (mCounts.size() < other.mCounts.size())
+    {
+        mCounts.resize(other.mCounts.size());
+    }
+    std::transform(
+        other.mCounts.begin(), other.mCounts.end(), mCounts.begin(), mCounts.begin(), std::plus<int64_t>());
+    // Chan's combination of the squared deviations of two sets
+    if (mCount)
+    {
+        const double delta = other.mSum / other.mCount - mSum / mCount;
+        mSquares += other.mSquares + delta * delta * mCount * other.mCount / (mCount + other.mCount);
+    }
+    else
+    {
+        mSquares = other.mSquares;
+    }
+    mCount += other.mCount;
+    mSum += other.mSum;
+    mMin = std::min(mMin, other.mMin);
+    mMax = std::max(mMax, other.mMax);
+}
+
+float LatencyHistogram::getPercentile(float percentage) const
+{
+    if (!mCount)
+    {
+        return std::numeric_limits<float>::infinity();
+    }
+    // Same rank as picking from the sorted values: the percentage % smallest values, at least one
+    const int64_t exclude = static_cast<int64_t>((1 - percentage / 100) * mCount);
+    const int64_t rank = std::max<int64_t>(mCount - 1 - exclude, 0);
+    if (rank == 0)
+    {
+        return mMin;
+    }
+    if (rank == mCount - 1)
+    {
+        return mMax;
+    }
+    int64_t seen = 0;
+    for (int b = 0; b < static_cast<int>(mCounts.size()); ++b)
+    {
+        seen += mCounts[b];
+        if (seen > rank)
+        {
+            return std::min(std::max(bucketMidpointMs(b), mMin), mMax);
+        }
+    }
+    return mMax;
+}
 
-    os << "Trace averages of " << runsPerAvg << " runs:" << std::endl;
-    for (const auto& t : timings)
+void InferenceStatistics::add(const InferenceTrace& trace)
+{
+    if (mKeepTrace)
+    {
+        mTrace.push_back(trace);
+    }
+    if (mTimeline)
+    {
+        mTimeline->addTrace(trace);
+    }
+    if (trace.computeStart < mWarmupMs)
     {
-        sum += t;
+        ++mWarmups;
+        return;
+    }
+
+    const InferenceTime t = traceToTiming(trace);
+    mLatency.add(t.latency());
+    mEndToEnd.add(t.e2e);
+    mCompute.add(t.compute);
+    mEnqueue.add(t.enq);
+    mStartMs = std::min(mStartMs, trace.inStart);
+    mEndMs = std::max(mEndMs, trace.outEnd);
 
-        if (++count == runsPerAvg)
+    if (mRunsPerAvg <= 0)
+    {
+        return;
+    }
+    if (!mCurrentAverageCount)
+    {
+        mCurrentAverage.startMs = trace.inStart;
+    }
+    mCurrentAverage.sum += t;
+    if (++mCurrentAverageCount == mRunsPerAvg)
+    {
+        mAverages.push_back(mCurrentAverage);
+        if (mAverages.size() > kMaxAverages)
         {
-            // clang off
-            os << "Average on " << runsPerAvg << " runs - GPU latency: " << sum.compute / runsPerAvg
-               << " ms - Host latency: " << sum.latency() / runsPerAvg << " ms (end to end " << sum.e2e / runsPerAvg
-               << " ms, enqueue " << sum.enq / runsPerAvg << " ms)" << std::endl;
-            // clang on
-            count = 0;
-            sum.enq = 0;
-            sum.in = 0;
-            sum.compute = 0;
-            sum.out = 0;
-            sum.e2e = 0;
+            mAverages.pop_front();
+            ++mDroppedAverages;
         }
+        mCurrentAverage = Average{0, InferenceTime()};
+        mCurrentAverageCount = 0;
+    }
+}
+
+void InferenceStatistics::merge(InferenceStatistics&& other)
+{
+    mWarmups += other.mWarmups;
+    mStartMs = std::min(mStartMs, other.mStartMs);
+    mEndMs = std::max(mEndMs, other.mEndMs);
+    mLatency.merge(other.mLatency);
+    mEndToEnd.merge(other.mEndToEnd);
+    mCompute.merge(other.mCompute);
+    mEnqueue.merge(other.mEnqueue);
+
+    // Incomplete groups are dropped, as they would be at the end of a single run. Each run kept its latest averages,
+    // so the latest of both are among them.
+    const auto cmpAverage = [](const Average& a, const Average& b) { return a.startMs < b.startMs; };
+    const auto averages = mAverages.size();
+    mAverages.insert(mAverages.end(), other.mAverages.begin(), other.mAverages.end());
+    std::inplace_merge(mAverages.begin(), mAverages.begin() + averages, mAverages.end(), cmpAverage);
+    const size_t excess = mAverages.size() > kMaxAverages ? mAverages.size() - kMaxAverages : 0;
+    mAverages.erase(mAverages.begin(), mAverages.begin() + excess);
+    mDroppedAverages += other.mDroppedAverages + static_cast<int64_t>(excess);
+
+    // Queries of several streams complete out of order, so the traces are only sorted here
+    const auto cmpTrace = [](const InferenceTrace& a, const InferenceTrace& b) { return a.inStart < b.inStart; };
+    std::sort(other.mTrace.begin(), other.mTrace.end(), cmpTrace);
+    const auto traces = mTrace.size();
+    mTrace.insert(mTrace.end(), other.mTrace.begin(), other.mTrace.end());
+    std::inplace_merge(mTrace.begin(), mTrace.begin() + traces, mTrace.end(), cmpTrace);
+}
+
+void InferenceStatistics::clear()
+{
+    TimelineWriter* timeline = mTimeline;
+    *this = InferenceStatistics(mWarmupMs, mRunsPerAvg, mKeepTrace);
+    mTimeline = timeline;
+}
+
+TimelineWriter::TimelineWriter(const std::string& fileName)
+    : mFile(fileName)
+{
+    mBuffer.reserve(kBufferSize + 1024);
+    mBuffer += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+}
+
+TimelineWriter::~TimelineWriter()
+{
+    // Nothing was written if the file could not be opened, and a failed write left it incomplete anyway
+    if (!mFile)
+    {
+        return;
     }
+    mBuffer += "\n]}\n";
+    flush();
 }
 
-void printEpilog(std::vector<InferenceTime> timings, float walltimeMs, float percentile, int queries, std::ostream& os)
+void TimelineWriter::startRun(const TimePoint& origin)
 {
-    const InferenceTime totalTime = std::accumulate(timings.begin(), timings.end(), InferenceTime());
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (!mStarted)
+    {
+        mFirstOrigin = origin;
+        mStarted = true;
+    }
+    mOrigin = origin;
+    mRunOffsetUs = std::chrono::duration<double, std::micro>(origin - mFirstOrigin).count();
+}
 
-    const auto getLatency = [](const InferenceTime& t) { return t.latency(); };
-    const auto cmpLatency = [](const InferenceTime& a, const InferenceTime& b) { return a.latency() < b.latency(); };
-    std::sort(timings.begin(), timings.end(), cmpLatency);
-    const float latencyMin = timings.front().latency();
-    const float latencyMax = timings.back().latency();
-    const float latencyMedian = findMedian(timings, getLatency);
-    const float latencyPercentile = findPercentile(percentile, timings, getLatency);
-    const float latencyThroughput = queries * timings.size() / walltimeMs * 1000;
+float TimelineWriter::getRunTimeMs() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - mOrigin).count();
+}
 
-    const auto getEndToEnd = [](const InferenceTime& t) { return t.e2e; };
-    const auto cmpEndToEnd = [](const InferenceTime& a, const InferenceTime& b) { return a.e2e < b.e2e; };
-    std::sort(timings.begin(), timings.end(), cmpEndToEnd);
-    const float endToEndMin = timings.front().e2e;
-    const float endToEndMax = timings.back().e2e;
-    const float endToEndMedian = findMedian(timings, getEndToEnd);
-    const float endToEndPercentile = findPercentile(percentile, timings, getEndToEnd);
+void TimelineWriter::addTrace(const InferenceTrace& trace)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    constexpr int kHostPid = 1;
+    constexpr int kDevicePid = 2;
+    addSpan(kHostPid, getHostTrack(), "Enqueue", trace.enqStart, trace.enqEnd - trace.enqStart);
 
-    const auto getCompute = [](const InferenceTime& t) { return t.compute; };
-    const auto cmpCompute = [](const InferenceTime& a, const InferenceTime& b) { return a.compute < b.compute; };
-    std::sort(timings.begin(), timings.end(), cmpCompute);
-    const float gpuMin = timings.front().compute;
-    const float gpuMax = timings.back().compute;
-    const float gpuMedian = findMedian(timings, getCompute);
-    const float gpuPercentile = findPercentile(percentile, timings, getCompute);
+    const int tracks = static_cast<int>(Track::kNUM);
+    if (mNamedStreams.size() <= static_cast<size_t>(trace.stream))
+    {
+        mNamedStreams.resize(trace.stream + 1, false);
+    }
+    if (!mNamedStreams[trace.stream])
+    {
+        nameTrack(kDevicePid, -1, "Device");
+        const std::string stream = "Stream " + std::to_string(trace.stream);
+        nameTrack(kDevicePid, trace.stream * tracks + static_cast<int>(Track::kINPUT), stream + " H2D");
+        nameTrack(kDevicePid, trace.stream * tracks + static_cast<int>(Track::kCOMPUTE), stream + " Compute");
+        nameTrack(kDevicePid, trace.stream * tracks + static_cast<int>(Track::kOUTPUT), stream + " D2H");
+        mNamedStreams[trace.stream] = true;
+    }
+    addSpan(kDevicePid, trace.stream * tracks + static_cast<int>(Track::kINPUT), "H2D", trace.inStart,
+        trace.inEnd - trace.inStart);
+    addSpan(kDevicePid, trace.stream * tracks + static_cast<int>(Track::kCOMPUTE), "Compute", trace.computeStart,
+        trace.computeEnd - trace.computeStart);
+    addSpan(kDevicePid, trace.stream * tracks + static_cast<int>(Track::kOUTPUT), "D2H", trace.outStart,
+        trace.outEnd - trace.outStart);
+}
 
-    const auto getEnqueue = [](const InferenceTime& t) { return t.enq; };
-    const auto cmpEnqueue = [](const InferenceTime& a, const InferenceTime& b) { return a.enq < b.enq; };
-    std::sort(timings.begin(), timings.end(), cmpEnqueue);
-    const float enqMin = timings.front().enq;
-    const float enqMax = timings.back().enq;
-    const float enqMedian = findMedian(timings, getEnqueue);
+void TimelineWriter::addLayer(const std::string& name, float startMs, float durationMs)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    constexpr int kLayerPid = 3;
+    if (!mNamedLayers)
+    {
+        nameTrack(kLayerPid, -1, "Layer profile");
+        nameTrack(kLayerPid, 0, "Layers");
+        mNamedLayers = true;
+    }
+    addSpan(kLayerPid, 0, name.c_str(), startMs, durationMs);
+}
+
+void TimelineWriter::addSpan(int pid, int tid, const char* name, float startMs, float durationMs)
+{
+    if (durationMs <= 0)
+    {
+        return;
+    }
+    std::ostringstream event;
+    event << std::fixed << std::setprecision(3);
+    event << (mFirstEvent ? "" : ",\n") << "{\"name\":" << toJSONString(name) << ",\"ph\":\"X\",\"pid\":" << pid
+          << ",\"tid\":" << tid << ",\"ts\":" << mRunOffsetUs + startMs * 1000.0 << ",\"dur\":" << durationMs * 1000.0
+          << "}";
+    mFirstEvent = false;
+    mBuffer += event.str();
+    if (mBuffer.size() >= kBufferSize)
+    {
+        flush();
+    }
+}
+
+void TimelineWriter::nameTrack(int pid, int tid, const std::string& name)
+{
+    // A negative tid names the process
+    std::ostringstream event;
+    event << (mFirstEvent ? "" : ",\n") << "{\"name\":\"" << (tid < 0 ? "process_name" : "thread_name")
+          << "\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << std::max(tid, 0)
+          << ",\"args\":{\"name\":" << toJSONString(name) << "}}";
+    mFirstEvent = false;
+    mBuffer += event.str();
+}
+
+int TimelineWriter::getHostTrack()
+{
+    const auto inserted = mHostThreads.emplace(std::this_thread::get_id(), static_cast<int>(mHostThreads.size()));
+    const int track = inserted.first->second;
+    if (inserted.second)
+    {
+        if (track == 0)
+        {
+            nameTrack(1, -1, "Host");
+        }
+        nameTrack(1, track, "Thread " + std::to_string(track));
+    }
+    return track;
+}
+
+void TimelineWriter::flush()
+{
+    mFile.write(mBuffer.data(), mBuffer.size());
+    mBuffer.clear();
+}
+
+void printProlog(int warmups, int timings, float warmupMs, float benchTimeMs, std::ostream& os)
+{
+    os << "Warmup completed " << warmups << " queries over " << warmupMs << " ms" << std::endl;
+    os << "Timing trace has " << timings << " queries over " << benchTimeMs / 1000 << " s" << std::endl;
+}
+
+void printTiming(const InferenceStatistics& statistics, std::ostream& os)
+{
+    const int runsPerAvg = statistics.getRunsPerAvg();
+
+    const auto& averages = statistics.getAverages();
+    const int64_t dropped = statistics.getDroppedAverages();
+    os << "Trace averages of " << runsPerAvg << " runs";
+    if (dropped)
+    {
+        os << " (last " << averages.size() << " of " << dropped + static_cast<int64_t>(averages.size()) << ")";
+    }
+    os << ":" << std::endl;
+    for (const auto& average : averages)
+    {
+        const InferenceTime& sum = average.sum;
+        // clang off
+        os << "Average on " << runsPerAvg << " runs - GPU latency: " << sum.compute / runsPerAvg
+           << " ms - Host latency: " << sum.latency() / runsPerAvg << " ms (end to end " << sum.e2e / runsPerAvg
+           << " ms, enqueue " << sum.enq / runsPerAvg << " ms)" << std::endl;
+        // clang on
+    }
+}
+
+void printEpilog(const InferenceStatistics& statistics, const std::vector<float>& percentiles, int queries,
+    std::ostream& os)
+{
+    const LatencyHistogram& latency = statistics.getLatency();
+    const LatencyHistogram& endToEnd = statistics.getEndToEnd();
+    const LatencyHistogram& compute = statistics.getCompute();
+    const LatencyHistogram& enqueue = statistics.getEnqueue();
+    const float walltimeMs = statistics.getBenchTimeMs();
+    const float latencyThroughput = queries * statistics.getTimings() / walltimeMs * 1000;
 
     // clang off
     os << "Host Latency" << std::endl
-       << "min: " << latencyMin
+       << "min: " << latency.getMin()
        << " ms "
           "(end to end "
-       << endToEndMin << " ms)" << std::endl
-       << "max: " << latencyMax
+       << endToEnd.getMin() << " ms)" << std::endl
+       << "max: " << latency.getMax()
        << " ms "
           "(end to end "
-       << endToEndMax << " ms)" << std::endl
-       << "mean: " << totalTime.latency() / timings.size()
+       << endToEnd.getMax() << " ms)" << std::endl
+       << "mean: " << latency.getMean()
        << " ms "
           "(end to end "
-       << totalTime.e2e / timings.size() << " ms)" << std::endl
-       << "median: " << latencyMedian
+       << endToEnd.getMean() << " ms)" << std::endl
+       << "median: " << latency.getPercentile(50)
        << " ms "
           "(end to end "
-       << endToEndMedian << " ms)" << std::endl
-       << "percentile: " << latencyPercentile
-       << " ms "
-          "at "
-       << percentile
-       << "% "
-          "(end to end "
-       << endToEndPercentile
-       << " ms "
-          "at "
-       << percentile << "%)" << std::endl
-       << "throughput: " << latencyThroughput << " qps" << std::endl
+       << endToEnd.getPercentile(50) << " ms)" << std::endl;
+    for (const float percentile : percentiles)
+    {
+        os << "percentile: " << latency.getPercentile(percentile)
+           << " ms "
+              "at "
+           << percentile
+           << "% "
+              "(end to end "
+           << endToEnd.getPercentile(percentile)
+           << " ms "
+              "at "
+           << percentile << "%)" << std::endl;
+    }
+    os << "throughput: " << latencyThroughput << " qps" << std::endl
        << "walltime: " << walltimeMs / 1000 << " s" << std::endl
        << "Enqueue Time" << std::endl
-       << "min: " << enqMin << " ms" << std::endl
-       << "max: " << enqMax << " ms" << std::endl
-       << "median: " << enqMedian << " ms" << std::endl
+       << "min: " << enqueue.getMin() << " ms" << std::endl
+       << "max: " << enqueue.getMax() << " ms" << std::endl
+       << "median: " << enqueue.getPercentile(50) << " ms" << std::endl
        << "GPU Compute" << std::endl
-       << "min: " << gpuMin << " ms" << std::endl
-       << "max: " << gpuMax << " ms" << std::endl
-       << "mean: " << totalTime.compute / timings.size() << " ms" << std::endl
-       << "median: " << gpuMedian << " ms" << std::endl
-       << "percentile: " << gpuPercentile
-       << " ms "
-          "at "
-       << percentile << "%" << std::endl
-       << "total compute time: " << totalTime.compute / 1000 << " s" << std::endl;
+       << "min: " << compute.getMin() << " ms" << std::endl
+       << "max: " << compute.getMax() << " ms" << std::endl
+       << "mean: " << compute.getMean() << " ms" << std::endl
+       << "median: " << compute.getPercentile(50) << " ms" << std::endl;
+    for (const float percentile : percentiles)
+    {
+        os << "percentile: " << compute.getPercentile(percentile)
+           << " ms "
+              "at "
+           << percentile << "%" << std::endl;
+    }
+    os << "total compute time: " << compute.getSum() / 1000 << " s" << std::endl;
     // clang on
 }
 
-void printPerformanceReport(const std::vector<InferenceTrace>& trace, const ReportingOptions& reporting, float warmupMs,
-    int queries, std::ostream& os)
+void printPerformanceReport(
+    const InferenceStatistics& statistics, const ReportingOptions& reporting, int queries, std::ostream& os)
 {
-    const auto isNotWarmup = [&warmupMs](const InferenceTrace& a) { return a.computeStart >= warmupMs; };
-    const auto noWarmup = std::find_if(trace.begin(), trace.end(), isNotWarmup);
-    const int warmups = noWarmup - trace.begin();
-    const float benchTime = trace.back().outEnd - noWarmup->inStart;
-    printProlog(warmups * queries, (trace.size() - warmups) * queries, warmupMs, benchTime, os);
+    printProlog(statistics.getWarmups() * queries, statistics.getTimings() * queries, statistics.getWarmupMs(),
+        statistics.getBenchTimeMs(), os);
 
-    std::vector<InferenceTime> timings(trace.size() - warmups);
-    std::transform(noWarmup, trace.end(), timings.begin(), traceToTiming);
-    printTiming(timings, reporting.avgs, os);
-    printEpilog(timings, benchTime, reporting.percentile, queries, os);
+    if (statistics.getTimings())
+    {
+        printTiming(statistics, os);
+        printEpilog(statistics, reporting.percentiles, queries, os);
+    }
 
     if (!reporting.exportTimes.empty())
     {
-        exportJSONTrace(trace, reporting.exportTimes);
+        exportJSONTrace(statistics.getTrace(), reporting.exportTimes);
+    }
+}
+
+void printLoadCurve(const std::vector<float>& offeredRates, const std::vector<InferenceStatistics>& runs,
+    const std::vector<float>& percentiles, std::ostream& os)
+{
+    const int columnLength = 12;
+    os << "=== End to end latency (ms) against offered load (inferences/s) ===" << std::endl
+       << std::setw(columnLength) << "Offered" << std::setw(columnLength) << "Achieved" << std::setw(columnLength)
+       << "Mean" << std::setw(columnLength) << "Median";
+    for (const float percentile : percentiles)
+    {
+        os << std::setw(columnLength - 1) << percentile << "%";
+    }
+    os << std::endl;
+
+    for (size_t r = 0; r < runs.size(); ++r)
+    {
+        const LatencyHistogram& endToEnd = runs[r].getEndToEnd();
+        const float benchTimeMs = runs[r].getBenchTimeMs();
+        const float achieved = benchTimeMs > 0 ? runs[r].getTimings() / benchTimeMs * 1000 : 0;
+        os << std::setw(columnLength) << offeredRates[r] << std::setw(columnLength) << achieved
+           << std::setw(columnLength) << endToEnd.getMean() << std::setw(columnLength) << endToEnd.getPercentile(50);
+        for (const float percentile : percentiles)
+        {
+            os << std::setw(columnLength) << endToEnd.getPercentile(percentile);
+        }
+        os << std::endl;
     }
 }
 
 //! Printed format:
 //! [ value, ...]
-//! value ::= { "start enq : time, "end enq" : time, "start in" : time, "end in" : time, "start compute" : time, "end
-//! compute" : time,
+//! value ::= { "arrival" : time, "start enq : time, "end enq" : time, "start in" : time, "end in" : time,
+//!             "start compute" : time, "end compute" : time,
 //!             "start out" : time, "in" : time, "compute" : time, "out" : time, "latency" : time, "end to end" : time}
 //!
 void exportJSONTrace(const std::vector<InferenceTrace>& trace, const std::string& fileName)
@@ -229,12 +550,13 @@ void exportJSONTrace(const std::vector<InferenceTrace>& trace, const std::string
         os << sep << "{ ";
         sep = ", ";
         // clang off
-        os << "\"startEnqMs\" : " << t.inStart << sep << "\"endEnqMs\" : " << t.inEnd << sep
-           << "\"startInMs\" : " << t.enqStart << sep << "\"endInMs\" : " << t.enqEnd << sep
-           << "\"startComputeMs\" : " << t.computeStart << sep << "\"endComputeMs\" : " << t.computeEnd << sep
-           << "\"startOutMs\" : " << t.outStart << sep << "\"endOutMs\" : " << t.outEnd << sep << "\"inMs\" : " << it.in
-           << sep << "\"computeMs\" : " << it.compute << sep << "\"outMs\" : " << it.out << sep
-           << "\"latencyMs\" : " << it.latency() << sep << "\"endToEndMs\" : " << it.e2e << " }" << std::endl;
+        os << "\"arrivalMs\" : " << t.arrival << sep << "\"startEnqMs\" : " << t.enqStart << sep
+           << "\"endEnqMs\" : " << t.enqEnd << sep << "\"startInMs\" : " << t.inStart << sep
+           << "\"endInMs\" : " << t.inEnd << sep << "\"startComputeMs\" : " << t.computeStart << sep
+           << "\"endComputeMs\" : " << t.computeEnd << sep << "\"startOutMs\" : " << t.outStart << sep
+           << "\"endOutMs\" : " << t.outEnd << sep << "\"inMs\" : " << it.in << sep << "\"computeMs\" : " << it.compute
+           << sep << "\"outMs\" : " << it.out << sep << "\"latencyMs\" : " << it.latency() << sep
+           << "\"endToEndMs\" : " << it.e2e << " }" << std::endl;
         // clang on
     }
     os << "]" << std::endl;
@@ -242,24 +564,54 @@ void exportJSONTrace(const std::vector<InferenceTrace>& trace, const std::string
 
 void Profiler::reportLayerTime(const char* layerName, float timeMs)
 {
-    if (mIterator == mLayers.end())
+    if (mIndex == mLayers.size())
     {
-        const bool first = !mLayers.empty() && mLayers.begin()->name == layerName;
-        mUpdatesCount += mLayers.empty() || first;
-        if (first)
+        if (!mLayersKnown && !mLayers.empty() && mLayers.front().name == layerName)
+        {
+            mLayersKnown = true;
+        }
+        if (mLayersKnown)
         {
-            mIterator = mLayers.begin();
+            mIndex = 0;
         }
         else
         {
             mLayers.emplace_back();
             mLayers.back().name = layerName;
-            mIterator = mLayers.end() - 1;
+        }
+        if (mIndex == 0)
+        {
+            if (mUpdatesCount)
+            {
+                mIterations.add(mIterationMs);
+            }
+            mIterationMs = 0;
+            ++mUpdatesCount;
         }
     }
 
-    mIterator->timeMs += timeMs;
-    ++mIterator;
+    mLayers[mIndex].timeMs.add(timeMs);
+    mIterationMs += timeMs;
+    if (mTimeline)
+    {
+        if (mIndex == 0)
+        {
+            mLayerStartMs = mTimeline->getRunTimeMs();
+        }
+        mTimeline->addLayer(mLayers[mIndex].name, mLayerStartMs, timeMs);
+        mLayerStartMs += timeMs;
+    }
+    ++mIndex;
+}
+
+LatencyHistogram Profiler::getIterationTimes() const
+{
+    LatencyHistogram iterations = mIterations;
+    if (mUpdatesCount && mIndex == mLayers.size())
+    {
+        iterations.add(mIterationMs);
+    }
+    return iterations;
 }
 
 void Profiler::print(std::ostream& os) const
@@ -267,6 +619,11 @@ void Profiler::print(std::ostream& os) const
     const std::string nameHdr("Layer");
     const std::string timeHdr("   Time (ms)");
     const std::string avgHdr("   Avg. Time (ms)");
+    const std::string minHdr("   Min (ms)");
+    const std::string medianHdr("   Median (ms)");
+    const std::string p99Hdr("   99% (ms)");
+    const std::string maxHdr("   Max (ms)");
+    const std::string stdDevHdr("   Std. dev. (ms)");
     const std::string percentageHdr("   Time \%");
 
     const float totalTimeMs = getTotalTime();
@@ -274,28 +631,27 @@ void Profiler::print(std::ostream& os) const
     const auto cmpLayer = [](const LayerProfile& a, const LayerProfile& b) { return a.name.size() < b.name.size(); };
     const auto longestName = std::max_element(mLayers.begin(), mLayers.end(), cmpLayer);
     const auto nameLength = std::max(longestName->name.size() + 1, nameHdr.size());
-    const auto timeLength = timeHdr.size();
-    const auto avgLength = avgHdr.size();
-    const auto percentageLength = percentageHdr.size();
 
     os << std::endl
        << "=== Profile (" << mUpdatesCount << " iterations ) ===" << std::endl
-       << std::setw(nameLength) << nameHdr << timeHdr << avgHdr << percentageHdr << std::endl;
+       << std::setw(nameLength) << nameHdr << timeHdr << avgHdr << minHdr << medianHdr << p99Hdr << maxHdr << stdDevHdr
+       << percentageHdr << std::endl;
 
-    for (const auto& p : mLayers)
-    {
+    const auto printRow = [&](const std::string& name, const LatencyHistogram& timeMs, float sumMs) {
         // clang off
-        os << std::setw(nameLength) << p.name << std::setw(timeLength) << std::fixed << std::setprecision(2) << p.timeMs
-           << std::setw(avgLength) << std::fixed << std::setprecision(4) << p.timeMs / mUpdatesCount
-           << std::setw(percentageLength) << std::fixed << std::setprecision(1) << p.timeMs / totalTimeMs * 100
-           << std::endl;
-    }
-    {
-        os << std::setw(nameLength) << "Total" << std::setw(timeLength) << std::fixed << std::setprecision(2)
-           << totalTimeMs << std::setw(avgLength) << std::fixed << std::setprecision(4) << totalTimeMs / mUpdatesCount
-           << std::setw(percentageLength) << std::fixed << std::setprecision(1) << 100.0 << std::endl;
+        os << std::setw(nameLength) << name << std::setw(timeHdr.size()) << std::fixed << std::setprecision(2) << sumMs
+           << std::setprecision(4) << std::setw(avgHdr.size()) << sumMs / mUpdatesCount
+           << std::setw(minHdr.size()) << timeMs.getMin() << std::setw(medianHdr.size()) << timeMs.getPercentile(50)
+           << std::setw(p99Hdr.size()) << timeMs.getPercentile(99) << std::setw(maxHdr.size()) << timeMs.getMax()
+           << std::setw(stdDevHdr.size()) << std::sqrt(timeMs.getVariance())
+           << std::setw(percentageHdr.size()) << std::setprecision(1) << sumMs / totalTimeMs * 100 << std::endl;
         // clang on
+    };
+    for (const auto& p : mLayers)
+    {
+        printRow(p.name, p.timeMs, static_cast<float>(p.timeMs.getSum()));
     }
+    printRow("Total", getIterationTimes(), totalTimeMs);
     os << std::endl;
 }
 
@@ -308,13 +664,17 @@ void Profiler::exportJSONProfile(const std::string& fileName) const
 
     for (const auto& l : mLayers)
     {
+        const auto timeMs = l.timeMs.getSum();
         // clang off
         os << ", {"
            << " \"name\" : \"" << l.name
            << "\""
               ", \"timeMs\" : "
-           << l.timeMs << ", \"averageMs\" : " << l.timeMs / mUpdatesCount
-           << ", \"percentage\" : " << l.timeMs / totalTimeMs * 100 << " }" << std::endl;
+           << timeMs << ", \"averageMs\" : " << timeMs / mUpdatesCount
+           << ", \"minMs\" : " << l.timeMs.getMin() << ", \"medianMs\" : " << l.timeMs.getPercentile(50)
+           << ", \"p99Ms\" : " << l.timeMs.getPercentile(99) << ", \"maxMs\" : " << l.timeMs.getMax()
+           << ", \"varianceMs2\" : " << l.timeMs.getVariance()
+           << ", \"percentage\" : " << timeMs / totalTimeMs * 100 << " }" << std::endl;
         // clang on
     }
     os << "]" << std::endl;
@@ -354,4 +714,42 @@ void exportJSONOutput(const nvinfer1::IExecutionContext& context, const Bindings
     os << "]" << std::endl;
 }
 
+bool exportNpyOutput(const nvinfer1::IExecutionContext& context, const Bindings& bindings, const std::string& prefix)
+{
+    for (const auto& output : bindings.getOutputBindings())
+    {
+        const Binding& binding = bindings.getBinding(output.second);
+        const auto dims = context.getBindingDimensions(output.second);
+        std::vector<int64_t> shape(dims.d, dims.d + std::max(dims.nbDims, 0));
+        const int64_t dimsVolume = std::accumulate(shape.begin(), shape.end(), int64_t(1), std::multiplies<int64_t>());
+        if (dimsVolume != binding.volume)
+        {
+            if (dimsVolume > 0 && binding.volume % dimsVolume == 0)
+            {
+                shape.insert(shape.begin(), binding.volume / dimsVolume);
+            }
+            else
+            {
+                shape = {binding.volume};
+            }
+        }
+
+        std::string fileName = output.first;
+        std::replace_if(fileName.begin(), fileName.end(),
+            [](char c) { return !std::isalnum(static_cast<unsigned char>(c)) && c != '-' && c != '.'; }, '_');
+        fileName = prefix + fileName + ".npy";
+
+        std::ofstream os(fileName, std::ofstream::trunc | std::ofstream::binary);
+        const std::string header = makeNpyHeader(toNpyType(binding.dataType), shape);
+        os.write(header.data(), header.size());
+        os.write(static_cast<const char*>(binding.buffer.getHostBuffer()), binding.buffer.getSize());
+        if (!os)
+        {
+            sample::gLogError << "Cannot write output to " << fileName << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
 } // namespace sample
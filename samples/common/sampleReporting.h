@@ -17,7 +17,17 @@
 #ifndef TRT_SAMPLE_REPORTING_H
 #define TRT_SAMPLE_REPORTING_H
 
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <fstream>
 #include <iostream>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 #include "NvInfer.h"
 
@@ -53,7 +63,7 @@ struct InferenceTime
     float in{0};      // Host to Device
     float compute{0}; // Compute
     float out{0};     // Device to Host
-    float e2e{0};     // end to end
+    float e2e{0};     // end to end, from the arrival of the query
 
     // ideal latency
     float latency() const
@@ -68,8 +78,9 @@ struct InferenceTime
 //!
 struct InferenceTrace
 {
-    InferenceTrace(int s, float es, float ee, float is, float ie, float cs, float ce, float os, float oe)
+    InferenceTrace(int s, float a, float es, float ee, float is, float ie, float cs, float ce, float os, float oe)
         : stream(s)
+        , arrival(a)
         , enqStart(es)
         , enqEnd(ee)
         , inStart(is)
@@ -89,6 +100,7 @@ struct InferenceTrace
     ~InferenceTrace() = default;
 
     int stream{0};
+    float arrival{0}; // Scheduled arrival in an open-loop run, inStart otherwise
     float enqStart{0};
     float enqEnd{0};
     float inStart{0};
@@ -109,26 +121,326 @@ inline InferenceTime operator+=(InferenceTime& a, const InferenceTime& b)
     return a = a + b;
 }
 
+//!
+//! \class LatencyHistogram
+//! \brief Streaming summary of one latency metric in bounded memory
+//!
+//! Values are counted in buckets that are linear within each power of two nanoseconds, as in an HDR histogram, so
+//! any percentile is found within 1/128 of its value however many values have been added. Count, sum, min, max and
+//! variance are exact. Buckets are only allocated up to the largest value seen, so short latencies take little memory.
+//!
+class LatencyHistogram
+{
+public:
+    void add(float ms);
+
+    void merge(const LatencyHistogram& other);
+
+    int64_t getCount() const
+    {
+        return mCount;
+    }
+
+    double getSum() const
+    {
+        return mSum;
+    }
+
+    float getMin() const
+    {
+        return mMin;
+    }
+
+    float getMax() const
+    {
+        return mMax;
+    }
+
+    float getMean() const
+    {
+        return mCount ? static_cast<float>(mSum / mCount) : std::numeric_limits<float>::infinity();
+    }
+
+    //!
+    //! \brief Population variance of the values in ms^2, computed exactly
+    //!
+    float getVariance() const
+    {
+        return mCount ? static_cast<float>(mSquares / mCount) : 0.0F;
+    }
+
+    //!
+    //! \brief Value that percentage % of the values are at or below, or infinity if there are no values
+    //!
+    float getPercentile(float percentage) const;
+
+private:
+    static constexpr int kSubBucketBits{7};
+    static constexpr int kSubBuckets{1 << kSubBucketBits};
+    static constexpr int kMaxBits{48}; // Values up to 2^48 ns, over 78 hours
+
+    static int toBucket(uint64_t ns);
+    static float bucketMidpointMs(int bucket);
+
+    std::vector<int64_t> mCounts; // Grown up to the bucket of the largest value
+    int64_t mCount{0};
+    double mSum{0};
+    double mSquares{0}; // Sum of squared deviations from the mean
+    float mMin{std::numeric_limits<float>::infinity()};
+    float mMax{-std::numeric_limits<float>::infinity()};
+};
+
+//!
+//! \class TimelineWriter
+//! \brief Writes inference traces and layer profiles as a timeline in Chrome Trace Event format
+//!
+//! The file can be opened with chrome://tracing or Perfetto. Inferences show as spans of the host threads that
+//! enqueued them and of the input copies, compute and output copies of each stream, so overlap between streams and
+//! stages is visible. Layers show on a track of their own.
+//!
+//! Events are appended to a buffer that is written out whenever it fills up, so the size of the timeline is not
+//! limited by memory. All the methods can be called from several threads.
+//!
+class TimelineWriter
+{
+public:
+    using TimePoint = std::chrono::high_resolution_clock::time_point;
+
+    explicit TimelineWriter(const std::string& fileName);
+
+    ~TimelineWriter();
+
+    TimelineWriter(const TimelineWriter&) = delete;
+    TimelineWriter& operator=(const TimelineWriter&) = delete;
+
+    bool isOpen() const
+    {
+        return mFile.is_open();
+    }
+
+    //!
+    //! \brief Start a run whose times are in ms from origin. Each run is placed on the timeline where it started.
+    //!
+    void startRun(const TimePoint& origin);
+
+    //!
+    //! \brief Host time in ms from the origin of the current run
+    //!
+    float getRunTimeMs() const;
+
+    //!
+    //! \brief Add the enqueue, input copy, compute and output copy of an inference
+    //!
+    void addTrace(const InferenceTrace& trace);
+
+    //!
+    //! \brief Add the execution of a layer
+    //!
+    void addLayer(const std::string& name, float startMs, float durationMs);
+
+private:
+    enum class Track : int
+    {
+        kINPUT = 0,
+        kCOMPUTE = 1,
+        kOUTPUT = 2,
+        kNUM = 3
+    };
+
+    void addSpan(int pid, int tid, const char* name, float startMs, float durationMs);
+    void nameTrack(int pid, int tid, const std::string& name);
+    int getHostTrack();
+    void flush();
+
+    static constexpr size_t kBufferSize{size_t(1) << 20};
+
+    std::ofstream mFile;
+    std::string mBuffer;
+    mutable std::mutex mMutex;
+    bool mStarted{false};
+    bool mFirstEvent{true};
+    TimePoint mFirstOrigin{};
+    TimePoint mOrigin{};
+    double mRunOffsetUs{0};
+    std::unordered_map<std::thread::id, int> mHostThreads;
+    std::vector<bool> mNamedStreams;
+    bool mNamedLayers{false};
+};
+
+//!
+//! \class InferenceStatistics
+//! \brief Timing statistics of an inference run, updated as each query completes
+//!
+//! Queries that start computing during the warm up are only counted. Memory does not grow with the length of the
+//! run unless keepTrace is set: only the last kMaxAverages averages are kept, and older ones are only counted.
+//!
+class InferenceStatistics
+{
+public:
+    //!
+    //! \brief Sum of runsPerAvg consecutive measured queries
+    //!
+    struct Average
+    {
+        float startMs;
+        InferenceTime sum;
+    };
+
+    static constexpr size_t kMaxAverages{1024};
+
+    InferenceStatistics(float warmupMs, int runsPerAvg, bool keepTrace)
+        : mWarmupMs(warmupMs)
+        , mRunsPerAvg(runsPerAvg)
+        , mKeepTrace(keepTrace)
+    {
+    }
+
+    void add(const InferenceTrace& trace);
+
+    //!
+    //! \brief Add the queries of another run with the same settings, such as the run of another thread
+    //!
+    void merge(InferenceStatistics&& other);
+
+    //!
+    //! \brief Remove all queries, keeping the settings
+    //!
+    void clear();
+
+    //!
+    //! \brief Also write every trace added to a timeline, or stop if timeline is null
+    //!
+    void setTimeline(TimelineWriter* timeline)
+    {
+        mTimeline = timeline;
+    }
+
+    TimelineWriter* getTimeline() const
+    {
+        return mTimeline;
+    }
+
+    int getWarmups() const
+    {
+        return mWarmups;
+    }
+
+    float getWarmupMs() const
+    {
+        return mWarmupMs;
+    }
+
+    int getRunsPerAvg() const
+    {
+        return mRunsPerAvg;
+    }
+
+    //!
+    //! \brief Time from the first measured query entering the input copy to the last one leaving the output copy
+    //!
+    float getBenchTimeMs() const
+    {
+        return getTimings() ? mEndMs - mStartMs : 0;
+    }
+
+    int64_t getTimings() const
+    {
+        return mCompute.getCount();
+    }
+
+    const LatencyHistogram& getLatency() const
+    {
+        return mLatency;
+    }
+
+    const LatencyHistogram& getEndToEnd() const
+    {
+        return mEndToEnd;
+    }
+
+    const LatencyHistogram& getCompute() const
+    {
+        return mCompute;
+    }
+
+    const LatencyHistogram& getEnqueue() const
+    {
+        return mEnqueue;
+    }
+
+    //!
+    //! \brief The averages of the last kMaxAverages complete groups of runsPerAvg queries, in start order
+    //!
+    const std::deque<Average>& getAverages() const
+    {
+        return mAverages;
+    }
+
+    //!
+    //! \brief Number of complete groups that were dropped to keep the number of averages at kMaxAverages
+    //!
+    int64_t getDroppedAverages() const
+    {
+        return mDroppedAverages;
+    }
+
+    //!
+    //! \brief All the traces, warm up included, sorted by start time. Empty unless keepTrace was set.
+    //!
+    const std::vector<InferenceTrace>& getTrace() const
+    {
+        return mTrace;
+    }
+
+private:
+    float mWarmupMs{0};
+    int mRunsPerAvg{0};
+    bool mKeepTrace{false};
+
+    int mWarmups{0};
+    float mStartMs{std::numeric_limits<float>::infinity()};
+    float mEndMs{-std::numeric_limits<float>::infinity()};
+    LatencyHistogram mLatency;
+    LatencyHistogram mEndToEnd;
+    LatencyHistogram mCompute;
+    LatencyHistogram mEnqueue;
+
+    std::deque<Average> mAverages;
+    int64_t mDroppedAverages{0};
+    Average mCurrentAverage{0, InferenceTime()};
+    int mCurrentAverageCount{0};
+
+    std::vector<InferenceTrace> mTrace;
+    TimelineWriter* mTimeline{nullptr};
+};
+
 //!
 //! \brief Print benchmarking time and number of traces collected
 //!
 void printProlog(int warmups, int timings, float warmupMs, float walltime, std::ostream& os);
 
 //!
-//! \brief Print a timing trace
+//! \brief Print the averages of a run
+//!
+void printTiming(const InferenceStatistics& statistics, std::ostream& os);
+
+//!
+//! \brief Print the performance summary of a run
 //!
-void printTiming(const std::vector<InferenceTime>& timings, int runsPerAvg, std::ostream& os);
+void printEpilog(const InferenceStatistics& statistics, const std::vector<float>& percentiles, int queries,
+    std::ostream& os);
 
 //!
-//! \brief Print the performance summary of a trace
+//! \brief Print and summarize the timing of a run
 //!
-void printEpilog(std::vector<InferenceTime> timings, float percentile, int queries, std::ostream& os);
+void printPerformanceReport(
+    const InferenceStatistics& statistics, const ReportingOptions& reporting, int queries, std::ostream& os);
 
 //!
-//! \brief Print and summarize a timing trace
+//! \brief Print the end to end latency of open-loop runs against the load offered to each
 //!
-void printPerformanceReport(const std::vector<InferenceTrace>& trace, const ReportingOptions& reporting, float warmupMs,
-    int queries, std::ostream& os);
+void printLoadCurve(const std::vector<float>& offeredRates, const std::vector<InferenceStatistics>& runs,
+    const std::vector<float>& percentiles, std::ostream& os);
 
 //!
 //! \brief Export a timing trace to JSON file
@@ -151,6 +463,17 @@ void dumpOutputs(const nvinfer1::IExecutionContext& context, const Bindings& bin
 void exportJSONOutput(
     const nvinfer1::IExecutionContext& context, const Bindings& bindings, const std::string& fileName);
 
+//!
+//! \brief Export each output tensor to the NPY file prefix + name + ".npy", with characters of the name that do not
+//!        belong in a file name replaced by '_'
+//!
+//! The values are written as they are in the host buffer, in one write per tensor. The shape is the dimensions of
+//! the binding, with the batch size in front for implicit batch engines, or the number of values if the buffer holds
+//! vectorized components.
+//!
+bool exportNpyOutput(
+    const nvinfer1::IExecutionContext& context, const Bindings& bindings, const std::string& prefix);
+
 //!
 //! \struct LayerProfile
 //! \brief Layer profile information
@@ -158,12 +481,16 @@ void exportJSONOutput(
 struct LayerProfile
 {
     std::string name;
-    float timeMs{0};
+    LatencyHistogram timeMs; // One value per iteration
 };
 
 //!
 //! \class Profiler
-//! \brief Collect per-layer profile information, assuming times are reported in the same order
+//! \brief Collect per-layer profile information, assuming times are reported in the same order in every iteration
+//!
+//! The layers are learnt from the first iteration, which ends when its first layer is reported again. Later
+//! iterations are matched to them by position only, and the time of each layer in each iteration is kept in a
+//! histogram, so the jitter of individual layers shows next to their average.
 //!
 class Profiler : public nvinfer1::IProfiler
 {
@@ -171,6 +498,14 @@ class Profiler : public nvinfer1::IProfiler
 public:
     void reportLayerTime(const char* layerName, float timeMs) override;
 
+    //!
+    //! \brief Also write the layers to a timeline, back to back from the time each iteration is reported
+    //!
+    void setTimeline(TimelineWriter* timeline)
+    {
+        mTimeline = timeline;
+    }
+
     void print(std::ostream& os) const;
 
     //!
@@ -181,13 +516,24 @@ public:
 private:
     float getTotalTime() const
     {
-        const auto plusLayerTime = [](float accumulator, const LayerProfile& lp) { return accumulator + lp.timeMs; };
-        return std::accumulate(mLayers.begin(), mLayers.end(), 0.0, plusLayerTime);
+        const auto plusLayerTime
+            = [](double accumulator, const LayerProfile& lp) { return accumulator + lp.timeMs.getSum(); };
+        return static_cast<float>(std::accumulate(mLayers.begin(), mLayers.end(), 0.0, plusLayerTime));
     }
 
+    //!
+    //! \brief Time of each whole iteration, including one still in progress when the layers are not known yet
+    //!
+    LatencyHistogram getIterationTimes() const;
+
     std::vector<LayerProfile> mLayers;
-    std::vector<LayerProfile>::iterator mIterator{mLayers.begin()};
+    size_t mIndex{0};          // Position of the next layer in the current iteration
+    bool mLayersKnown{false};  // The first iteration has ended and mLayers is complete
     int mUpdatesCount{0};
+    float mIterationMs{0};
+    LatencyHistogram mIterations;
+    TimelineWriter* mTimeline{nullptr};
+    float mLayerStartMs{0};
 };
 
 } // namespace sample
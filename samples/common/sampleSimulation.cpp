@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "sampleSimulation.h"
+
+namespace sample
+{
+
+namespace
+{
+
+//!
+//! \class SimulationStream
+//! \brief Stream of simulated inferences, keeping the scheduled times of each slot until it is synchronized
+//!
+class SimulationStream : public InferenceStream
+{
+
+public:
+    SimulationStream(SimulationBackend& backend, int depth)
+        : mBackend(backend)
+        , mSlots(depth)
+        , mEndMs(depth)
+    {
+    }
+
+    void enqueue(int slot, bool skipTransfers) override
+    {
+        using Engine = SimulationBackend::Engine;
+        const SimulationOptions& options = mBackend.getOptions();
+        InferenceTrace& trace = mSlots[slot];
+
+        double readyMs = std::max(mBackend.getDeviceTimeMs(), 0.0);
+        if (!skipTransfers)
+        {
+            const double inStart = mBackend.schedule(Engine::kINPUT, readyMs, options.inputMs);
+            readyMs = inStart + options.inputMs;
+            trace.inStart = static_cast<float>(inStart);
+            trace.inEnd = static_cast<float>(readyMs);
+        }
+
+        trace.enqStart = mBackend.getHostTimeMs();
+        const double computeStart = mBackend.schedule(Engine::kCOMPUTE, readyMs, options.computeMs);
+        trace.enqEnd = mBackend.getHostTimeMs();
+        readyMs = computeStart + options.computeMs;
+        trace.computeStart = static_cast<float>(computeStart);
+        trace.computeEnd = static_cast<float>(readyMs);
+
+        if (!skipTransfers)
+        {
+            const double outStart = mBackend.schedule(Engine::kOUTPUT, readyMs, options.outputMs);
+            readyMs = outStart + options.outputMs;
+            trace.outStart = static_cast<float>(outStart);
+            trace.outEnd = static_cast<float>(readyMs);
+        }
+        else
+        {
+            trace.inStart = trace.inEnd = trace.computeStart;
+            trace.outStart = trace.outEnd = trace.computeEnd;
+        }
+        mEndMs[slot] = readyMs;
+    }
+
+    InferenceTrace synchronize(int slot, bool /*skipTransfers*/) override
+    {
+        std::this_thread::sleep_until(mBackend.toTimePoint(mEndMs[slot]));
+        return mSlots[slot];
+    }
+
+    void setInputData() override {}
+
+    void fetchOutputData() override {}
+
+private:
+    SimulationBackend& mBackend;
+    std::vector<InferenceTrace> mSlots;
+    std::vector<double> mEndMs;
+};
+
+} // namespace
+
+TimePoint SimulationBackend::start(int sleepMs)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mCpuStart = std::chrono::high_resolution_clock::now();
+    mOrigin = mCpuStart + std::chrono::milliseconds(sleepMs);
+    mFreeMs.fill(0);
+    return mOrigin;
+}
+
+std::unique_ptr<InferenceStream> SimulationBackend::createStream(const InferenceOptions& inference, int /*id*/)
+{
+    return std::unique_ptr<InferenceStream>(new SimulationStream(*this, 1 + inference.overlap));
+}
+
+double SimulationBackend::schedule(Engine engine, double readyMs, double durationMs)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    double& freeMs = mFreeMs[static_cast<int>(engine)];
+    const double startMs = std::max(readyMs, freeMs);
+    freeMs = startMs + durationMs;
+    return startMs;
+}
+
+double SimulationBackend::getDeviceTimeMs() const
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - mOrigin).count();
+}
+
+float SimulationBackend::getHostTimeMs() const
+{
+    return std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - mCpuStart).count();
+}
+
+TimePoint SimulationBackend::toTimePoint(double deviceTimeMs) const
+{
+    return mOrigin
+        + std::chrono::duration_cast<TimePoint::duration>(std::chrono::duration<double, std::milli>(deviceTimeMs));
+}
+
+} // namespace sample
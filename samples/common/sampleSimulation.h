@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TRT_SAMPLE_SIMULATION_H
+#define TRT_SAMPLE_SIMULATION_H
+
+#include <array>
+#include <memory>
+#include <mutex>
+
+#include "sampleInference.h"
+#include "sampleOptions.h"
+
+namespace sample
+{
+
+//!
+//! \class SimulationBackend
+//! \brief CPU stand-in for an engine, to run the scheduling and reporting of inference without a GPU
+//!
+//! Each inference takes the times given by SimulationOptions for its input copy, compute and output copy. As on a
+//! GPU with one compute queue and one copy engine each way, all the streams share one engine of each kind, which runs
+//! one stage at a time in the order they were enqueued.
+//!
+//! Stages are scheduled in simulated time when they are enqueued, so no thread is needed to run them. Synchronizing
+//! an inference sleeps until its scheduled end, and its trace holds the scheduled times, which do not depend on how
+//! late the host wakes up.
+//!
+class SimulationBackend : public InferenceBackend
+{
+public:
+    enum class Engine : int
+    {
+        kINPUT = 0,
+        kCOMPUTE = 1,
+        kOUTPUT = 2,
+        kNUM = 3
+    };
+
+    explicit SimulationBackend(const SimulationOptions& options)
+        : mOptions(options)
+    {
+    }
+
+    TimePoint start(int sleepMs) override;
+
+    void setUpThread() override {}
+
+    std::unique_ptr<InferenceStream> createStream(const InferenceOptions& inference, int id) override;
+
+    const SimulationOptions& getOptions() const
+    {
+        return mOptions;
+    }
+
+    //!
+    //! \brief Book engine for durationMs as soon as it is free, no earlier than readyMs
+    //!
+    //! \return The start of the stage, in ms from the start of the run
+    //!
+    double schedule(Engine engine, double readyMs, double durationMs);
+
+    //!
+    //! \brief Host time in ms from the start of the run, where the simulated device starts
+    //!
+    double getDeviceTimeMs() const;
+
+    //!
+    //! \brief Host time in ms from the call to start(), the origin of enqueue times
+    //!
+    float getHostTimeMs() const;
+
+    TimePoint toTimePoint(double deviceTimeMs) const;
+
+private:
+    SimulationOptions mOptions;
+    TimePoint mCpuStart{};
+    TimePoint mOrigin{};
+
+    std::mutex mMutex;
+    std::array<double, static_cast<int>(Engine::kNUM)> mFreeMs{};
+};
+
+} // namespace sample
+
+#endif // TRT_SAMPLE_SIMULATION_H
@@ -17,11 +17,18 @@
 #ifndef TRT_SAMPLE_UTILS_H
 #define TRT_SAMPLE_UTILS_H
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
 #include <fstream>
 #include <iostream>
 #include <memory>
 #include <numeric>
-#include <random>
+#include <string>
+#include <thread>
+#include <type_traits>
 #include <unordered_map>
 #include <vector>
 
@@ -161,54 +168,310 @@ inline nvinfer1::Dims toDims(const std::vector<int>& vec)
     return dims;
 }
 
+//!
+//! \brief Counter-based random bits: the value at counter depends only on seed and counter
+//!
+//! This is the SplitMix64 output function applied to the counter. Values can be generated in any order and by any
+//! number of threads with the same result, and a loop that generates them has no dependency between iterations.
+//!
+inline uint64_t counterRandom(uint64_t seed, uint64_t counter)
+{
+    uint64_t z = seed + (counter + 1) * 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+//!
+//! \brief Uniform float in [0, 1) from the top 24 bits of random bits
+//!
+inline float toUnitFloat(uint64_t bits)
+{
+    return static_cast<float>(bits >> 40) * (1.0F / (1 << 24));
+}
+
+//!
+//! \brief Call fill(begin, end) on chunks that cover [0, volume), spread over the cores for large volumes
+//!
+//! \param chunk The size of the ranges handed to fill when several threads are used.
+//! \param minVolumePerThread The smallest part of the volume worth a thread. With a single thread, fill is called
+//!        once on the whole volume.
+//!
+template <typename F>
+inline void parallelFill(
+    int64_t volume, const F& fill, int64_t chunk = int64_t(1) << 16, int64_t minVolumePerThread = int64_t(1) << 20)
+{
+    const int64_t threadsNum = std::min<int64_t>(
+        std::max(std::thread::hardware_concurrency(), 1U), std::max<int64_t>(volume / minVolumePerThread, 1));
+    if (threadsNum == 1)
+    {
+        fill(0, volume);
+        return;
+    }
+
+    const int64_t chunks = (volume + chunk - 1) / chunk;
+    std::atomic<int64_t> next{0};
+    const auto worker = [&]() {
+        for (int64_t c = next++; c < chunks; c = next++)
+        {
+            fill(c * chunk, std::min(volume, (c + 1) * chunk));
+        }
+    };
+    std::vector<std::thread> threads;
+    for (int64_t t = 1; t < threadsNum; ++t)
+    {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+}
+
+//!
+//! \brief Fill a buffer with uniform random values in [min, max]
+//!
+//! The values depend only on seed, so they are the same whatever the number of threads that generate them.
+//!
 template <typename T>
-inline void fillBuffer(void* buffer, int volume, T min, T max)
+inline void fillBuffer(void* buffer, int volume, T min, T max, uint64_t seed = 0)
 {
     T* typedBuffer = static_cast<T*>(buffer);
-    std::default_random_engine engine;
     if (std::is_integral<T>::value)
     {
-        std::uniform_int_distribution<int> distribution(min, max);
-        auto generator = [&engine, &distribution]() { return static_cast<T>(distribution(engine)); };
-        std::generate(typedBuffer, typedBuffer + volume, generator);
+        // Maps the top 32 bits to the range by multiplication, which is as fast as a shift and nearly unbiased
+        const int64_t low = static_cast<int64_t>(min);
+        const uint64_t range = static_cast<uint64_t>(static_cast<int64_t>(max) - low + 1);
+        parallelFill(volume, [=](int64_t begin, int64_t end) {
+            for (int64_t i = begin; i < end; ++i)
+            {
+                const uint64_t offset = ((counterRandom(seed, i) >> 32) * range) >> 32;
+                typedBuffer[i] = static_cast<T>(low + static_cast<int64_t>(offset));
+            }
+        });
     }
     else
     {
-        std::uniform_real_distribution<float> distribution(min, max);
-        auto generator = [&engine, &distribution]() { return static_cast<T>(distribution(engine)); };
-        std::generate(typedBuffer, typedBuffer + volume, generator);
+        const float low = static_cast<float>(min);
+        const float scale = static_cast<float>(max) - low;
+        parallelFill(volume, [=](int64_t begin, int64_t end) {
+            for (int64_t i = begin; i < end; ++i)
+            {
+                typedBuffer[i] = static_cast<T>(low + scale * toUnitFloat(counterRandom(seed, i)));
+            }
+        });
     }
 }
 
 // Specialization needed for custom type __half
 template <typename H>
-inline void fillBufferHalf(void* buffer, int volume, H min, H max)
+inline void fillBufferHalf(void* buffer, int volume, H min, H max, uint64_t seed = 0)
 {
     H* typedBuffer = static_cast<H*>(buffer);
-    std::default_random_engine engine;
-    std::uniform_real_distribution<float> distribution(min, max);
-    auto generator = [&engine, &distribution]() { return static_cast<H>(distribution(engine)); };
-    std::generate(typedBuffer, typedBuffer + volume, generator);
+    const float low = static_cast<float>(min);
+    const float scale = static_cast<float>(max) - low;
+    parallelFill(volume, [=](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end; ++i)
+        {
+            typedBuffer[i] = static_cast<H>(low + scale * toUnitFloat(counterRandom(seed, i)));
+        }
+    });
 }
 template <>
 #if CUDA_VERSION < 10000
-inline void fillBuffer<half_float::half>(void* buffer, int volume, half_float::half min, half_float::half max)
+inline void fillBuffer<half_float::half>(
+    void* buffer, int volume, half_float::half min, half_float::half max, uint64_t seed)
 #else
-inline void fillBuffer<__half>(void* buffer, int volume, __half min, __half max)
+inline void fillBuffer<__half>(void* buffer, int volume, __half min, __half max, uint64_t seed)
 #endif
 {
-    fillBufferHalf(buffer, volume, min, max);
+    fillBufferHalf(buffer, volume, min, max, seed);
 }
 
+//!
+//! \brief Quote a string for JSON, escaping quotes, backslashes and control characters
+//!
+inline std::string toJSONString(const std::string& s)
+{
+    std::string json("\"");
+    for (const char c : s)
+    {
+        if (c == '"' || c == '\\')
+        {
+            json += '\\';
+            json += c;
+        }
+        else if (static_cast<unsigned char>(c) < 0x20)
+        {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            json += escaped;
+        }
+        else
+        {
+            json += c;
+        }
+    }
+    return json + "\"";
+}
+
+//!
+//! \brief Write a float as text the way an ostream with default settings does, which is printf's "%g", and return the
+//!        length of the text
+//!
+//! The 6 significant digits are found by scaling with a power of ten in double precision. That is exact enough to
+//! round correctly unless the value is within about 1e-9 of a tie, and those rare values are left to snprintf, so the
+//! text is always the same as snprintf's.
+//!
+inline int formatFloat(char* text, size_t size, float value)
+{
+    constexpr int kMinExponent{-46};
+    constexpr int kMaxExponent{52};
+    static const std::vector<double> powers = [] {
+        std::vector<double> p;
+        for (int e = kMinExponent; e <= kMaxExponent; ++e)
+        {
+            p.push_back(std::pow(10.0, e));
+        }
+        return p;
+    }();
+
+    const double magnitude = std::fabs(static_cast<double>(value));
+    if (!std::isfinite(magnitude) || magnitude == 0 || size < 16)
+    {
+        return snprintf(text, size, "%g", static_cast<double>(value));
+    }
+
+    // Scale to [100000, 1000000) and round to an integer
+    int exponent = static_cast<int>(std::floor(std::log10(magnitude)));
+    double scaled = magnitude * powers[5 - exponent - kMinExponent];
+    if (scaled < 100000)
+    {
+        scaled *= 10;
+        --exponent;
+    }
+    else if (scaled >= 1000000)
+    {
+        scaled /= 10;
+        ++exponent;
+    }
+    const double whole = std::floor(scaled);
+    if (std::fabs(scaled - whole - 0.5) < 1e-6)
+    {
+        return snprintf(text, size, "%g", static_cast<double>(value));
+    }
+    int digitsValue = static_cast<int>(whole) + (scaled - whole > 0.5);
+    if (digitsValue == 1000000)
+    {
+        digitsValue = 100000;
+        ++exponent;
+    }
+    char digits[6];
+    for (int d = 5; d >= 0; --d, digitsValue /= 10)
+    {
+        digits[d] = static_cast<char>('0' + digitsValue % 10);
+    }
+    int significant = 6;
+    while (significant > 1 && digits[significant - 1] == '0')
+    {
+        --significant;
+    }
+
+    char* t = text;
+    if (value < 0)
+    {
+        *t++ = '-';
+    }
+    if (exponent < -4 || exponent >= 6)
+    {
+        *t++ = digits[0];
+        if (significant > 1)
+        {
+            *t++ = '.';
+            t = std::copy(digits + 1, digits + significant, t);
+        }
+        *t++ = 'e';
+        *t++ = exponent < 0 ? '-' : '+';
+        const int e = std::abs(exponent);
+        if (e >= 100)
+        {
+            *t++ = static_cast<char>('0' + e / 100);
+        }
+        *t++ = static_cast<char>('0' + e / 10 % 10);
+        *t++ = static_cast<char>('0' + e % 10);
+    }
+    else if (exponent >= 0)
+    {
+        t = std::copy(digits, digits + exponent + 1, t);
+        if (significant > exponent + 1)
+        {
+            *t++ = '.';
+            t = std::copy(digits + exponent + 1, digits + significant, t);
+        }
+    }
+    else
+    {
+        *t++ = '0';
+        *t++ = '.';
+        t = std::fill_n(t, -exponent - 1, '0');
+        t = std::copy(digits, digits + significant, t);
+    }
+    *t = '\0';
+    return static_cast<int>(t - text);
+}
+
+//!
+//! \brief Write a value as text the way an ostream with default settings writes a float, or an integer, and return
+//!        the length of the text
+//!
+template <typename T>
+inline int formatValue(char* text, size_t size, T value)
+{
+    return std::is_integral<T>::value ? snprintf(text, size, "%lld", static_cast<long long>(value))
+                                      : formatFloat(text, size, static_cast<float>(value));
+}
+
+//!
+//! \brief Print a buffer, with a separator between values
+//!
+//! Values are formatted in chunks by all the cores, a batch of chunks at a time to bound the memory used by the text.
+//! 8-bit integers are printed as numbers.
+//!
 template <typename T>
 inline void dumpBuffer(const void* buffer, int volume, const std::string& separator, std::ostream& os)
 {
+    constexpr int64_t kChunk{int64_t(1) << 14};
+    constexpr int64_t kBatch{256}; // Chunks formatted before being written out
     const T* typedBuffer = static_cast<const T*>(buffer);
-    std::string sep;
-    for (int v = 0; v < volume; ++v)
-    {
-        os << sep << typedBuffer[v];
-        sep = separator;
+    const int64_t chunks = (static_cast<int64_t>(volume) + kChunk - 1) / kChunk;
+    std::vector<std::string> text(std::min(chunks, kBatch));
+    for (int64_t first = 0; first < chunks; first += kBatch)
+    {
+        const int64_t batch = std::min(chunks - first, kBatch);
+        const auto format = [&](int64_t begin, int64_t end) {
+            char value[32];
+            for (int64_t c = begin; c < end; ++c)
+            {
+                std::string& chunkText = text[c];
+                chunkText.clear();
+                const int64_t valuesBegin = (first + c) * kChunk;
+                const int64_t valuesEnd = std::min<int64_t>(volume, valuesBegin + kChunk);
+                for (int64_t v = valuesBegin; v < valuesEnd; ++v)
+                {
+                    if (v)
+                    {
+                        chunkText += separator;
+                    }
+                    chunkText.append(value, formatValue(value, sizeof(value), typedBuffer[v]));
+                }
+            }
+        };
+        parallelFill(batch, format, 1, 4);
+        for (int64_t c = 0; c < batch; ++c)
+        {
+            os.write(text[c].data(), text[c].size());
+        }
     }
 }
 
@@ -347,6 +610,35 @@ public:
         }
     }
 
+    //!
+    //! \brief Transfer the inputs from a sample that holds them one after the other in binding order
+    //!
+    void transferInputToDevice(TrtCudaStream& stream, const void* sample)
+    {
+        const auto* data = static_cast<const uint8_t*>(sample);
+        for (auto& b : mBindings)
+        {
+            if (b.isInput)
+            {
+                b.buffer.hostToDevice(stream, data);
+                data += b.buffer.getSize();
+            }
+        }
+    }
+
+    //!
+    //! \brief Size of a sample of all the inputs
+    //!
+    size_t getInputSize() const
+    {
+        size_t size = 0;
+        for (const auto& b : mBindings)
+        {
+            size += b.isInput ? b.buffer.getSize() : 0;
+        }
+        return size;
+    }
+
     void transferOutputToHost(TrtCudaStream& stream)
     {
         for (auto& b : mNames)
@@ -375,6 +667,11 @@ public:
         os << dims;
     }
 
+    const Binding& getBinding(int binding) const
+    {
+        return mBindings[binding];
+    }
+
     void dumpBindingValues(int binding, std::ostream& os, const std::string& separator = " ") const
     {
         mBindings[binding].dump(os, separator);
@@ -25,6 +25,7 @@
 #include "argsParser.h"
 #include "buffers.h"
 #include "common.h"
+#include "imagePreprocess.h"
 #include "logger.h"
 
 #include "NvCaffeParser.h"
@@ -192,10 +193,9 @@ bool SampleMNIST::processInput(
 
     float* hostInputBuffer = static_cast<float*>(buffers.getHostBuffer(inputTensorName));
 
-    for (int i = 0; i < inputH * inputW; i++)
-    {
-        hostInputBuffer[i] = float(fileData[i]);
-    }
+    // The mean is subtracted by the network, so the pixels are only converted here
+    samplesCommon::normalizeImage(
+        fileData.data(), inputH, inputW, 1, samplesCommon::ImageNormalization{}, hostInputBuffer);
 
     return true;
 }
@@ -20,135 +20,181 @@
 #include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <cstring>
 #include <iostream>
-#include <map>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
 namespace nmtSample
 {
+namespace
+{
+// Samples collected before they are scored in parallel
+constexpr int kSamplesPerFlush = 4096;
+// Samples below which a thread is not worth starting
+constexpr int kMinSamplesPerThread = 256;
+
+constexpr uint64_t kFnvOffsetBasis = 14695981039346656037ULL;
+constexpr uint64_t kFnvPrime = 1099511628211ULL;
 
-typedef std::vector<std::string> Segment_t;
-typedef std::map<Segment_t, int> Count_t;
-int read(std::vector<Segment_t>& samples, std::shared_ptr<std::istream> input, int samplesToRead = 1)
+// FNV-1a, continued from hash
+uint64_t hashBytes(uint64_t hash, const char* bytes, size_t length)
 {
-    std::string line;
-    int lineCounter = 0;
-    Segment_t tokens;
-    samples.resize(0);
-    std::string pattern("@@ ");
-    while (lineCounter < samplesToRead && std::getline(*input, line))
+    for (size_t i = 0; i < length; ++i)
     {
-        // if clean and handle BPE or SPM outputs is required
-        std::size_t p0 = 0;
-        while ((p0 = line.find(pattern, p0)) != std::string::npos)
-        {
-            line.replace(p0, pattern.length(), "");
-        }
-
-        // generate error if those special characters exist. Windows needs explicit encoding.
-#ifdef _MSC_VER
-        p0 = line.find(u8"\u2581");
-#else
-        p0 = line.find("\u2581");
-#endif
-        assert((p0 == std::string::npos));
-        std::istringstream ss(line);
-        std::string token;
-        tokens.resize(0);
-        while (ss >> token)
-        {
-            tokens.emplace_back(token);
-        }
-        samples.emplace_back(tokens);
-        lineCounter++;
+        hash ^= static_cast<unsigned char>(bytes[i]);
+        hash *= kFnvPrime;
     }
-    return lineCounter;
+    return hash;
 }
 
-Count_t ngramCounts(const Segment_t& segment, int maxOrder = 4)
+uint64_t mix(uint64_t x)
 {
-    Count_t ngramCounts;
+    x ^= x >> 33;
+    x *= 0xFF51AFD7ED558CCDULL;
+    x ^= x >> 33;
+    x *= 0xC4CEB9FE1A85EC53ULL;
+    x ^= x >> 33;
+    return x;
+}
 
-    for (int order = 1; order < maxOrder + 1; order++)
-    {
-        for (int i = 0; i < static_cast<int>(segment.size()) - order + 1; i++)
-        {
-            Segment_t ngram;
-            for (int j = i; j < i + order; j++)
-                ngram.emplace_back(segment[j]);
+bool isSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+}
 
-            auto it = ngramCounts.find(ngram);
-            if (it != ngramCounts.end())
-            {
-                it->second++;
-            }
-            else
-                ngramCounts[ngram] = 1;
-        }
+struct Statistics
+{
+    explicit Statistics(int maxOrder)
+        : referenceLength(0)
+        , translationLength(0)
+        , matchesByOrder(maxOrder, 0)
+        , possibleMatchesByOrder(maxOrder, 0)
+    {
     }
 
-    return ngramCounts;
-}
+    size_t referenceLength;
+    size_t translationLength;
+    std::vector<size_t> matchesByOrder;
+    std::vector<size_t> possibleMatchesByOrder;
+};
 
-Count_t ngramCountIntersection(const Count_t& cnt0, const Count_t& cnt1)
+// Counts of the n-grams of a reference and of its translation, by n-gram hash
+class NgramCounts
 {
-    Count_t overlap;
-    // merge the maps
-    auto it0 = cnt0.begin(), it1 = cnt1.begin(), end0 = cnt0.end(), end1 = cnt1.end();
-    while (it0 != end0 && it1 != end1)
+public:
+    //! Forget the previous sample and make room for ngramCount n-grams
+    void reset(size_t ngramCount)
     {
-        if (it0->first == it1->first)
+        size_t slotCount = 64;
+        while (slotCount < ngramCount * 2)
+            slotCount *= 2;
+        if (slotCount > mEntries.size())
         {
-            overlap.emplace(it0->first, std::min(it0->second, it1->second));
-            it0++;
-            it1++;
+            mEntries.assign(slotCount, Entry{0, 0, 0, 0});
         }
         else
         {
-            if (it0->first < it1->first)
-                it0++;
-            else
-                it1++;
+            for (uint32_t slot : mUsedSlots)
+                mEntries[slot] = Entry{0, 0, 0, 0};
         }
+        mUsedSlots.clear();
     }
-    return overlap;
-}
-
-void accumulateBLEU(const std::vector<Segment_t>& referenceSamples, const std::vector<Segment_t>& outputSamples,
-    int maxOrder, size_t& referenceLength, size_t& translationLength, std::vector<size_t>& matchesByOrder,
-    std::vector<size_t>& possibleMatchesByOrder)
-{
-    assert(referenceSamples.size() == outputSamples.size());
-    auto reference = referenceSamples.begin();
-    auto translation = outputSamples.begin();
 
-    while (translation != outputSamples.end())
+    void add(uint64_t key, int order, bool reference)
     {
-        referenceLength += reference->size();
-        translationLength += translation->size();
+        size_t mask = mEntries.size() - 1;
+        size_t slot = key & mask;
+        while (mEntries[slot].order && (mEntries[slot].key != key || mEntries[slot].order != order))
+            slot = (slot + 1) & mask;
+        Entry& entry = mEntries[slot];
+        if (!entry.order)
+        {
+            entry.key = key;
+            entry.order = order;
+            mUsedSlots.push_back(static_cast<uint32_t>(slot));
+        }
+        ++(reference ? entry.referenceCount : entry.translationCount);
+    }
 
-        Count_t refNgramCounts = ngramCounts(*reference);
-        Count_t outputNgramCounts = ngramCounts(*translation);
-        Count_t overlap = ngramCountIntersection(outputNgramCounts, refNgramCounts);
-        for (auto& ngram : overlap)
+    //! Add the translation n-grams found in the reference, each counted at most as often as in the reference
+    void addMatches(std::vector<size_t>& matchesByOrder) const
+    {
+        for (uint32_t slot : mUsedSlots)
         {
-            matchesByOrder[ngram.first.size() - 1] += ngram.second;
+            const Entry& entry = mEntries[slot];
+            matchesByOrder[entry.order - 1] += std::min(entry.referenceCount, entry.translationCount);
         }
-        for (int order = 1; order < maxOrder + 1; order++)
+    }
+
+private:
+    struct Entry
+    {
+        uint64_t key;
+        uint32_t referenceCount;
+        uint32_t translationCount;
+        int order; // 0 for free slots
+    };
+
+    std::vector<Entry> mEntries;
+    std::vector<uint32_t> mUsedSlots;
+};
+
+// The key of an n-gram is computed from the key of the (n-1)-gram starting at the same word
+void addNgrams(const std::vector<uint64_t>& words, int maxOrder, bool reference, std::vector<uint64_t>& keys,
+    NgramCounts& counts)
+{
+    keys.assign(words.begin(), words.end());
+    for (int order = 1; order <= maxOrder; ++order)
+    {
+        for (int i = 0; i + order <= static_cast<int>(words.size()); ++i)
         {
-            int possibleMatches = static_cast<int>(translation->size()) - order + 1;
-            if (possibleMatches > 0)
-                possibleMatchesByOrder[order - 1] += possibleMatches;
+            keys[i] = order == 1 ? mix(words[i]) : mix(keys[i] ^ (words[i + order - 1] * kFnvPrime));
+            counts.add(keys[i], order, reference);
         }
-        ++translation;
-        ++reference;
     }
 }
 
+// Words of a reference line, with the BPE separators removed, as hashes
+void hashReferenceWords(std::string& line, std::vector<uint64_t>& words)
+{
+    // if clean and handle BPE or SPM outputs is required
+    const std::string pattern("@@ ");
+    std::size_t p0 = 0;
+    while ((p0 = line.find(pattern, p0)) != std::string::npos)
+    {
+        line.replace(p0, pattern.length(), "");
+    }
+
+    // generate error if those special characters exist. Windows needs explicit encoding.
+#ifdef _MSC_VER
+    p0 = line.find(u8"\u2581");
+#else
+    p0 = line.find("\u2581");
+#endif
+    assert((p0 == std::string::npos));
+
+    words.clear();
+    const char* p = line.data();
+    const char* end = p + line.size();
+    while (true)
+    {
+        while (p < end && isSpace(*p))
+            ++p;
+        if (p == end)
+            break;
+        const char* word = p;
+        while (p < end && !isSpace(*p))
+            ++p;
+        words.push_back(hashBytes(kFnvOffsetBasis, word, p - word));
+    }
+}
+} // namespace
+
 BLEUScoreWriter::BLEUScoreWriter(
-    std::shared_ptr<std::istream> referenceTextInput, Vocabulary::ptr vocabulary, int maxOrder)
+    std::shared_ptr<std::istream> referenceTextInput, Vocabulary::ptr vocabulary, int maxOrder, int reportInterval)
     : mReferenceInput(referenceTextInput)
     , mVocabulary(vocabulary)
     , mReferenceLength(0)
@@ -157,36 +203,124 @@ BLEUScoreWriter::BLEUScoreWriter(
     , mSmooth(false)
     , mMatchesByOrder(maxOrder, 0)
     , mPossibleMatchesByOrder(maxOrder, 0)
+    , mReportInterval(reportInterval)
+    , mSampleCount(0)
+    , mPendingSampleCount(0)
+    , mTokenOffsets(1, 0)
 {
+    // Same word splitting as DataWriter::generateText
+    const std::string delimiter = "@@";
+    for (int id = 0; id < vocabulary->getSize(); ++id)
+    {
+        std::string token = vocabulary->getToken(id);
+        bool continues = token.size() >= delimiter.size()
+            && token.compare(token.size() - delimiter.size(), delimiter.size(), delimiter) == 0;
+        if (continues)
+            token.erase(token.size() - delimiter.size());
+        mTokens += token;
+        mTokenOffsets.push_back(static_cast<uint32_t>(mTokens.size()));
+        mTokenContinues.push_back(continues);
+    }
 }
 
 void BLEUScoreWriter::write(const int* hOutputData, int actualOutputSequenceLength, int actualInputSequenceLength)
 {
-    std::vector<Segment_t> outputSamples;
-    std::vector<Segment_t> referenceSamples;
-    int numReferenceSamples = read(referenceSamples, mReferenceInput, 1);
-    assert(numReferenceSamples == 1);
-
-    Segment_t segment;
-    std::stringstream filteredSentence(DataWriter::generateText(actualOutputSequenceLength, hOutputData, mVocabulary));
-    std::string token;
-    while (filteredSentence >> token)
+    if (mPendingSampleCount == static_cast<int>(mPendingSamples.size()))
+        mPendingSamples.emplace_back();
+    PendingSample& sample = mPendingSamples[mPendingSampleCount++];
+    bool referenceRead = static_cast<bool>(std::getline(*mReferenceInput, sample.reference));
+    assert(referenceRead);
+    static_cast<void>(referenceRead);
+    sample.output.assign(hOutputData, hOutputData + actualOutputSequenceLength);
+    ++mSampleCount;
+
+    if (mReportInterval > 0 && mSampleCount % mReportInterval == 0)
+    {
+        flush();
+        sample::gLogInfo << "BLEU score of the first " << mSampleCount << " samples = " << getScore() << std::endl;
+    }
+    else if (mPendingSampleCount == kSamplesPerFlush)
     {
-        segment.emplace_back(token);
+        flush();
     }
-    outputSamples.emplace_back(segment);
+}
 
-    accumulateBLEU(referenceSamples, outputSamples, mMaxOrder, mReferenceLength, mTranslationLength, mMatchesByOrder,
-        mPossibleMatchesByOrder);
+void BLEUScoreWriter::flush()
+{
+    const int endSequenceId = mVocabulary->getEndSequenceId();
+    auto scoreSamples = [this, endSequenceId](int firstSample, int lastSample, Statistics* statistics) {
+        NgramCounts counts;
+        std::vector<uint64_t> referenceWords;
+        std::vector<uint64_t> translationWords;
+        std::vector<uint64_t> keys;
+        for (int sampleId = firstSample; sampleId < lastSample; ++sampleId)
+        {
+            PendingSample& sample = mPendingSamples[sampleId];
+            hashReferenceWords(sample.reference, referenceWords);
+
+            // Join the BPE tokens of the translation into words, dropping a word left unfinished at the end
+            translationWords.clear();
+            uint64_t word = kFnvOffsetBasis;
+            for (int id : sample.output)
+            {
+                if (id == endSequenceId)
+                    continue;
+                word = hashBytes(word, &mTokens[mTokenOffsets[id]], mTokenOffsets[id + 1] - mTokenOffsets[id]);
+                if (!mTokenContinues[id])
+                {
+                    translationWords.push_back(word);
+                    word = kFnvOffsetBasis;
+                }
+            }
+
+            statistics->referenceLength += referenceWords.size();
+            statistics->translationLength += translationWords.size();
+            counts.reset((referenceWords.size() + translationWords.size()) * mMaxOrder);
+            addNgrams(referenceWords, mMaxOrder, true, keys, counts);
+            addNgrams(translationWords, mMaxOrder, false, keys, counts);
+            counts.addMatches(statistics->matchesByOrder);
+            for (int order = 1; order < mMaxOrder + 1; order++)
+            {
+                int possibleMatches = static_cast<int>(translationWords.size()) - order + 1;
+                if (possibleMatches > 0)
+                    statistics->possibleMatchesByOrder[order - 1] += possibleMatches;
+            }
+        }
+    };
+
+    // Each thread scores a contiguous share of the samples into its own statistics
+    const int threadCount = std::max(std::min(static_cast<int>(std::thread::hardware_concurrency()),
+                                         mPendingSampleCount / kMinSamplesPerThread),
+        1);
+    std::vector<Statistics> statistics(threadCount, Statistics(mMaxOrder));
+    std::vector<std::thread> threads;
+    for (int t = 1; t < threadCount; ++t)
+        threads.emplace_back(scoreSamples, mPendingSampleCount * t / threadCount,
+            mPendingSampleCount * (t + 1) / threadCount, &statistics[t]);
+    scoreSamples(0, mPendingSampleCount / threadCount, &statistics[0]);
+    for (auto& thread : threads)
+        thread.join();
+
+    for (const auto& s : statistics)
+    {
+        mReferenceLength += s.referenceLength;
+        mTranslationLength += s.translationLength;
+        for (int i = 0; i < mMaxOrder; i++)
+        {
+            mMatchesByOrder[i] += s.matchesByOrder[i];
+            mPossibleMatchesByOrder[i] += s.possibleMatchesByOrder[i];
+        }
+    }
+    mPendingSampleCount = 0;
 }
 
 void BLEUScoreWriter::initialize() {}
 
 void BLEUScoreWriter::finalize()
 {
+    flush();
     sample::gLogInfo << "BLEU score = " << getScore() << std::endl;
 }
-
 float BLEUScoreWriter::getScore() const
 {
     std::vector<double> precisions(mMaxOrder, 0.0);
@@ -17,8 +17,10 @@
 #ifndef SAMPLE_NMT_BLEU_SCORE_WRITER_
 #define SAMPLE_NMT_BLEU_SCORE_WRITER_
 
+#include <cstdint>
 #include <istream>
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "dataWriter.h"
@@ -30,11 +32,19 @@ namespace nmtSample
  *
  * \brief all it does is to evaluate BLEU score
  *
+ * Words are hashed straight from the vocabulary IDs of the translation and from the reference text, and n-grams are
+ * counted by their 64-bit hashes. Samples are scored in chunks, in parallel, and the statistics of the chunks are
+ * added up, so the score of the samples written so far is always available.
+ *
  */
 class BLEUScoreWriter : public DataWriter
 {
 public:
-    BLEUScoreWriter(std::shared_ptr<std::istream> referenceTextInput, Vocabulary::ptr vocabulary, int maxOrder = 4);
+    /**
+     * \param reportInterval log the score every reportInterval samples, 0 to log it only in finalize()
+     */
+    BLEUScoreWriter(std::shared_ptr<std::istream> referenceTextInput, Vocabulary::ptr vocabulary, int maxOrder = 4,
+        int reportInterval = 0);
 
     void write(const int* hOutputData, int actualOutputSequenceLength, int actualInputSequenceLength) override;
 
@@ -44,11 +54,24 @@ public:
 
     std::string getInfo() override;
 
+    /**
+     * \brief get the score of the samples scored so far, which are all of them after finalize()
+     */
     float getScore() const;
 
     ~BLEUScoreWriter() override = default;
 
 private:
+    //! Sample waiting to be scored
+    struct PendingSample
+    {
+        std::string reference;
+        std::vector<int> output;
+    };
+
+    //! Score the pending samples and add their statistics
+    void flush();
+
     std::shared_ptr<std::istream> mReferenceInput;
     Vocabulary::ptr mVocabulary;
     size_t mReferenceLength;
@@ -57,6 +80,17 @@ private:
     bool mSmooth;
     std::vector<size_t> mMatchesByOrder;
     std::vector<size_t> mPossibleMatchesByOrder;
+
+    int mReportInterval;
+    int mSampleCount;
+    std::vector<PendingSample> mPendingSamples;
+    int mPendingSampleCount;
+
+    // Output vocabulary with the BPE separators removed: token i is [mTokenOffsets[i], mTokenOffsets[i + 1]) in
+    // mTokens, and mTokenContinues[i] tells whether the next token is part of the same word
+    std::string mTokens;
+    std::vector<uint32_t> mTokenOffsets;
+    std::vector<uint8_t> mTokenContinues;
 };
 } // namespace nmtSample
 
@@ -38,7 +38,8 @@ public:
     /**
      * \brief reads the batch of smaples/sequences
      *
-     * \return the actual number of samples read
+     * \return the actual number of samples read, which may be less than samplesToRead before the end of the data, 0
+     * once all the data is read
      */
     virtual int read(int samplesToRead, int maxInputSequenceLength, int* hInputData, int* hActualInputSequenceLengths)
         = 0;
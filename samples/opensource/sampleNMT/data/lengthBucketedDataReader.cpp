@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "lengthBucketedDataReader.h"
+
+#include <algorithm>
+#include <cassert>
+#include <numeric>
+#include <sstream>
+
+namespace nmtSample
+{
+LengthBucketedDataReader::LengthBucketedDataReader(int windowSize, DataReader::ptr originalDataReader)
+    : mWindowSize(windowSize)
+    , mOriginalDataReader(originalDataReader)
+    , mNextSample(0)
+    , mWindowStartPosition(0)
+    , mOriginalDataReaderDone(false)
+{
+}
+
+int LengthBucketedDataReader::read(
+    int samplesToRead, int maxInputSequenceLength, int* hInputData, int* hActualInputSequenceLengths)
+{
+    if (mNextSample == static_cast<int>(mOrder.size()) && !readWindow(maxInputSequenceLength))
+        return 0;
+
+    // The batch never spans two windows
+    int samplesRead = std::min(samplesToRead, static_cast<int>(mOrder.size()) - mNextSample);
+    std::lock_guard<std::mutex> lock(mSamplePositionsMutex);
+    for (int i = 0; i < samplesRead; ++i)
+    {
+        int sampleId = mOrder[mNextSample++];
+        std::copy_n(&mWindowData[sampleId * maxInputSequenceLength], maxInputSequenceLength,
+            hInputData + i * maxInputSequenceLength);
+        hActualInputSequenceLengths[i] = mWindowSequenceLengths[sampleId];
+        mSamplePositions.push_back(mWindowStartPosition + sampleId);
+    }
+    return samplesRead;
+}
+
+bool LengthBucketedDataReader::readWindow(int maxInputSequenceLength)
+{
+    if (mOriginalDataReaderDone)
+        return false;
+
+    mWindowStartPosition += static_cast<int>(mOrder.size());
+    mWindowData.resize(mWindowSize * maxInputSequenceLength);
+    mWindowSequenceLengths.resize(mWindowSize);
+    // The original reader may return short reads before the end of its data, only an empty read ends it
+    int windowSampleCount = 0;
+    while (windowSampleCount < mWindowSize)
+    {
+        int samplesRead = mOriginalDataReader->read(mWindowSize - windowSampleCount, maxInputSequenceLength,
+            &mWindowData[windowSampleCount * maxInputSequenceLength], &mWindowSequenceLengths[windowSampleCount]);
+        if (samplesRead == 0)
+        {
+            mOriginalDataReaderDone = true;
+            break;
+        }
+        windowSampleCount += samplesRead;
+    }
+
+    // Counting sort into one bucket per length, longest first and in reading order within a bucket
+    std::vector<int> bucketStarts(maxInputSequenceLength + 2, 0);
+    for (int sampleId = 0; sampleId < windowSampleCount; ++sampleId)
+    {
+        assert(mWindowSequenceLengths[sampleId] <= maxInputSequenceLength);
+        ++bucketStarts[maxInputSequenceLength - mWindowSequenceLengths[sampleId] + 1];
+    }
+    std::partial_sum(bucketStarts.begin(), bucketStarts.end(), bucketStarts.begin());
+    mOrder.resize(windowSampleCount);
+    for (int sampleId = 0; sampleId < windowSampleCount; ++sampleId)
+        mOrder[bucketStarts[maxInputSequenceLength - mWindowSequenceLengths[sampleId]]++] = sampleId;
+    mNextSample = 0;
+
+    return windowSampleCount > 0;
+}
+
+void LengthBucketedDataReader::reset()
+{
+    mOriginalDataReader->reset();
+    mOrder.clear();
+    mNextSample = 0;
+    mWindowStartPosition = 0;
+    mOriginalDataReaderDone = false;
+    std::lock_guard<std::mutex> lock(mSamplePositionsMutex);
+    mSamplePositions.clear();
+}
+
+int LengthBucketedDataReader::popSamplePosition()
+{
+    std::lock_guard<std::mutex> lock(mSamplePositionsMutex);
+    assert(!mSamplePositions.empty());
+    int position = mSamplePositions.front();
+    mSamplePositions.pop_front();
+    return position;
+}
+
+std::string LengthBucketedDataReader::getInfo()
+{
+    std::stringstream ss;
+    ss << "Length Bucketed Reader, window size = " << mWindowSize
+       << ", original reader info: " << mOriginalDataReader->getInfo();
+    return ss.str();
+}
+} // namespace nmtSample
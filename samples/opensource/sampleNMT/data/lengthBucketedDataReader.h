@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SAMPLE_NMT_LENGTH_BUCKETED_DATA_READER_
+#define SAMPLE_NMT_LENGTH_BUCKETED_DATA_READER_
+
+#include "dataReader.h"
+
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace nmtSample
+{
+/** \class LengthBucketedDataReader
+ *
+ * \brief wraps another data reader and returns the samples of a window grouped by length, so batches hold samples of
+ * about the same length
+ *
+ * The window is read from the original reader, bucketed by sequence length and returned longest bucket first. A read
+ * stops at the end of the window, as the longest samples of the next window would make the whole batch as long as
+ * them, so a window that is not a multiple of the batch size ends with a short batch. The position of every sample
+ * returned is queued for popSamplePosition(), for writers that need to restore the original order.
+ *
+ */
+class LengthBucketedDataReader : public DataReader
+{
+public:
+    typedef std::shared_ptr<LengthBucketedDataReader> ptr;
+
+    LengthBucketedDataReader(int windowSize, DataReader::ptr originalDataReader);
+
+    int read(int samplesToRead, int maxInputSequenceLength, int* hInputData, int* hActualInputSequenceLengths) override;
+
+    void reset() override;
+
+    /**
+     * \brief pops the position in the original data of the oldest sample returned by read()
+     */
+    int popSamplePosition();
+
+    std::string getInfo() override;
+
+    ~LengthBucketedDataReader() override = default;
+
+private:
+    bool readWindow(int maxInputSequenceLength);
+
+    int mWindowSize;
+    DataReader::ptr mOriginalDataReader;
+
+    // Samples of the current window, mOrder lists them longest first
+    std::vector<int> mWindowData;
+    std::vector<int> mWindowSequenceLengths;
+    std::vector<int> mOrder;
+    int mNextSample;
+    int mWindowStartPosition;
+    bool mOriginalDataReaderDone;
+
+    // read() and popSamplePosition() are called from different threads
+    std::mutex mSamplePositionsMutex;
+    std::deque<int> mSamplePositions;
+};
+} // namespace nmtSample
+
+#endif // SAMPLE_NMT_LENGTH_BUCKETED_DATA_READER_
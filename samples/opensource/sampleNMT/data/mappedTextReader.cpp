@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mappedTextReader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <thread>
+
+namespace nmtSample
+{
+namespace
+{
+// Bytes of text below which a thread is not worth starting
+constexpr size_t kMinBytesPerThread = 64 * 1024;
+
+// Whitespace of the classic locale, which separates tokens when they are extracted from a stream
+bool isSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+}
+} // namespace
+
+MappedTextReader::MappedTextReader(const std::string& fileName, Vocabulary::ptr vocabulary, int maxThreadCount)
+    : mFile(sample::MappedInputFile::open(fileName))
+    , mVocabulary(vocabulary)
+    , mMaxThreadCount(std::max(maxThreadCount, 1))
+    , mPosition(0)
+{
+}
+
+int MappedTextReader::read(
+    int samplesToRead, int maxInputSequenceLength, int* hInputData, int* hActualInputSequenceLengths)
+{
+    if (!mFile)
+        return 0;
+
+    const char* text = reinterpret_cast<const char*>(mFile->data());
+    const size_t size = mFile->size();
+
+    // memchr is vectorized by the C library, so finding the lines is cheap next to tokenizing them
+    mLineStarts.clear();
+    mLineStarts.push_back(text + mPosition);
+    while (static_cast<int>(mLineStarts.size()) <= samplesToRead && mPosition < size)
+    {
+        const void* newline = memchr(text + mPosition, '\n', size - mPosition);
+        mPosition = newline ? static_cast<const char*>(newline) - text + 1 : size;
+        mLineStarts.push_back(text + mPosition);
+    }
+    const int lineCount = static_cast<int>(mLineStarts.size()) - 1;
+    if (lineCount == 0)
+        return 0;
+
+    const size_t bytes = mLineStarts.back() - mLineStarts.front();
+    const int threadCount = static_cast<int>(std::min<size_t>(
+        std::min(mMaxThreadCount, lineCount), std::max<size_t>(bytes / kMinBytesPerThread, 1)));
+    if (threadCount == 1)
+    {
+        tokenizeLines(0, lineCount, maxInputSequenceLength, hInputData, hActualInputSequenceLengths);
+        return lineCount;
+    }
+
+    // Each thread tokenizes a contiguous chunk of lines into its own part of the buffers
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; ++t)
+    {
+        const int firstLine = lineCount * t / threadCount;
+        const int lastLine = lineCount * (t + 1) / threadCount;
+        threads.emplace_back(&MappedTextReader::tokenizeLines, this, firstLine, lastLine - firstLine,
+            maxInputSequenceLength, hInputData, hActualInputSequenceLengths);
+    }
+    for (auto& thread : threads)
+        thread.join();
+    return lineCount;
+}
+
+void MappedTextReader::tokenizeLines(int firstLine, int lineCount, int maxInputSequenceLength, int* hInputData,
+    int* hActualInputSequenceLengths) const
+{
+    for (int lineId = firstLine; lineId < firstLine + lineCount; ++lineId)
+    {
+        int* lineData = hInputData + maxInputSequenceLength * lineId;
+        const char* p = mLineStarts[lineId];
+        const char* end = mLineStarts[lineId + 1];
+        int tokenCounter = 0;
+        while (tokenCounter < maxInputSequenceLength)
+        {
+            while (p < end && isSpace(*p))
+                ++p;
+            if (p == end)
+                break;
+            const char* token = p;
+            while (p < end && !isSpace(*p))
+                ++p;
+            lineData[tokenCounter++] = mVocabulary->getId(token, p - token);
+        }
+
+        hActualInputSequenceLengths[lineId] = tokenCounter;
+
+        // Fill unused values with valid vocabulary ID, it doesn't necessary have to be eos
+        std::fill(lineData + tokenCounter, lineData + maxInputSequenceLength, mVocabulary->getEndSequenceId());
+    }
+}
+
+void MappedTextReader::reset()
+{
+    mPosition = 0;
+}
+
+std::string MappedTextReader::getInfo()
+{
+    std::stringstream ss;
+    ss << "Mapped Text Reader, vocabulary size = " << mVocabulary->getSize() << ", max threads = " << mMaxThreadCount;
+    return ss.str();
+}
+} // namespace nmtSample
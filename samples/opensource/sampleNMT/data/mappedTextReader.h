@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SAMPLE_NMT_MAPPED_TEXT_READER_
+#define SAMPLE_NMT_MAPPED_TEXT_READER_
+
+#include "dataReader.h"
+#include "sampleMappedFile.h"
+#include "vocabulary.h"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace nmtSample
+{
+/** \class MappedTextReader
+ *
+ * \brief reads sequences of data from a memory mapped text file, one sequence per line
+ *
+ * Tokens are split and looked up in place, without copying the text. Large batches are split into chunks of lines
+ * tokenized by separate threads.
+ *
+ */
+class MappedTextReader : public DataReader
+{
+public:
+    typedef std::shared_ptr<MappedTextReader> ptr;
+
+    /**
+     * \brief maps the file, isOpen() tells whether it succeeded, a reader that failed reads no samples
+     */
+    MappedTextReader(const std::string& fileName, Vocabulary::ptr vocabulary, int maxThreadCount);
+
+    bool isOpen() const
+    {
+        return mFile != nullptr;
+    }
+
+    int read(int samplesToRead, int maxInputSequenceLength, int* hInputData, int* hActualInputSequenceLengths) override;
+
+    void reset() override;
+
+    std::string getInfo() override;
+
+    ~MappedTextReader() override = default;
+
+private:
+    void tokenizeLines(int firstLine, int lineCount, int maxInputSequenceLength, int* hInputData,
+        int* hActualInputSequenceLengths) const;
+
+    std::unique_ptr<sample::MappedInputFile> mFile;
+    Vocabulary::ptr mVocabulary;
+    int mMaxThreadCount;
+    size_t mPosition;
+    std::vector<const char*> mLineStarts; // mLineStarts[i + 1] is right after the end of line i
+};
+} // namespace nmtSample
+
+#endif // SAMPLE_NMT_MAPPED_TEXT_READER_
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "orderRestoringDataWriter.h"
+
+#include <cassert>
+#include <sstream>
+
+namespace nmtSample
+{
+OrderRestoringDataWriter::OrderRestoringDataWriter(
+    DataWriter::ptr originalDataWriter, LengthBucketedDataReader::ptr dataReader)
+    : mOriginalDataWriter(originalDataWriter)
+    , mDataReader(dataReader)
+    , mNextPosition(0)
+{
+}
+
+void OrderRestoringDataWriter::write(
+    const int* hOutputData, int actualOutputSequenceLength, int actualInputSequenceLength)
+{
+    int position = mDataReader->popSamplePosition();
+    if (position != mNextPosition)
+    {
+        mHeldSequences.emplace(position,
+            std::make_pair(
+                std::vector<int>(hOutputData, hOutputData + actualOutputSequenceLength), actualInputSequenceLength));
+        return;
+    }
+
+    mOriginalDataWriter->write(hOutputData, actualOutputSequenceLength, actualInputSequenceLength);
+    ++mNextPosition;
+    for (auto it = mHeldSequences.begin(); it != mHeldSequences.end() && it->first == mNextPosition;
+         it = mHeldSequences.erase(it))
+    {
+        const auto& sequence = it->second.first;
+        mOriginalDataWriter->write(sequence.data(), static_cast<int>(sequence.size()), it->second.second);
+        ++mNextPosition;
+    }
+}
+
+void OrderRestoringDataWriter::initialize()
+{
+    mNextPosition = 0;
+    mHeldSequences.clear();
+    mOriginalDataWriter->initialize();
+}
+
+void OrderRestoringDataWriter::finalize()
+{
+    assert(mHeldSequences.empty());
+    mOriginalDataWriter->finalize();
+}
+
+std::string OrderRestoringDataWriter::getInfo()
+{
+    std::stringstream ss;
+    ss << "Order Restoring Writer, original writer info: " << mOriginalDataWriter->getInfo();
+    return ss.str();
+}
+} // namespace nmtSample
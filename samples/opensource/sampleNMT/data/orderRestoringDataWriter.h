@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SAMPLE_NMT_ORDER_RESTORING_DATA_WRITER_
+#define SAMPLE_NMT_ORDER_RESTORING_DATA_WRITER_
+
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "dataWriter.h"
+#include "lengthBucketedDataReader.h"
+
+namespace nmtSample
+{
+/** \class OrderRestoringDataWriter
+ *
+ * \brief wraps another data writer and passes it the sequences in the original order of the samples reordered by a
+ * LengthBucketedDataReader
+ *
+ * Sequences must be written in the order their samples were read. Those that arrive ahead of their turn are held
+ * until the samples before them are written.
+ *
+ */
+class OrderRestoringDataWriter : public DataWriter
+{
+public:
+    OrderRestoringDataWriter(DataWriter::ptr originalDataWriter, LengthBucketedDataReader::ptr dataReader);
+
+    void write(const int* hOutputData, int actualOutputSequenceLength, int actualInputSequenceLength) override;
+
+    void initialize() override;
+
+    void finalize() override;
+
+    std::string getInfo() override;
+
+    DataWriter::ptr getOriginalDataWriter() const
+    {
+        return mOriginalDataWriter;
+    }
+
+    ~OrderRestoringDataWriter() override = default;
+
+private:
+    DataWriter::ptr mOriginalDataWriter;
+    LengthBucketedDataReader::ptr mDataReader;
+    int mNextPosition;
+    // Output sequence and input length of the samples held, by position
+    std::map<int, std::pair<std::vector<int>, int>> mHeldSequences;
+};
+} // namespace nmtSample
+
+#endif // SAMPLE_NMT_ORDER_RESTORING_DATA_WRITER_
@@ -15,42 +15,211 @@
  */
 
 #include "vocabulary.h"
+#include <algorithm>
 #include <assert.h>
 #include <clocale>
+#include <cstring>
+#include <fstream>
 #include <iostream>
 #include <istream>
+#include <limits>
 
 namespace nmtSample
 {
+namespace
+{
+//! Layout of a binary vocabulary: this header, then tokenOffsets, displacements, slotIds and tokens
+struct BinaryHeader
+{
+    char magic[8];
+    uint32_t tokenCount;
+    uint32_t bucketCount;
+    uint32_t tokensSize;
+    int32_t sosId;
+    int32_t eosId;
+    int32_t unkId;
+    uint64_t seed;
+};
+
+const char kBinaryMagic[8] = {'N', 'M', 'T', 'V', 'O', 'C', 'A', 'B'};
+
+// Average number of tokens per perfect hash bucket
+constexpr uint32_t kTokensPerBucket = 4;
+
+uint64_t mix(uint64_t x)
+{
+    x ^= x >> 33;
+    x *= 0xFF51AFD7ED558CCDULL;
+    x ^= x >> 33;
+    x *= 0xC4CEB9FE1A85EC53ULL;
+    x ^= x >> 33;
+    return x;
+}
+} // namespace
+
 const std::string Vocabulary::mSosStr = "<s>";
 const std::string Vocabulary::mEosStr = "</s>";
 const std::string Vocabulary::mUnkStr = "<unk>";
 
 Vocabulary::Vocabulary()
-    : mNumTokens(0)
+    : mTokenOffsets(1, 0)
+    , mTables{}
+    , mNumTokens(0)
 {
 }
 
 void Vocabulary::add(const std::string& token)
 {
-    assert(mTokenToId.find(token) == mTokenToId.end());
-    mTokenToId[token] = mNumTokens;
-    mIdToToken.push_back(token);
+    assert(!mFile);
+    mTokens += token;
+    mTokenOffsets.push_back(static_cast<uint32_t>(mTokens.size()));
     mNumTokens++;
 }
 
+uint64_t Vocabulary::hashToken(const char* token, size_t length, uint64_t seed)
+{
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < length; ++i)
+    {
+        hash ^= static_cast<unsigned char>(token[i]);
+        hash *= 1099511628211ULL;
+    }
+    return mix(hash ^ seed);
+}
+
+uint32_t Vocabulary::getSlot(uint64_t hash, uint32_t displacement, uint32_t slotCount)
+{
+    return static_cast<uint32_t>(mix(hash + displacement * 0x9E3779B97F4A7C15ULL) % slotCount);
+}
+
+void Vocabulary::buildIndex()
+{
+    // Hash and displace: tokens are hashed into buckets, and the buckets, largest first, each look for a displacement
+    // that sends all their tokens to free slots. A seed that leaves a bucket without one is replaced.
+    const uint32_t tokenCount = static_cast<uint32_t>(mNumTokens);
+    const uint32_t bucketCount = std::max<uint32_t>((tokenCount + kTokensPerBucket - 1) / kTokensPerBucket, 1);
+    const uint32_t maxDisplacement = std::max<uint32_t>(tokenCount, 1024) * 64;
+    std::vector<uint64_t> hashes(tokenCount);
+    std::vector<std::vector<uint32_t>> buckets(bucketCount);
+    std::vector<uint32_t> bucketOrder(bucketCount);
+    std::vector<uint32_t> bucketSlots;
+    std::vector<bool> slotTaken(tokenCount);
+    uint64_t seed = 0;
+    bool built = false;
+    while (!built)
+    {
+        ++seed;
+        for (auto& bucket : buckets)
+            bucket.clear();
+        for (uint32_t id = 0; id < tokenCount; ++id)
+        {
+            hashes[id] = hashToken(&mTokens[mTokenOffsets[id]], mTokenOffsets[id + 1] - mTokenOffsets[id], seed);
+            buckets[(hashes[id] >> 32) % bucketCount].push_back(id);
+        }
+
+        // Tokens with the same hash never separate: drop repeated tokens, and change the seed for the rare different
+        // tokens with the same hash
+        bool collision = false;
+        for (auto& bucket : buckets)
+            for (size_t i = 0; i < bucket.size(); ++i)
+                for (size_t j = i + 1; j < bucket.size(); ++j)
+                {
+                    if (hashes[bucket[i]] != hashes[bucket[j]])
+                        continue;
+                    if (getToken(bucket[i]) != getToken(bucket[j]))
+                    {
+                        collision = true;
+                        continue;
+                    }
+                    assert(!"Duplicate token in the vocabulary");
+                    bucket.erase(bucket.begin() + j--);
+                }
+        if (collision)
+            continue;
+        for (uint32_t b = 0; b < bucketCount; ++b)
+            bucketOrder[b] = b;
+        std::stable_sort(bucketOrder.begin(), bucketOrder.end(),
+            [&buckets](uint32_t a, uint32_t b) { return buckets[a].size() > buckets[b].size(); });
+
+        mDisplacements.assign(bucketCount, 0);
+        mSlotIds.assign(tokenCount, 0);
+        std::fill(slotTaken.begin(), slotTaken.end(), false);
+        built = true;
+        for (uint32_t b : bucketOrder)
+        {
+            const auto& bucket = buckets[b];
+            if (bucket.empty())
+                break;
+            uint32_t displacement = 0;
+            for (; displacement < maxDisplacement; ++displacement)
+            {
+                bucketSlots.clear();
+                for (uint32_t id : bucket)
+                {
+                    uint32_t slot = getSlot(hashes[id], displacement, tokenCount);
+                    if (slotTaken[slot] || std::find(bucketSlots.begin(), bucketSlots.end(), slot) != bucketSlots.end())
+                        break;
+                    bucketSlots.push_back(slot);
+                }
+                if (bucketSlots.size() == bucket.size())
+                    break;
+            }
+            if (displacement == maxDisplacement)
+            {
+                built = false;
+                break;
+            }
+            mDisplacements[b] = displacement;
+            for (size_t i = 0; i < bucket.size(); ++i)
+            {
+                slotTaken[bucketSlots[i]] = true;
+                mSlotIds[bucketSlots[i]] = bucket[i];
+            }
+        }
+    }
+
+    mTables.tokens = mTokens.data();
+    mTables.tokenOffsets = mTokenOffsets.data();
+    mTables.displacements = mDisplacements.data();
+    mTables.slotIds = mSlotIds.data();
+    mTables.bucketCount = bucketCount;
+    mTables.seed = seed;
+}
+
+int Vocabulary::findId(const char* token, size_t length) const
+{
+    if (mNumTokens == 0)
+        return -1;
+    assert(mTables.slotIds && "The vocabulary is not read yet");
+    uint64_t hash = hashToken(token, length, mTables.seed);
+    uint32_t displacement = mTables.displacements[(hash >> 32) % mTables.bucketCount];
+    int id = mTables.slotIds[getSlot(hash, displacement, mNumTokens)];
+    // Tokens that are not in the vocabulary land on the slot of another token
+    uint32_t begin = mTables.tokenOffsets[id];
+    uint32_t end = mTables.tokenOffsets[id + 1];
+    if (end - begin == length && !memcmp(mTables.tokens + begin, token, length))
+        return id;
+    return -1;
+}
+
 int Vocabulary::getId(const std::string& token) const
 {
-    auto it = mTokenToId.find(token);
-    if (it != mTokenToId.end())
-        return it->second;
-    return mUnkId;
+    return getId(token.data(), token.size());
+}
+
+int Vocabulary::getId(const char* token, size_t length) const
+{
+    int id = findId(token, length);
+    return id >= 0 ? id : mUnkId;
 }
 
 std::string Vocabulary::getToken(int id) const
 {
     assert(id < mNumTokens);
-    return mIdToToken[id];
+    const uint32_t* tokenOffsets = mTables.tokenOffsets ? mTables.tokenOffsets : mTokenOffsets.data();
+    const char* tokens = mTables.tokens ? mTables.tokens : mTokens.data();
+    return std::string(tokens + tokenOffsets[id], tokenOffsets[id + 1] - tokenOffsets[id]);
 }
 
 int Vocabulary::getSize() const
@@ -58,6 +227,81 @@ int Vocabulary::getSize() const
     return mNumTokens;
 }
 
+bool Vocabulary::readBinary(const std::string& fileName)
+{
+    auto file = sample::MappedInputFile::open(fileName);
+    if (!file || file->size() < sizeof(BinaryHeader))
+        return false;
+    BinaryHeader header;
+    memcpy(&header, file->data(), sizeof(header));
+    if (memcmp(header.magic, kBinaryMagic, sizeof(kBinaryMagic)))
+        return false;
+    if (header.tokenCount == 0 || header.tokenCount > static_cast<uint32_t>(std::numeric_limits<int>::max())
+        || header.bucketCount == 0)
+        return false;
+    const uint64_t tableWords = static_cast<uint64_t>(header.tokenCount) * 2 + 1 + header.bucketCount;
+    const uint64_t tablesSize = tableWords * sizeof(uint32_t) + header.tokensSize;
+    if (file->size() != sizeof(BinaryHeader) + tablesSize)
+        return false;
+
+    const uint32_t* tokenOffsets = reinterpret_cast<const uint32_t*>(file->data() + sizeof(BinaryHeader));
+    const uint32_t* displacements = tokenOffsets + header.tokenCount + 1;
+    const uint32_t* slotIds = displacements + header.bucketCount;
+
+    // Lookups index the tables with these values without checking them, so a corrupt file is rejected here rather
+    // than read out of bounds later
+    if (tokenOffsets[0] != 0 || tokenOffsets[header.tokenCount] != header.tokensSize
+        || !std::is_sorted(tokenOffsets, tokenOffsets + header.tokenCount + 1))
+        return false;
+    if (std::any_of(slotIds, slotIds + header.tokenCount, [&](uint32_t id) { return id >= header.tokenCount; }))
+        return false;
+    for (int32_t id : {header.sosId, header.eosId, header.unkId})
+    {
+        if (id < 0 || static_cast<uint32_t>(id) >= header.tokenCount)
+            return false;
+    }
+
+    mTables.tokenOffsets = tokenOffsets;
+    mTables.displacements = displacements;
+    mTables.slotIds = slotIds;
+    mTables.tokens = reinterpret_cast<const char*>(slotIds + header.tokenCount);
+    mTables.bucketCount = header.bucketCount;
+    mTables.seed = header.seed;
+    mNumTokens = static_cast<int>(header.tokenCount);
+    mSosId = header.sosId;
+    mEosId = header.eosId;
+    mUnkId = header.unkId;
+
+    mTokens.clear();
+    mTokenOffsets.clear();
+    mDisplacements.clear();
+    mSlotIds.clear();
+    mFile = std::move(file);
+    return true;
+}
+
+bool Vocabulary::writeBinary(const std::string& fileName) const
+{
+    assert(mTables.slotIds && "The vocabulary is not read yet");
+    BinaryHeader header;
+    memcpy(header.magic, kBinaryMagic, sizeof(kBinaryMagic));
+    header.tokenCount = static_cast<uint32_t>(mNumTokens);
+    header.bucketCount = mTables.bucketCount;
+    header.tokensSize = mTables.tokenOffsets[mNumTokens];
+    header.sosId = mSosId;
+    header.eosId = mEosId;
+    header.unkId = mUnkId;
+    header.seed = mTables.seed;
+
+    std::ofstream output(fileName, std::ios::binary);
+    output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    output.write(reinterpret_cast<const char*>(mTables.tokenOffsets), (mNumTokens + 1) * sizeof(uint32_t));
+    output.write(reinterpret_cast<const char*>(mTables.displacements), mTables.bucketCount * sizeof(uint32_t));
+    output.write(reinterpret_cast<const char*>(mTables.slotIds), mNumTokens * sizeof(uint32_t));
+    output.write(mTables.tokens, header.tokensSize);
+    return output.good();
+}
+
 std::istream& operator>>(std::istream& input, Vocabulary& value)
 {
     // stream should contain "<s>", "</s>" and "<unk>" tokens
@@ -69,23 +313,16 @@ std::istream& operator>>(std::istream& input, Vocabulary& value)
         value.add(word);
     }
 
-    {
-        auto it = value.mTokenToId.find(Vocabulary::mSosStr);
-        assert(it != value.mTokenToId.end());
-        value.mSosId = it->second;
-    }
+    value.buildIndex();
 
-    {
-        auto it = value.mTokenToId.find(Vocabulary::mEosStr);
-        assert(it != value.mTokenToId.end());
-        value.mEosId = it->second;
-    }
+    value.mSosId = value.findId(Vocabulary::mSosStr.data(), Vocabulary::mSosStr.size());
+    assert(value.mSosId >= 0);
 
-    {
-        auto it = value.mTokenToId.find(Vocabulary::mUnkStr);
-        assert(it != value.mTokenToId.end());
-        value.mUnkId = it->second;
-    }
+    value.mEosId = value.findId(Vocabulary::mEosStr.data(), Vocabulary::mEosStr.size());
+    assert(value.mEosId >= 0);
+
+    value.mUnkId = value.findId(Vocabulary::mUnkStr.data(), Vocabulary::mUnkStr.size());
+    assert(value.mUnkId >= 0);
 
     return input;
 }
@@ -17,11 +17,13 @@
 #ifndef SAMPLE_NMT_VOCABULARY_
 #define SAMPLE_NMT_VOCABULARY_
 
-#include <map>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
 
+#include "sampleMappedFile.h"
 #include "sequenceProperties.h"
 
 namespace nmtSample
@@ -30,6 +32,10 @@ namespace nmtSample
  *
  * \brief String<->Id bijection storage
  *
+ * Tokens are stored back to back in a single string, and looked up with a minimal perfect hash. The same tables can be
+ * written to a binary file and mapped from it, so a large vocabulary is loaded without parsing and its pages are
+ * shared by the processes using it.
+ *
  */
 class Vocabulary : public SequenceProperties
 {
@@ -38,10 +44,26 @@ public:
 
     Vocabulary();
 
+    Vocabulary(const Vocabulary&) = delete;
+    Vocabulary& operator=(const Vocabulary&) = delete;
+
     friend std::istream& operator>>(std::istream& input, Vocabulary& value);
 
     /**
-     * \brief add new token to vocabulary, ID is auto-generated
+     * \brief map a vocabulary written by writeBinary, it stays mapped for the lifetime of the vocabulary
+     *
+     * \return false if the file cannot be mapped, is not a binary vocabulary or has tables that are out of bounds
+     */
+    bool readBinary(const std::string& fileName);
+
+    /**
+     * \brief write the vocabulary in the binary format of readBinary, for machines of the same endianness
+     */
+    bool writeBinary(const std::string& fileName) const;
+
+    /**
+     * \brief add new token to vocabulary, ID is auto-generated; tokens can be looked up once the whole vocabulary is
+     * read
      */
     void add(const std::string& token);
 
@@ -50,6 +72,11 @@ public:
      */
     int getId(const std::string& token) const;
 
+    /**
+     * \brief get the ID of the token of length characters at token, which does not need to be null-terminated
+     */
+    int getId(const char* token, size_t length) const;
+
     /**
      * \brief get token by ID
      */
@@ -65,12 +92,37 @@ public:
     int getEndSequenceId() override;
 
 private:
+    //! Tables of the vocabulary, owned by the vocabulary or mapped from a binary file
+    struct Tables
+    {
+        const char* tokens;              //!< All the tokens, back to back
+        const uint32_t* tokenOffsets;    //!< Token i is [tokenOffsets[i], tokenOffsets[i + 1]) in tokens
+        const uint32_t* displacements;   //!< Perfect hash displacement of each bucket
+        const uint32_t* slotIds;         //!< ID of the token in each slot of the perfect hash
+        uint32_t bucketCount;
+        uint64_t seed;
+    };
+
+    //! Build the perfect hash of the tokens added and find the special tokens
+    void buildIndex();
+
+    //! ID of the token, or -1 if it is not in the vocabulary
+    int findId(const char* token, size_t length) const;
+
+    static uint64_t hashToken(const char* token, size_t length, uint64_t seed);
+
+    static uint32_t getSlot(uint64_t hash, uint32_t displacement, uint32_t slotCount);
+
     static const std::string mSosStr;
     static const std::string mUnkStr;
     static const std::string mEosStr;
 
-    std::map<std::string, int> mTokenToId;
-    std::vector<std::string> mIdToToken;
+    std::string mTokens;
+    std::vector<uint32_t> mTokenOffsets;
+    std::vector<uint32_t> mDisplacements;
+    std::vector<uint32_t> mSlotIds;
+    std::unique_ptr<sample::MappedInputFile> mFile;
+    Tables mTables;
     int mNumTokens;
 
     int mSosId;
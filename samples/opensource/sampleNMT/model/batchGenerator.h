@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SAMPLE_NMT_BATCH_GENERATOR_
+#define SAMPLE_NMT_BATCH_GENERATOR_
+
+#include <memory>
+
+#include "../component.h"
+
+namespace nmtSample
+{
+/** \class BatchGenerator
+ *
+ * \brief runs the encoder and the generator on a batch of slots, each slot holding one sample and its beamWidth rays
+ *
+ * Slots are numbered from 0 and the busy ones are always [0, slotCount). The per-slot state (memory states, decoder
+ * states, attention, ...) stays with the generator, so samples can be encoded into free slots and moved between slots
+ * while the others are being generated.
+ *
+ */
+class BatchGenerator : public Component
+{
+public:
+    typedef std::shared_ptr<BatchGenerator> ptr;
+
+    BatchGenerator() = default;
+
+    /**
+     * \brief encode sampleCount samples into slots [firstSlot, firstSlot + sampleCount) and prepare the states for
+     * their first timestep; hInputData holds maxInputSequenceLength tokens per sample
+     *
+     * \return false if the encoder failed
+     */
+    virtual bool encode(int firstSlot, int sampleCount, const int* hInputData, const int* hActualInputSequenceLengths)
+        = 0;
+
+    /**
+     * \brief move the state of the sample in fromSlot, as left by the last timestep, into toSlot
+     */
+    virtual void moveSlot(int fromSlot, int toSlot) = 0;
+
+    /**
+     * \brief start a timestep for slots [0, slotCount)
+     *
+     * The input states of the rays of slots [0, shuffledSlotCount) are those output at the last timestep by the rays
+     * in hSourceRayIndices; the other slots have just been encoded. hInputTokens and hInputLikelihoods hold the
+     * token and the likelihood of each ray.
+     *
+     * \return false if the generator failed
+     */
+    virtual bool startTimestep(int slotCount, int shuffledSlotCount, const int* hSourceRayIndices,
+        const int* hInputTokens, const float* hInputLikelihoods)
+        = 0;
+
+    /**
+     * \brief wait for the timestep to finish and read the beamWidth best options of each slot
+     */
+    virtual void finishTimestep(
+        int slotCount, float* hCombinedLikelihoods, int* hVocabularyIndices, int* hRayOptionIndices)
+        = 0;
+
+    ~BatchGenerator() override = default;
+};
+} // namespace nmtSample
+
+#endif // SAMPLE_NMT_BATCH_GENERATOR_
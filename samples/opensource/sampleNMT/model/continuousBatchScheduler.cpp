@@ -0,0 +1,308 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "continuousBatchScheduler.h"
+#ifdef _MSC_VER
+// Macro definition needed to avoid name collision with std::min/max and Windows.h min/max
+#define NOMINMAX
+#endif
+#include <algorithm>
+#include <cassert>
+#include <sstream>
+
+namespace nmtSample
+{
+ContinuousBatchScheduler::ContinuousBatchScheduler(int startSequenceId, int endSequenceId,
+    LikelihoodCombinationOperator::ptr likelihoodCombinationOperator, int beamWidth, int maxSlotCount,
+    int minRefillCount)
+    : mStartSequenceId(startSequenceId)
+    , mEndSequenceId(endSequenceId)
+    , mLikelihoodCombinationOperator(likelihoodCombinationOperator)
+    , mBeamWidth(beamWidth)
+    , mMaxSlotCount(maxSlotCount)
+    , mMinRefillCount(std::max(minRefillCount, 1))
+    , mSourceRayIndices(maxSlotCount * beamWidth)
+    , mInputTokens(maxSlotCount * beamWidth)
+    , mInputLikelihoods(maxSlotCount * beamWidth)
+{
+    mSlots.reserve(maxSlotCount);
+}
+
+bool ContinuousBatchScheduler::translate(DataReader& dataReader, DataWriter& dataWriter, BatchGenerator& generator,
+    int maxInputSequenceLength, int maxOutputSequenceLength)
+{
+    // Samples read ahead of the free slots, packed at the front of the buffers
+    std::vector<int> pendingData(mMaxSlotCount * maxInputSequenceLength);
+    std::vector<int> pendingLengths(mMaxSlotCount);
+    int pendingCount = 0;
+    bool readerDone = false;
+    auto readPending = [&]() {
+        const int samplesToRead = mMaxSlotCount - pendingCount;
+        if (readerDone || samplesToRead == 0)
+            return;
+        const int samplesRead = dataReader.read(samplesToRead, maxInputSequenceLength,
+            &pendingData[pendingCount * maxInputSequenceLength], &pendingLengths[pendingCount]);
+        pendingCount += samplesRead;
+        readerDone = samplesRead == 0;
+    };
+
+    std::vector<int> sampleIds(mMaxSlotCount);
+    std::vector<int> maxOutputSequenceLengths(mMaxSlotCount);
+    std::vector<float> combinedLikelihoods(mMaxSlotCount * mBeamWidth);
+    std::vector<int> vocabularyIndices(mMaxSlotCount * mBeamWidth);
+    std::vector<int> rayOptionIndices(mMaxSlotCount * mBeamWidth);
+    std::map<int, FinishedSample> unwrittenSamples;
+    int nextSampleId = 0;
+    int nextWrittenSampleId = 0;
+    int shuffledSlotCount = 0;
+
+    readPending();
+    while (true)
+    {
+        // Refill once enough slots are free for the encoder run to pay off, or when nothing else is left to do
+        const int refillCount = std::min(mMaxSlotCount - getBusySlotCount(), pendingCount);
+        if (refillCount > 0
+            && (refillCount >= mMinRefillCount || getBusySlotCount() == 0
+                || (readerDone && refillCount == pendingCount)))
+        {
+            if (!generator.encode(getBusySlotCount(), refillCount, pendingData.data(), pendingLengths.data()))
+                return false;
+            for (int i = 0; i < refillCount; ++i)
+            {
+                sampleIds[i] = nextSampleId++;
+                // Limit output sequences length to input_sequence_length * 2
+                maxOutputSequenceLengths[i] = pendingLengths[i] * 2;
+                if (maxOutputSequenceLength >= 0)
+                    maxOutputSequenceLengths[i] = std::min(maxOutputSequenceLengths[i], maxOutputSequenceLength);
+            }
+            admit(refillCount, sampleIds.data(), pendingLengths.data(), maxOutputSequenceLengths.data());
+            ++mEncoderBatchCount;
+
+            std::copy(pendingData.begin() + refillCount * maxInputSequenceLength,
+                pendingData.begin() + pendingCount * maxInputSequenceLength, pendingData.begin());
+            std::copy(pendingLengths.begin() + refillCount, pendingLengths.begin() + pendingCount,
+                pendingLengths.begin());
+            pendingCount -= refillCount;
+        }
+
+        const int slotCount = getBusySlotCount();
+        if (slotCount == 0)
+        {
+            // A short read only means that the reader had fewer samples at hand, the data ends with an empty one
+            if (readerDone)
+                break;
+            readPending();
+            continue;
+        }
+
+        if (!generator.startTimestep(slotCount, shuffledSlotCount, getSourceRayIndices(), getInputTokens(),
+                getInputLikelihoods()))
+            return false;
+        // Overlap host and device: read the next samples while the generator is running
+        readPending();
+        generator.finishTimestep(
+            slotCount, combinedLikelihoods.data(), vocabularyIndices.data(), rayOptionIndices.data());
+        ++mTimestepCount;
+        mBusySlotTimesteps += slotCount;
+
+        processTimestep(combinedLikelihoods.data(), vocabularyIndices.data(), rayOptionIndices.data());
+        for (const auto& move : mSlotMoves)
+            generator.moveSlot(move.first, move.second);
+        shuffledSlotCount = getBusySlotCount();
+
+        for (auto& sample : mFinishedSamples)
+            unwrittenSamples.emplace(sample.sampleId, std::move(sample));
+        for (auto it = unwrittenSamples.find(nextWrittenSampleId); it != unwrittenSamples.end();
+             it = unwrittenSamples.find(nextWrittenSampleId))
+        {
+            const auto& sample = it->second;
+            dataWriter.write(sample.outputData.data(), static_cast<int>(sample.outputData.size()),
+                sample.actualInputSequenceLength);
+            unwrittenSamples.erase(it);
+            ++nextWrittenSampleId;
+        }
+    }
+    assert(unwrittenSamples.empty());
+    return true;
+}
+
+void ContinuousBatchScheduler::admit(int sampleCount, const int* sampleIds, const int* actualInputSequenceLengths,
+    const int* maxOutputSequenceLengths)
+{
+    assert(getBusySlotCount() + sampleCount <= mMaxSlotCount);
+    for (int i = 0; i < sampleCount; ++i)
+    {
+        const int slotId = getBusySlotCount();
+        Slot slot;
+        slot.sampleId = sampleIds[i];
+        slot.actualInputSequenceLength = actualInputSequenceLengths[i];
+        slot.maxOutputSequenceLength = maxOutputSequenceLengths[i];
+        slot.timestepId = 0;
+        slot.candidateLikelihood = mLikelihoodCombinationOperator->smallerThanMinimalLikelihood();
+        mSlots.push_back(std::move(slot));
+
+        // The first timestep expands the first ray only
+        for (int rayId = 0; rayId < mBeamWidth; ++rayId)
+        {
+            mSourceRayIndices[slotId * mBeamWidth + rayId] = 0;
+            mInputTokens[slotId * mBeamWidth + rayId] = mStartSequenceId;
+            mInputLikelihoods[slotId * mBeamWidth + rayId] = rayId == 0
+                ? mLikelihoodCombinationOperator->init()
+                : mLikelihoodCombinationOperator->smallerThanMinimalLikelihood();
+        }
+    }
+}
+
+void ContinuousBatchScheduler::processTimestep(
+    const float* hCombinedLikelihoods, const int* hVocabularyIndices, const int* hRayOptionIndices)
+{
+    mFinishedSamples.clear();
+    mSlotMoves.clear();
+
+    const int slotCount = getBusySlotCount();
+    std::vector<bool> finished(slotCount);
+    for (int slotId = 0; slotId < slotCount; ++slotId)
+    {
+        auto& slot = mSlots[slotId];
+        ++slot.timestepId;
+        slot.beamSearchTable.resize(slot.timestepId * mBeamWidth);
+        auto currentBeamSearchTable = slot.beamSearchTable.begin() + (slot.timestepId - 1) * mBeamWidth;
+        auto currentSourceRayIndices = &mSourceRayIndices[slotId * mBeamWidth];
+        auto currentLikelihoods = &mInputLikelihoods[slotId * mBeamWidth];
+        auto currentTokens = &mInputTokens[slotId * mBeamWidth];
+
+        int rayId = 0;
+        for (; rayId < mBeamWidth; ++rayId)
+        {
+            float optionCombinedLikelihood = hCombinedLikelihoods[slotId * mBeamWidth + rayId];
+
+            // Check if the current candidate is already better than this option
+            if (optionCombinedLikelihood <= slot.candidateLikelihood)
+                break; // The remaining options are even worse
+
+            int optionOriginalRayId = hRayOptionIndices[slotId * mBeamWidth + rayId] / mBeamWidth;
+            int optionVocabularyId = hVocabularyIndices[slotId * mBeamWidth + rayId];
+
+            if ((optionVocabularyId == mEndSequenceId) || (slot.timestepId >= slot.maxOutputSequenceLength))
+            {
+                // We have a new candidate output sequence for the sample
+                slot.candidateLikelihood = optionCombinedLikelihood;
+                slot.candidate.resize(slot.timestepId);
+                backtrack(slot, slot.timestepId - 2, optionOriginalRayId, &slot.candidate[0], slot.timestepId - 2);
+                slot.candidate[slot.timestepId - 1] = optionVocabularyId;
+                break;
+            }
+
+            currentSourceRayIndices[rayId] = optionOriginalRayId;
+            currentLikelihoods[rayId] = optionCombinedLikelihood;
+            currentTokens[rayId] = optionVocabularyId;
+            (currentBeamSearchTable + rayId)->vocabularyId = optionVocabularyId;
+            (currentBeamSearchTable + rayId)->backtrackId = optionOriginalRayId;
+        }
+
+        // No valid rays left for the sample
+        finished[slotId] = rayId == 0;
+        if (finished[slotId])
+            retire(slot);
+
+        // Mark the remaining rays as invalid ones
+        for (; rayId < mBeamWidth; ++rayId)
+        {
+            currentSourceRayIndices[rayId] = 0;
+            currentLikelihoods[rayId] = mLikelihoodCombinationOperator->smallerThanMinimalLikelihood();
+            currentTokens[rayId] = mEndSequenceId;
+            (currentBeamSearchTable + rayId)->vocabularyId = mEndSequenceId;
+            (currentBeamSearchTable + rayId)->backtrackId = 0;
+        }
+    }
+
+    // Fill the slots of finished samples with the samples at the end of the batch
+    int busySlotCount = slotCount;
+    for (int slotId = 0; slotId < busySlotCount;)
+    {
+        if (!finished[slotId])
+        {
+            ++slotId;
+            continue;
+        }
+        const int lastSlotId = --busySlotCount;
+        if (lastSlotId != slotId)
+        {
+            if (!finished[lastSlotId])
+                mSlotMoves.emplace_back(lastSlotId, slotId);
+            moveSlot(lastSlotId, slotId);
+            finished[slotId] = finished[lastSlotId];
+        }
+    }
+    mSlots.resize(busySlotCount);
+}
+
+void ContinuousBatchScheduler::retire(Slot& slot)
+{
+    FinishedSample sample;
+    sample.sampleId = slot.sampleId;
+    sample.actualInputSequenceLength = slot.actualInputSequenceLength;
+    if (slot.candidateLikelihood > mLikelihoodCombinationOperator->smallerThanMinimalLikelihood())
+    {
+        // We have a candidate (finished sequence)
+        sample.outputData = std::move(slot.candidate);
+    }
+    else
+    {
+        // No ray could be extended, output the best one of the last timestep
+        sample.outputData.resize(slot.timestepId - 1);
+        if (!sample.outputData.empty())
+            backtrack(slot, slot.timestepId - 2, 0, &sample.outputData[0], slot.timestepId - 2);
+    }
+    mFinishedSamples.push_back(std::move(sample));
+}
+
+void ContinuousBatchScheduler::moveSlot(int fromSlot, int toSlot)
+{
+    mSlots[toSlot] = std::move(mSlots[fromSlot]);
+    std::copy_n(&mSourceRayIndices[fromSlot * mBeamWidth], mBeamWidth, &mSourceRayIndices[toSlot * mBeamWidth]);
+    std::copy_n(&mInputTokens[fromSlot * mBeamWidth], mBeamWidth, &mInputTokens[toSlot * mBeamWidth]);
+    std::copy_n(&mInputLikelihoods[fromSlot * mBeamWidth], mBeamWidth, &mInputLikelihoods[toSlot * mBeamWidth]);
+}
+
+void ContinuousBatchScheduler::backtrack(
+    const Slot& slot, int lastTimestepId, int lastTimestepRayId, int* hOutputData, int lastTimestepWriteId) const
+{
+    int rayId = lastTimestepRayId;
+    for (int timestepId = lastTimestepId; timestepId >= 0; --timestepId)
+    {
+        const auto& entry = slot.beamSearchTable[timestepId * mBeamWidth + rayId];
+        rayId = entry.backtrackId;
+        if (timestepId <= lastTimestepWriteId)
+            hOutputData[timestepId] = entry.vocabularyId;
+    }
+}
+
+float ContinuousBatchScheduler::getSlotOccupancy() const
+{
+    if (mTimestepCount == 0)
+        return 0.0F;
+    return static_cast<float>(mBusySlotTimesteps) / (static_cast<float>(mTimestepCount) * mMaxSlotCount);
+}
+
+std::string ContinuousBatchScheduler::getInfo()
+{
+    std::stringstream ss;
+    ss << "Continuous Batch Scheduler, beam = " << mBeamWidth << ", slots = " << mMaxSlotCount
+       << ", min refill = " << mMinRefillCount;
+    return ss.str();
+}
+} // namespace nmtSample
@@ -0,0 +1,179 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SAMPLE_NMT_CONTINUOUS_BATCH_SCHEDULER_
+#define SAMPLE_NMT_CONTINUOUS_BATCH_SCHEDULER_
+
+#include "../component.h"
+#include "../data/dataReader.h"
+#include "../data/dataWriter.h"
+#include "batchGenerator.h"
+#include "likelihoodCombinationOperator.h"
+
+#include <map>
+#include <utility>
+#include <vector>
+
+namespace nmtSample
+{
+/** \class ContinuousBatchScheduler
+ *
+ * \brief translates with in-flight batching: samples leave the batch as soon as their beam search is over, and the
+ * free slots are refilled with newly encoded samples between generator timesteps
+ *
+ * The beam search itself is the one of BeamSearchPolicy, but each slot keeps its own beam search table and timestep,
+ * since the samples in a batch start at different timesteps. Finished samples are compacted out by moving the samples
+ * at the end of the batch into their slots, so the busy slots stay contiguous. Translations are written in the order
+ * the samples were read.
+ *
+ */
+class ContinuousBatchScheduler : public Component
+{
+public:
+    typedef std::shared_ptr<ContinuousBatchScheduler> ptr;
+
+    /**
+     * \param maxSlotCount the batch size of the generator
+     * \param minRefillCount the number of free slots worth running the encoder for while other samples are in flight
+     */
+    ContinuousBatchScheduler(int startSequenceId, int endSequenceId,
+        LikelihoodCombinationOperator::ptr likelihoodCombinationOperator, int beamWidth, int maxSlotCount,
+        int minRefillCount);
+
+    /**
+     * \brief translate all the samples of the reader, output sequences are limited to twice the input length and to
+     * maxOutputSequenceLength when it is not negative
+     *
+     * \return false if the generator failed
+     */
+    bool translate(DataReader& dataReader, DataWriter& dataWriter, BatchGenerator& generator,
+        int maxInputSequenceLength, int maxOutputSequenceLength);
+
+    /**
+     * \brief add sampleCount samples in the slots following the busy ones
+     */
+    void admit(int sampleCount, const int* sampleIds, const int* actualInputSequenceLengths,
+        const int* maxOutputSequenceLengths);
+
+    /**
+     * \brief process the options of the busy slots, retire the samples that are done and compact the busy slots
+     *
+     * Results of retired samples are available from getFinishedSamples() and the slot moves to replay on the generator
+     * from getSlotMoves(), both until the next call.
+     */
+    void processTimestep(
+        const float* hCombinedLikelihoods, const int* hVocabularyIndices, const int* hRayOptionIndices);
+
+    struct FinishedSample
+    {
+        int sampleId;
+        int actualInputSequenceLength;
+        std::vector<int> outputData;
+    };
+
+    const std::vector<FinishedSample>& getFinishedSamples() const
+    {
+        return mFinishedSamples;
+    }
+
+    //! Pairs of (fromSlot, toSlot)
+    const std::vector<std::pair<int, int>>& getSlotMoves() const
+    {
+        return mSlotMoves;
+    }
+
+    int getBusySlotCount() const
+    {
+        return static_cast<int>(mSlots.size());
+    }
+
+    //! Inputs of the next timestep, beamWidth values per busy slot
+    const int* getSourceRayIndices() const
+    {
+        return mSourceRayIndices.data();
+    }
+    const int* getInputTokens() const
+    {
+        return mInputTokens.data();
+    }
+    const float* getInputLikelihoods() const
+    {
+        return mInputLikelihoods.data();
+    }
+
+    int getTimestepCount() const
+    {
+        return mTimestepCount;
+    }
+
+    int getEncoderBatchCount() const
+    {
+        return mEncoderBatchCount;
+    }
+
+    //! Average fraction of the slots that were busy during the timesteps
+    float getSlotOccupancy() const;
+
+    std::string getInfo() override;
+
+    ~ContinuousBatchScheduler() override = default;
+
+private:
+    struct Ray
+    {
+        int vocabularyId;
+        int backtrackId;
+    };
+
+    struct Slot
+    {
+        int sampleId;
+        int actualInputSequenceLength;
+        int maxOutputSequenceLength;
+        int timestepId;
+        std::vector<Ray> beamSearchTable; // beamWidth rays per timestep
+        std::vector<int> candidate;
+        float candidateLikelihood;
+    };
+
+    void backtrack(
+        const Slot& slot, int lastTimestepId, int lastTimestepRayId, int* hOutputData, int lastTimestepWriteId) const;
+
+    void retire(Slot& slot);
+
+    void moveSlot(int fromSlot, int toSlot);
+
+    int mStartSequenceId;
+    int mEndSequenceId;
+    LikelihoodCombinationOperator::ptr mLikelihoodCombinationOperator;
+    int mBeamWidth;
+    int mMaxSlotCount;
+    int mMinRefillCount;
+
+    std::vector<Slot> mSlots;
+    std::vector<int> mSourceRayIndices;
+    std::vector<int> mInputTokens;
+    std::vector<float> mInputLikelihoods;
+    std::vector<FinishedSample> mFinishedSamples;
+    std::vector<std::pair<int, int>> mSlotMoves;
+
+    int mTimestepCount{0};
+    int mEncoderBatchCount{0};
+    long long mBusySlotTimesteps{0};
+};
+} // namespace nmtSample
+
+#endif // SAMPLE_NMT_CONTINUOUS_BATCH_SCHEDULER_
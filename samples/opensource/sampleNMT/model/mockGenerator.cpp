@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mockGenerator.h"
+#ifdef _MSC_VER
+// Macro definition needed to avoid name collision with std::min/max and Windows.h min/max
+#define NOMINMAX
+#endif
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <sstream>
+
+namespace nmtSample
+{
+namespace
+{
+uint64_t mix(uint64_t h)
+{
+    h += 0x9e3779b97f4a7c15ULL;
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+    return h ^ (h >> 31);
+}
+
+// Sorts the first count indices of values in decreasing order, breaking ties by index
+template <typename T>
+void topIndices(const std::vector<T>& values, std::vector<int>& indices, int count)
+{
+    indices.resize(values.size());
+    std::iota(indices.begin(), indices.end(), 0);
+    std::partial_sort(indices.begin(), indices.begin() + count, indices.end(),
+        [&values](int a, int b) { return values[a] > values[b] || (values[a] == values[b] && a < b); });
+}
+} // namespace
+
+MockGenerator::MockGenerator(int vocabularySize, int endSequenceId,
+    LikelihoodCombinationOperator::ptr likelihoodCombinationOperator, int beamWidth, int maxSlotCount,
+    int maxInputSequenceLength)
+    : mVocabularySize(vocabularySize)
+    , mEndSequenceId(endSequenceId)
+    , mLikelihoodCombinationOperator(likelihoodCombinationOperator)
+    , mBeamWidth(beamWidth)
+    , mMaxInputSequenceLength(maxInputSequenceLength)
+    , mOptionCount(std::max(beamWidth, 8))
+    , mMemory(maxSlotCount * maxInputSequenceLength)
+    , mActualInputSequenceLengths(maxSlotCount)
+    , mInputStates(maxSlotCount * beamWidth)
+    , mOutputStates(maxSlotCount * beamWidth)
+    , mCombinedLikelihoods(maxSlotCount * beamWidth)
+    , mVocabularyIndices(maxSlotCount * beamWidth)
+    , mRayOptionIndices(maxSlotCount * beamWidth)
+{
+}
+
+bool MockGenerator::encode(
+    int firstSlot, int sampleCount, const int* hInputData, const int* hActualInputSequenceLengths)
+{
+    std::copy_n(hInputData, sampleCount * mMaxInputSequenceLength, &mMemory[firstSlot * mMaxInputSequenceLength]);
+    std::copy_n(hActualInputSequenceLengths, sampleCount, &mActualInputSequenceLengths[firstSlot]);
+    for (int slotId = firstSlot; slotId < firstSlot + sampleCount; ++slotId)
+    {
+        // Initialize the decoder states from the source sentence
+        uint64_t history = 0;
+        for (int i = 0; i < mActualInputSequenceLengths[slotId]; ++i)
+            history = mix(history ^ static_cast<uint64_t>(mMemory[slotId * mMaxInputSequenceLength + i]));
+        std::fill_n(&mInputStates[slotId * mBeamWidth], mBeamWidth, RayState{history, 0});
+    }
+    return true;
+}
+
+void MockGenerator::moveSlot(int fromSlot, int toSlot)
+{
+    std::copy_n(&mMemory[fromSlot * mMaxInputSequenceLength], mMaxInputSequenceLength,
+        &mMemory[toSlot * mMaxInputSequenceLength]);
+    mActualInputSequenceLengths[toSlot] = mActualInputSequenceLengths[fromSlot];
+    std::copy_n(&mOutputStates[fromSlot * mBeamWidth], mBeamWidth, &mOutputStates[toSlot * mBeamWidth]);
+}
+
+bool MockGenerator::startTimestep(int slotCount, int shuffledSlotCount, const int* hSourceRayIndices,
+    const int* hInputTokens, const float* hInputLikelihoods)
+{
+    // Beam shuffle
+    for (int rayId = 0; rayId < shuffledSlotCount * mBeamWidth; ++rayId)
+        mInputStates[rayId] = mOutputStates[rayId - rayId % mBeamWidth + hSourceRayIndices[rayId]];
+
+    std::vector<float> probabilities(mOptionCount);
+    std::vector<int> tokens(mOptionCount);
+    std::vector<float> rayOptionLikelihoods(mBeamWidth * mBeamWidth);
+    std::vector<int> rayOptionTokens(mBeamWidth * mBeamWidth);
+    std::vector<int> order;
+    for (int slotId = 0; slotId < slotCount; ++slotId)
+    {
+        const int* source = &mMemory[slotId * mMaxInputSequenceLength];
+        const int length = mActualInputSequenceLengths[slotId];
+        for (int rayId = 0; rayId < mBeamWidth; ++rayId)
+        {
+            const int globalRayId = slotId * mBeamWidth + rayId;
+            const RayState& input = mInputStates[globalRayId];
+            RayState& output = mOutputStates[globalRayId];
+            output.history = mix(input.history ^ static_cast<uint64_t>(hInputTokens[globalRayId]));
+            output.position = input.position + 1;
+
+            // Softmax over the end of sequence token and a few tokens picked from the state and the source
+            const uint64_t context = mix(output.history + (length ? source[input.position % length] : 0));
+            float sum = 0.0F;
+            for (int optionId = 0; optionId < mOptionCount; ++optionId)
+            {
+                const uint64_t h = mix(context + optionId);
+                float logit;
+                if (optionId == 0)
+                {
+                    tokens[optionId] = mEndSequenceId;
+                    logit = output.position > length ? 4.0F : -4.0F;
+                }
+                else
+                {
+                    tokens[optionId] = static_cast<int>(h % mVocabularySize);
+                    logit = static_cast<float>((h >> 40) % 1000) / 250.0F;
+                }
+                probabilities[optionId] = std::exp(logit);
+                sum += probabilities[optionId];
+            }
+            for (auto& p : probabilities)
+                p /= sum;
+
+            topIndices(probabilities, order, mBeamWidth);
+            for (int i = 0; i < mBeamWidth; ++i)
+            {
+                rayOptionLikelihoods[rayId * mBeamWidth + i]
+                    = mLikelihoodCombinationOperator->combine(hInputLikelihoods[globalRayId], probabilities[order[i]]);
+                rayOptionTokens[rayId * mBeamWidth + i] = tokens[order[i]];
+            }
+        }
+
+        topIndices(rayOptionLikelihoods, order, mBeamWidth);
+        for (int i = 0; i < mBeamWidth; ++i)
+        {
+            mCombinedLikelihoods[slotId * mBeamWidth + i] = rayOptionLikelihoods[order[i]];
+            mVocabularyIndices[slotId * mBeamWidth + i] = rayOptionTokens[order[i]];
+            mRayOptionIndices[slotId * mBeamWidth + i] = order[i];
+        }
+    }
+    return true;
+}
+
+void MockGenerator::finishTimestep(
+    int slotCount, float* hCombinedLikelihoods, int* hVocabularyIndices, int* hRayOptionIndices)
+{
+    std::copy_n(mCombinedLikelihoods.begin(), slotCount * mBeamWidth, hCombinedLikelihoods);
+    std::copy_n(mVocabularyIndices.begin(), slotCount * mBeamWidth, hVocabularyIndices);
+    std::copy_n(mRayOptionIndices.begin(), slotCount * mBeamWidth, hRayOptionIndices);
+}
+
+std::string MockGenerator::getInfo()
+{
+    std::stringstream ss;
+    ss << "Mock Generator (CPU), vocabulary = " << mVocabularySize << ", beam = " << mBeamWidth;
+    return ss.str();
+}
+} // namespace nmtSample
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SAMPLE_NMT_MOCK_GENERATOR_
+#define SAMPLE_NMT_MOCK_GENERATOR_
+
+#include "batchGenerator.h"
+#include "likelihoodCombinationOperator.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace nmtSample
+{
+/** \class MockGenerator
+ *
+ * \brief CPU stand-in for the encoder and generator engines, to exercise batch scheduling without a GPU
+ *
+ * Each ray carries a hash of the tokens it was fed as its decoder state, and the next token probabilities are a
+ * softmax over a few pseudo-random tokens picked from that hash and the source sentence. The end of sequence token
+ * becomes likely once a ray is as long as the source sentence. The per-slot state is laid out, moved and shuffled the
+ * way the engine buffers are, so a translation only depends on its sample and not on the slot it ran in.
+ *
+ */
+class MockGenerator : public BatchGenerator
+{
+public:
+    MockGenerator(int vocabularySize, int endSequenceId,
+        LikelihoodCombinationOperator::ptr likelihoodCombinationOperator, int beamWidth, int maxSlotCount,
+        int maxInputSequenceLength);
+
+    bool encode(int firstSlot, int sampleCount, const int* hInputData, const int* hActualInputSequenceLengths) override;
+
+    void moveSlot(int fromSlot, int toSlot) override;
+
+    bool startTimestep(int slotCount, int shuffledSlotCount, const int* hSourceRayIndices, const int* hInputTokens,
+        const float* hInputLikelihoods) override;
+
+    void finishTimestep(
+        int slotCount, float* hCombinedLikelihoods, int* hVocabularyIndices, int* hRayOptionIndices) override;
+
+    std::string getInfo() override;
+
+    ~MockGenerator() override = default;
+
+private:
+    struct RayState
+    {
+        uint64_t history;
+        int position;
+    };
+
+    int mVocabularySize;
+    int mEndSequenceId;
+    LikelihoodCombinationOperator::ptr mLikelihoodCombinationOperator;
+    int mBeamWidth;
+    int mMaxInputSequenceLength;
+    int mOptionCount;
+
+    // "Device" state, per slot
+    std::vector<int> mMemory;
+    std::vector<int> mActualInputSequenceLengths;
+    std::vector<RayState> mInputStates;
+    std::vector<RayState> mOutputStates;
+
+    std::vector<float> mCombinedLikelihoods;
+    std::vector<int> mVocabularyIndices;
+    std::vector<int> mRayOptionIndices;
+};
+} // namespace nmtSample
+
+#endif // SAMPLE_NMT_MOCK_GENERATOR_
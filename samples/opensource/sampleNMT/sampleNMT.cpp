@@ -26,6 +26,7 @@
 #include <iostream>
 #include <map>
 #include <sstream>
+#include <thread>
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -37,9 +38,11 @@
 #include "data/bleuScoreWriter.h"
 #include "data/dataReader.h"
 #include "data/dataWriter.h"
+#include "data/lengthBucketedDataReader.h"
 #include "data/limitedSamplesDataReader.h"
+#include "data/mappedTextReader.h"
+#include "data/orderRestoringDataWriter.h"
 #include "data/sequenceProperties.h"
-#include "data/textReader.h"
 #include "data/textWriter.h"
 #include "data/vocabulary.h"
 #include "deviceBuffer.h"
@@ -49,6 +52,7 @@
 #include "model/beamSearchPolicy.h"
 #include "model/componentWeights.h"
 #include "model/contextNMT.h"
+#include "model/continuousBatchScheduler.h"
 #include "model/debugUtil.h"
 #include "model/decoder.h"
 #include "model/embedder.h"
@@ -56,6 +60,7 @@
 #include "model/likelihood.h"
 #include "model/lstmDecoder.h"
 #include "model/lstmEncoder.h"
+#include "model/mockGenerator.h"
 #include "model/multiplicativeAlignment.h"
 #include "model/projection.h"
 #include "model/slpAttention.h"
@@ -85,6 +90,13 @@ bool gVerbose = false;
 bool gInt8 = false;
 int gUseDLACore{-1};
 int gPadMultiple = 1;
+bool gContinuousBatching = false;
+int gMinRefill = -1;
+bool gMockGenerator = false;
+int gBucketWindow = 0;
+bool gBinaryVocabulary = false;
+bool gConvertVocabulary = false;
+int gBleuInterval = 0;
 
 const std::string gSampleName = "TensorRT.sample_nmt";
 
@@ -112,22 +124,61 @@ nmtSample::SequenceProperties::ptr getOutputSequenceProperties()
     return gOutputVocabulary;
 }
 
-nmtSample::DataReader::ptr getDataReader()
+//! Binary vocabularies are stored next to the text ones, with this suffix
+const std::string gBinaryVocabularySuffix(".bin");
+
+bool readVocabulary(const std::string& fileName, nmtSample::Vocabulary& vocabulary)
 {
-    std::shared_ptr<std::istream> textInput(new std::ifstream(locateNMTFile(gInputTextFileName)));
-    std::shared_ptr<std::istream> vocabInput(new std::ifstream(locateNMTFile(gInputVocabularyFileName)));
-    assert(textInput->good());
-    assert(vocabInput->good());
+    if (gBinaryVocabulary)
+        return vocabulary.readBinary(locateNMTFile(fileName + gBinaryVocabularySuffix));
+
+    std::ifstream input(locateNMTFile(fileName));
+    if (!input.good())
+        return false;
+    input >> vocabulary;
+    return true;
+}
 
+//! Writes the binary version of a text vocabulary next to it
+bool convertVocabulary(const std::string& fileName)
+{
+    nmtSample::Vocabulary vocabulary;
+    std::string filePath = locateNMTFile(fileName);
+    std::ifstream input(filePath);
+    if (!input.good())
+        return false;
+    input >> vocabulary;
+    if (!vocabulary.writeBinary(filePath + gBinaryVocabularySuffix))
+        return false;
+    sample::gLogInfo << "Wrote " << filePath + gBinaryVocabularySuffix << std::endl;
+    return true;
+}
+
+nmtSample::DataReader::ptr getDataReader()
+{
     auto vocabulary = std::make_shared<nmtSample::Vocabulary>();
-    *vocabInput >> *vocabulary;
+    if (!readVocabulary(gInputVocabularyFileName, *vocabulary))
+    {
+        sample::gLogError << "Cannot read vocabulary " << gInputVocabularyFileName << std::endl;
+        return nullptr;
+    }
 
-    auto reader = std::make_shared<nmtSample::TextReader>(textInput, vocabulary);
+    auto reader = std::make_shared<nmtSample::MappedTextReader>(
+        locateNMTFile(gInputTextFileName), vocabulary, std::thread::hardware_concurrency());
+    if (!reader->isOpen())
+    {
+        sample::gLogError << "Cannot map input text " << gInputTextFileName << std::endl;
+        return nullptr;
+    }
 
+    nmtSample::DataReader::ptr limitedReader = reader;
     if (gMaxInferenceSamples >= 0)
-        return std::make_shared<nmtSample::LimitedSamplesDataReader>(gMaxInferenceSamples, reader);
+        limitedReader = std::make_shared<nmtSample::LimitedSamplesDataReader>(gMaxInferenceSamples, reader);
+
+    if (gBucketWindow > 0)
+        return std::make_shared<nmtSample::LengthBucketedDataReader>(gBucketWindow, limitedReader);
     else
-        return reader;
+        return limitedReader;
 }
 
 template <typename Component>
@@ -192,13 +243,34 @@ nmtSample::BeamSearchPolicy::ptr getSearchPolicy(
     return std::make_shared<nmtSample::BeamSearchPolicy>(endSequenceId, likelihoodCombinationOperator, gBeamWidth);
 }
 
-nmtSample::DataWriter::ptr getDataWriter()
+nmtSample::ContinuousBatchScheduler::ptr getContinuousBatchScheduler(int startSequenceId, int endSequenceId,
+    nmtSample::LikelihoodCombinationOperator::ptr likelihoodCombinationOperator)
 {
+    // By default refill once an eighth of the batch is free
+    int minRefill = gMinRefill > 0 ? gMinRefill : std::max(gMaxBatchSize / 8, 1);
+    return std::make_shared<nmtSample::ContinuousBatchScheduler>(
+        startSequenceId, endSequenceId, likelihoodCombinationOperator, gBeamWidth, gMaxBatchSize, minRefill);
+}
+
+void reportContinuousBatching(const nmtSample::ContinuousBatchScheduler& scheduler)
+{
+    sample::gLogInfo << "Continuous batching: " << scheduler.getTimestepCount() << " generator timesteps, "
+                     << scheduler.getEncoderBatchCount() << " encoder runs, " << std::setprecision(3)
+                     << scheduler.getSlotOccupancy() * 100.0f << "% slot occupancy" << std::endl;
+}
+
+nmtSample::DataWriter::ptr getDataWriter(nmtSample::DataReader::ptr dataReader)
+{
+    // Samples reordered by length are written back in their original order
+    auto bucketedDataReader = std::dynamic_pointer_cast<nmtSample::LengthBucketedDataReader>(dataReader);
+    if (bucketedDataReader)
+        return std::make_shared<nmtSample::OrderRestoringDataWriter>(getDataWriter(nullptr), bucketedDataReader);
+
     if (gDataWriterStr == "bleu")
     {
         std::shared_ptr<std::istream> textInput(new std::ifstream(locateNMTFile(gReferenceOutputTextFileName)));
         assert(textInput->good());
-        return std::make_shared<nmtSample::BLEUScoreWriter>(textInput, gOutputVocabulary);
+        return std::make_shared<nmtSample::BLEUScoreWriter>(textInput, gOutputVocabulary, 4, gBleuInterval);
     }
     else if (gDataWriterStr == "text")
     {
@@ -303,6 +375,27 @@ void printUsage()
         "0 to n-1, where n is the number of DLA engines on the platform.\n");
     printf(
         "  --padMultiple=N                      Specify multiple to pad out matrix dimensions to test performance\n");
+    printf(
+        "  --continuous_batching                Retire finished samples after every generator timestep and refill "
+        "their slots with new samples\n");
+    printf(
+        "  --min_refill=N                       Free slots needed to run the encoder while other samples are in "
+        "flight, with continuous_batching (default = batch / 8)\n");
+    printf(
+        "  --mock_generator                     Run continuous batching with a CPU stand-in for the engines, to test "
+        "the scheduling without a GPU\n");
+    printf(
+        "  --bucket_window=N                    Read N samples ahead and group them by length into batches, 0 "
+        "disables it (default = %d)\n",
+        gBucketWindow);
+    printf(
+        "  --convert_vocabulary                 Write binary versions of the vocabularies next to them, with a .bin "
+        "suffix, and exit\n");
+    printf("  --binary_vocabulary                  Map the binary vocabularies written by convert_vocabulary\n");
+    printf(
+        "  --bleu_interval=N                    Log the BLEU score of the samples translated so far every N samples "
+        "when data_writer=bleu, 0 disables it (default = %d)\n",
+        gBleuInterval);
 }
 
 bool parseNMTArgs(samplesCommon::Args& args, int argc, char* argv[])
@@ -350,6 +443,20 @@ bool parseNMTArgs(samplesCommon::Args& args, int argc, char* argv[])
             continue;
         if (parseInt(argv[j], "padMultiple", gPadMultiple))
             continue;
+        if (parseBool(argv[j], "continuous_batching", gContinuousBatching))
+            continue;
+        if (parseInt(argv[j], "min_refill", gMinRefill))
+            continue;
+        if (parseBool(argv[j], "mock_generator", gMockGenerator))
+            continue;
+        if (parseInt(argv[j], "bucket_window", gBucketWindow))
+            continue;
+        if (parseBool(argv[j], "convert_vocabulary", gConvertVocabulary))
+            continue;
+        if (parseBool(argv[j], "binary_vocabulary", gBinaryVocabulary))
+            continue;
+        if (parseInt(argv[j], "bleu_interval", gBleuInterval))
+            continue;
     }
 
     if (showHelp)
@@ -792,6 +899,197 @@ void processBindings(
     }
 }
 
+//!
+//! \brief Runs the encoder and generator engines on the slots of a continuous batch.
+//!
+//! The encoder writes its outputs straight into the slots being refilled by offsetting their bindings, and moving a
+//! sample to another slot copies each per-slot device buffer.
+//!
+class TrtBatchGenerator : public nmtSample::BatchGenerator
+{
+public:
+    //! Device buffer holding bytesPerSlot bytes of state for each slot
+    struct SlotBuffer
+    {
+        void* data;
+        size_t bytesPerSlot;
+    };
+
+    //! Device buffers the host inputs and outputs of the engines are copied to and from
+    struct IOBuffers
+    {
+        int* inputEncoderData;
+        int* inputSequenceLengths;
+        int* sourceRayIndices;
+        int* inputTokens;
+        float* inputLikelihoods;
+        float* outputCombinedLikelihoods;
+        int* outputVocabularyIndices;
+        int* outputRayOptionIndices;
+    };
+
+    TrtBatchGenerator(cudaStream_t stream, nvinfer1::ICudaEngine* encoderEngine,
+        nvinfer1::IExecutionContext* encoderContext, std::unordered_map<std::string, void*> encoderBindingMap,
+        nvinfer1::IExecutionContext* generatorContext, std::vector<void*> generatorBindings,
+        nvinfer1::IExecutionContext* generatorShuffleContext, std::vector<void*> generatorShuffleBindings,
+        const IOBuffers& ioBuffers, int maxSlotCount, int beamWidth, int maxInputSequenceLength)
+        : mStream(stream)
+        , mEncoderEngine(encoderEngine)
+        , mEncoderContext(encoderContext)
+        , mEncoderBindingMap(std::move(encoderBindingMap))
+        , mEncoderBindings(encoderEngine->getNbBindings())
+        , mGeneratorContext(generatorContext)
+        , mGeneratorBindings(std::move(generatorBindings))
+        , mGeneratorShuffleContext(generatorShuffleContext)
+        , mGeneratorShuffleBindings(std::move(generatorShuffleBindings))
+        , mIO(ioBuffers)
+        , mBeamWidth(beamWidth)
+        , mMaxInputSequenceLength(maxInputSequenceLength)
+        , mInputDataHostBuffer(maxSlotCount * maxInputSequenceLength)
+        , mInputSequenceLengthsHostBuffer(maxSlotCount)
+        , mSourceRayIndicesHostBuffer(maxSlotCount * beamWidth)
+        , mInputTokensHostBuffer(maxSlotCount * beamWidth)
+        , mInputLikelihoodsHostBuffer(maxSlotCount * beamWidth)
+        , mCombinedLikelihoodsHostBuffer(maxSlotCount * beamWidth)
+        , mVocabularyIndicesHostBuffer(maxSlotCount * beamWidth)
+        , mRayOptionIndicesHostBuffer(maxSlotCount * beamWidth)
+    {
+    }
+
+    //! The encoder output bound to name is written at the slot being refilled
+    void addEncoderOutput(const std::string& name, const SlotBuffer& buffer)
+    {
+        mEncoderOutputs[name] = buffer;
+    }
+
+    //! The buffer is copied when a sample moves to another slot
+    void addMovedBuffer(const SlotBuffer& buffer)
+    {
+        mMovedBuffers.push_back(buffer);
+    }
+
+    //! The buffer is cleared for the slots being refilled
+    void addZeroedBuffer(const SlotBuffer& buffer)
+    {
+        mZeroedBuffers.push_back(buffer);
+    }
+
+    bool encode(int firstSlot, int sampleCount, const int* hInputData, const int* hActualInputSequenceLengths) override
+    {
+        std::copy_n(hInputData, sampleCount * mMaxInputSequenceLength, (int*) mInputDataHostBuffer);
+        std::copy_n(hActualInputSequenceLengths, sampleCount, (int*) mInputSequenceLengthsHostBuffer);
+        CUDA_CHECK(cudaMemcpyAsync(mIO.inputEncoderData, mInputDataHostBuffer,
+            sampleCount * mMaxInputSequenceLength * sizeof(int), cudaMemcpyHostToDevice, mStream));
+        CUDA_CHECK(cudaMemcpyAsync(mIO.inputSequenceLengths, mInputSequenceLengthsHostBuffer,
+            sampleCount * sizeof(int), cudaMemcpyHostToDevice, mStream));
+
+        auto bindingMap = mEncoderBindingMap;
+        for (const auto& output : mEncoderOutputs)
+            bindingMap[output.first] = slotAddress(output.second, firstSlot);
+        processBindings(mEncoderBindings, bindingMap, mEncoderEngine);
+        if (!mEncoderContext->enqueue(sampleCount, &mEncoderBindings[0], mStream, nullptr))
+        {
+            sample::gLogError << "Error in encoder context enqueue" << std::endl;
+            return false;
+        }
+
+        for (const auto& buffer : mZeroedBuffers)
+            CUDA_CHECK(cudaMemsetAsync(slotAddress(buffer, firstSlot), 0, sampleCount * buffer.bytesPerSlot, mStream));
+        return true;
+    }
+
+    void moveSlot(int fromSlot, int toSlot) override
+    {
+        for (const auto& buffer : mMovedBuffers)
+            CUDA_CHECK(cudaMemcpyAsync(slotAddress(buffer, toSlot), slotAddress(buffer, fromSlot), buffer.bytesPerSlot,
+                cudaMemcpyDeviceToDevice, mStream));
+    }
+
+    bool startTimestep(int slotCount, int shuffledSlotCount, const int* hSourceRayIndices, const int* hInputTokens,
+        const float* hInputLikelihoods) override
+    {
+        const int rayCount = slotCount * mBeamWidth;
+        if (shuffledSlotCount > 0)
+        {
+            std::copy_n(hSourceRayIndices, shuffledSlotCount * mBeamWidth, (int*) mSourceRayIndicesHostBuffer);
+            CUDA_CHECK(cudaMemcpyAsync(mIO.sourceRayIndices, mSourceRayIndicesHostBuffer,
+                shuffledSlotCount * mBeamWidth * sizeof(int), cudaMemcpyHostToDevice, mStream));
+            if (!mGeneratorShuffleContext->enqueue(shuffledSlotCount, &mGeneratorShuffleBindings[0], mStream, nullptr))
+            {
+                sample::gLogError << "Error in generator shuffle context enqueue" << std::endl;
+                return false;
+            }
+        }
+        std::copy_n(hInputTokens, rayCount, (int*) mInputTokensHostBuffer);
+        std::copy_n(hInputLikelihoods, rayCount, (float*) mInputLikelihoodsHostBuffer);
+        CUDA_CHECK(cudaMemcpyAsync(
+            mIO.inputTokens, mInputTokensHostBuffer, rayCount * sizeof(int), cudaMemcpyHostToDevice, mStream));
+        CUDA_CHECK(cudaMemcpyAsync(mIO.inputLikelihoods, mInputLikelihoodsHostBuffer, rayCount * sizeof(float),
+            cudaMemcpyHostToDevice, mStream));
+
+        if (!mGeneratorContext->enqueue(slotCount, &mGeneratorBindings[0], mStream, nullptr))
+        {
+            sample::gLogError << "Error in generator context enqueue" << std::endl;
+            return false;
+        }
+
+        CUDA_CHECK(cudaMemcpyAsync(mCombinedLikelihoodsHostBuffer, mIO.outputCombinedLikelihoods,
+            rayCount * sizeof(float), cudaMemcpyDeviceToHost, mStream));
+        CUDA_CHECK(cudaMemcpyAsync(mVocabularyIndicesHostBuffer, mIO.outputVocabularyIndices, rayCount * sizeof(int),
+            cudaMemcpyDeviceToHost, mStream));
+        CUDA_CHECK(cudaMemcpyAsync(mRayOptionIndicesHostBuffer, mIO.outputRayOptionIndices, rayCount * sizeof(int),
+            cudaMemcpyDeviceToHost, mStream));
+        return true;
+    }
+
+    void finishTimestep(
+        int slotCount, float* hCombinedLikelihoods, int* hVocabularyIndices, int* hRayOptionIndices) override
+    {
+        CUDA_CHECK(cudaStreamSynchronize(mStream));
+        const int rayCount = slotCount * mBeamWidth;
+        std::copy_n((const float*) mCombinedLikelihoodsHostBuffer, rayCount, hCombinedLikelihoods);
+        std::copy_n((const int*) mVocabularyIndicesHostBuffer, rayCount, hVocabularyIndices);
+        std::copy_n((const int*) mRayOptionIndicesHostBuffer, rayCount, hRayOptionIndices);
+    }
+
+    std::string getInfo() override
+    {
+        return "TensorRT Batch Generator";
+    }
+
+private:
+    static void* slotAddress(const SlotBuffer& buffer, int slot)
+    {
+        return static_cast<char*>(buffer.data) + slot * buffer.bytesPerSlot;
+    }
+
+    cudaStream_t mStream;
+    nvinfer1::ICudaEngine* mEncoderEngine;
+    nvinfer1::IExecutionContext* mEncoderContext;
+    std::unordered_map<std::string, void*> mEncoderBindingMap;
+    std::vector<void*> mEncoderBindings;
+    nvinfer1::IExecutionContext* mGeneratorContext;
+    std::vector<void*> mGeneratorBindings;
+    nvinfer1::IExecutionContext* mGeneratorShuffleContext;
+    std::vector<void*> mGeneratorShuffleBindings;
+    IOBuffers mIO;
+    int mBeamWidth;
+    int mMaxInputSequenceLength;
+
+    std::unordered_map<std::string, SlotBuffer> mEncoderOutputs;
+    std::vector<SlotBuffer> mMovedBuffers;
+    std::vector<SlotBuffer> mZeroedBuffers;
+
+    nmtSample::PinnedHostBuffer<int> mInputDataHostBuffer;
+    nmtSample::PinnedHostBuffer<int> mInputSequenceLengthsHostBuffer;
+    nmtSample::PinnedHostBuffer<int> mSourceRayIndicesHostBuffer;
+    nmtSample::PinnedHostBuffer<int> mInputTokensHostBuffer;
+    nmtSample::PinnedHostBuffer<float> mInputLikelihoodsHostBuffer;
+    nmtSample::PinnedHostBuffer<float> mCombinedLikelihoodsHostBuffer;
+    nmtSample::PinnedHostBuffer<int> mVocabularyIndicesHostBuffer;
+    nmtSample::PinnedHostBuffer<int> mRayOptionIndicesHostBuffer;
+};
+
 int main(int argc, char** argv)
 {
     auto sampleTest = sample::gLogger.defineTest(gSampleName, argc, argv);
@@ -813,23 +1111,55 @@ int main(int argc, char** argv)
         sample::setReportableSeverity(ILogger::Severity::kVERBOSE);
     }
 
+    if (gConvertVocabulary)
+    {
+        bool pass = convertVocabulary(gInputVocabularyFileName) && convertVocabulary(gOutputVocabularyFileName);
+        return sample::gLogger.reportTest(sampleTest, pass);
+    }
+
     // Set up output vocabulary
+    if (!readVocabulary(gOutputVocabularyFileName, *gOutputVocabulary))
     {
-        std::string vocabularyFilePath = gOutputVocabularyFileName;
-        std::ifstream vocabStream(locateNMTFile(vocabularyFilePath));
-        if (!vocabStream.good())
-        {
-            sample::gLogError << "Cannot open file " << vocabularyFilePath << std::endl;
+        sample::gLogError << "Cannot read vocabulary " << gOutputVocabularyFileName << std::endl;
+        return sample::gLogger.reportFail(sampleTest);
+    }
+
+    if (gMockGenerator)
+    {
+        // Translation quality is meaningless here, only the scheduling is exercised
+        auto outputSequenceProperties = getOutputSequenceProperties();
+        auto likelihoodCombinationOperator = getLikelihood()->getLikelihoodCombinationOperator();
+        auto dataReader = getDataReader();
+        if (!dataReader)
             return sample::gLogger.reportFail(sampleTest);
-        }
-        vocabStream >> *gOutputVocabulary;
+        auto dataWriter = getDataWriter(dataReader);
+        nmtSample::MockGenerator generator(gOutputVocabulary->getSize(), outputSequenceProperties->getEndSequenceId(),
+            likelihoodCombinationOperator, gBeamWidth, gMaxBatchSize, gMaxInputSequenceLength);
+        auto scheduler = getContinuousBatchScheduler(outputSequenceProperties->getStartSequenceId(),
+            outputSequenceProperties->getEndSequenceId(), likelihoodCombinationOperator);
+
+        dataWriter->initialize();
+        auto startLatency = std::chrono::high_resolution_clock::now();
+        bool pass = scheduler->translate(
+            *dataReader, *dataWriter, generator, gMaxInputSequenceLength, gMaxOutputSequenceLength);
+        float totalLatency = std::chrono::duration<float, std::milli>(
+            std::chrono::high_resolution_clock::now() - startLatency)
+                                 .count();
+        dataWriter->finalize();
+
+        reportContinuousBatching(*scheduler);
+        sample::gLogInfo << "Total latency with the mock generator = " << totalLatency << " ms" << std::endl;
+        return sample::gLogger.reportTest(sampleTest, pass);
     }
 
+    auto dataReader = getDataReader();
+    if (!dataReader)
+        return sample::gLogger.reportFail(sampleTest);
+
     cudaStream_t stream;
     CUDA_CHECK(cudaStreamCreate(&stream));
 
     auto outputSequenceProperties = getOutputSequenceProperties();
-    auto dataReader = getDataReader();
     auto inputEmbedder = getInputEmbedder();
     auto outputEmbedder = getOutputEmbedder();
     auto encoder = getEncoder();
@@ -841,7 +1171,7 @@ int main(int argc, char** argv)
     auto likelihood = getLikelihood();
     auto searchPolicy
         = getSearchPolicy(outputSequenceProperties->getEndSequenceId(), likelihood->getLikelihoodCombinationOperator());
-    auto dataWriter = getDataWriter();
+    auto dataWriter = getDataWriter(dataReader);
 
     if (gPrintComponentInfo)
     {
@@ -1121,8 +1451,9 @@ int main(int argc, char** argv)
 
     std::vector<int> outputHostBuffer;
     auto startDataRead = std::chrono::high_resolution_clock::now();
-    int inputSamplesRead = dataReader->read(
-        gMaxBatchSize, gMaxInputSequenceLength, *inputOriginalHostBuffer, *inputOriginalSequenceLengthsHostBuffer);
+    int inputSamplesRead = gContinuousBatching ? 0
+                                               : dataReader->read(gMaxBatchSize, gMaxInputSequenceLength,
+                                                   *inputOriginalHostBuffer, *inputOriginalSequenceLengthsHostBuffer);
     if (gEnableProfiling)
         profilers[0].reportLayerTime("Data Read",
             std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startDataRead)
@@ -1130,6 +1461,63 @@ int main(int argc, char** argv)
     // Outer loop over batches of samples
     auto startLatency = std::chrono::high_resolution_clock::now();
     int batchCount = 0;
+    if (gContinuousBatching)
+    {
+        TrtBatchGenerator::IOBuffers ioBuffers{*inputEncoderDeviceBuffer, *inputSequenceLengthsDeviceBuffer,
+            *sourceRayIndicesDeviceBuffer, *inputDecoderDeviceBuffer, *inputLikelihoodsDeviceBuffer,
+            *outputCombinedLikelihoodDeviceBuffer, *inputDecoderDeviceBuffer, *outputRayOptionIndicesDeviceBuffer};
+        TrtBatchGenerator generator(stream, encoderEngine, encoderContext, encBindingMap, generatorContext,
+            generatorBindings, generatorShuffleContext, generatorShuffleBindings, ioBuffers, gMaxBatchSize, gBeamWidth,
+            gMaxInputSequenceLength);
+
+        // State buffers hold half floats in fp16 mode
+        const size_t stateElementSize = gFp16 ? sizeof(uint16_t) : sizeof(float);
+        TrtBatchGenerator::SlotBuffer memoryStates{
+            *memoryStatesDeviceBuffer, gMaxInputSequenceLength * encoder->getMemoryStatesSize() * stateElementSize};
+        generator.addEncoderOutput("memory_states", memoryStates);
+        generator.addMovedBuffer(memoryStates);
+        if (alignment->getAttentionKeySize() > 0)
+        {
+            TrtBatchGenerator::SlotBuffer attentionKeys{*attentionKeysDeviceBuffer,
+                gMaxInputSequenceLength * alignment->getAttentionKeySize() * stateElementSize};
+            generator.addEncoderOutput("attention_keys", attentionKeys);
+            generator.addMovedBuffer(attentionKeys);
+        }
+        TrtBatchGenerator::SlotBuffer sequenceLengths{
+            *inputSequenceLengthsReplicatedDeviceBuffer, gBeamWidth * sizeof(int)};
+        generator.addEncoderOutput("actual_input_sequence_lengths_replicated", sequenceLengths);
+        generator.addMovedBuffer(sequenceLengths);
+        for (int i = 0; i < static_cast<int>(stateSizes.size()); ++i)
+        {
+            const size_t bytesPerSlot = gBeamWidth * nmtSample::getVolume(stateSizes[i]) * stateElementSize;
+            TrtBatchGenerator::SlotBuffer inputStates{*inputDecoderStatesDeviceBuffers[i], bytesPerSlot};
+            if (gInitializeDecoderFromEncoderHiddenStates)
+            {
+                std::stringstream ss;
+                ss << "input_decoder_states_" << i;
+                generator.addEncoderOutput(ss.str(), inputStates);
+            }
+            else
+            {
+                generator.addZeroedBuffer(inputStates);
+            }
+            generator.addMovedBuffer({*outputDecoderStatesDeviceBuffers[i], bytesPerSlot});
+        }
+        if (gFeedAttentionToInput)
+        {
+            const size_t bytesPerSlot = gBeamWidth * attention->getAttentionSize() * stateElementSize;
+            generator.addZeroedBuffer({*inputAttentionDeviceBuffer, bytesPerSlot});
+            generator.addMovedBuffer({*outputAttentionDeviceBuffer, bytesPerSlot});
+        }
+
+        auto scheduler = getContinuousBatchScheduler(outputSequenceProperties->getStartSequenceId(),
+            outputSequenceProperties->getEndSequenceId(), likelihood->getLikelihoodCombinationOperator());
+        if (!scheduler->translate(
+                *dataReader, *dataWriter, generator, gMaxInputSequenceLength, gMaxOutputSequenceLength))
+            return sample::gLogger.reportTest(sampleTest, false);
+        batchCount = scheduler->getEncoderBatchCount();
+        reportContinuousBatching(*scheduler);
+    }
     while (inputSamplesRead > 0)
     {
         ++batchCount;
@@ -1280,8 +1668,11 @@ int main(int argc, char** argv)
         = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startLatency).count();
 
     dataWriter->finalize();
+    auto scoreWriter = dataWriter;
+    if (auto orderRestoringWriter = std::dynamic_pointer_cast<nmtSample::OrderRestoringDataWriter>(dataWriter))
+        scoreWriter = orderRestoringWriter->getOriginalDataWriter();
     float score
-        = gDataWriterStr == "bleu" ? static_cast<nmtSample::BLEUScoreWriter*>(dataWriter.get())->getScore() : -1.0f;
+        = gDataWriterStr == "bleu" ? static_cast<nmtSample::BLEUScoreWriter*>(scoreWriter.get())->getScore() : -1.0f;
 
     if (gDataWriterStr == "benchmark")
     {
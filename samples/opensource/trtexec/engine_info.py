@@ -0,0 +1,138 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+
+'''
+Print the header and metadata of a trtexec engine file
+
+Given an engine file saved by trtexec with --saveEngine --engineHeader, this program
+prints the TensorRT version, build options, plugins and bindings
+recorded in its header, without loading the engine or needing a GPU.
+Optionally, the checksum of the engine is verified, and the raw
+serialized engine is extracted for runtimes that expect one.
+'''
+
+import sys
+import json
+import mmap
+import struct
+import zlib
+import argparse
+
+
+headerFormat = '<8sIIQQQQIIQ'
+
+headerFields = ['magic', 'version', 'tensorrtVersion', 'metadataOffset', 'metadataSize',
+                'engineOffset', 'engineSize', 'metadataCrc', 'engineCrc', 'reserved']
+
+magic = b'TRTENGIN'
+
+supportedVersion = 1
+
+
+
+def versionToString(version):
+    ''' Format a version as returned by getInferLibVersion() '''
+
+    return '{}.{}.{}'.format(version // 1000, version // 100 % 10, version % 100)
+
+
+
+def readHeader(data):
+    ''' Read and check the header, and return it as a dictionary '''
+
+    size = struct.calcsize(headerFormat)
+    if len(data) < size or data[:len(magic)] != magic:
+        raise ValueError('not an engine file, the engine may have been saved without --engineHeader')
+
+    header = dict(zip(headerFields, struct.unpack(headerFormat, data[:size])))
+    if header['version'] != supportedVersion:
+        raise ValueError('unsupported engine file version {}'.format(header['version']))
+    for part in ['metadata', 'engine']:
+        if header[part + 'Offset'] + header[part + 'Size'] > len(data):
+            raise ValueError('engine file is truncated')
+
+    return header
+
+
+
+def crc(data, offset, size):
+    ''' CRC-32 of a part of data, computed in chunks '''
+
+    chunk = 1 << 24
+    value = 0
+    for start in range(offset, offset + size, chunk):
+        value = zlib.crc32(data[start:min(start + chunk, offset + size)], value)
+    return value & 0xFFFFFFFF
+
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('--verify', action='store_true', help='Verify the checksum of the engine.')
+    parser.add_argument('--json', action='store_true', help='Print the header and metadata as JSON.')
+    parser.add_argument('--extract', metavar='file', help='Write the raw serialized engine to file.')
+    parser.add_argument('name', metavar='filename', help='Engine file.')
+    args = parser.parse_args()
+
+    with open(args.name, 'rb') as f:
+        data = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+
+    try:
+        header = readHeader(data)
+    except ValueError as e:
+        print('{}: {}'.format(args.name, e), file=sys.stderr)
+        return 1
+
+    offset = header['metadataOffset']
+    if crc(data, offset, header['metadataSize']) != header['metadataCrc']:
+        print('{}: metadata checksum mismatch'.format(args.name), file=sys.stderr)
+        return 1
+    metadata = json.loads(data[offset:offset + header['metadataSize']].decode('utf-8'))
+
+    status = 0
+    if args.verify:
+        valid = crc(data, header['engineOffset'], header['engineSize']) == header['engineCrc']
+        print('Engine checksum: ' + ('valid' if valid else 'MISMATCH'))
+        status = 0 if valid else 1
+
+    if args.extract:
+        with open(args.extract, 'wb') as f:
+            f.write(data[header['engineOffset']:header['engineOffset'] + header['engineSize']])
+
+    if args.json:
+        del header['magic']
+        print(json.dumps({'header': header, 'metadata': metadata}, indent=2))
+        return status
+
+    print('TensorRT version: ' + versionToString(header['tensorrtVersion']))
+    print('Engine size: {} bytes'.format(header['engineSize']))
+    for key, value in metadata.items():
+        if key == 'bindings':
+            print('Bindings:')
+            for b in value:
+                dims = 'x'.join(str(d) for d in b['dims'])
+                print('  {} {} {} {} {}'.format('input ' if b['input'] else 'output', b['name'], b['type'],
+                                                dims, b['format']))
+        else:
+            print('{}: {}'.format(key, json.dumps(value)))
+
+    return status
+
+
+if __name__ == '__main__':
+    sys.exit(main())
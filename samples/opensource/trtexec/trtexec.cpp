@@ -59,7 +59,7 @@ void printPerformanceProfile(const ReportingOptions& reporting, const InferenceE
     }
 }
 
-void printOutput(const ReportingOptions& reporting, const InferenceEnvironment& iEnv, std::ostream& os)
+bool printOutput(const ReportingOptions& reporting, const InferenceEnvironment& iEnv, std::ostream& os)
 {
     if (reporting.output)
     {
@@ -69,6 +69,38 @@ void printOutput(const ReportingOptions& reporting, const InferenceEnvironment&
     {
         exportJSONOutput(*iEnv.context.front(), *iEnv.bindings.front(), reporting.exportOutput);
     }
+    if (!reporting.exportOutputNpy.empty())
+    {
+        return exportNpyOutput(*iEnv.context.front(), *iEnv.bindings.front(), reporting.exportOutputNpy);
+    }
+    return true;
+}
+
+void measurePerformance(const AllOptions& options, InferenceEnvironment& iEnv, TimelineWriter* timeline)
+{
+    InferenceStatistics statistics(static_cast<float>(options.inference.warmup), options.reporting.avgs,
+        !options.reporting.exportTimes.empty());
+    statistics.setTimeline(timeline);
+    if (options.inference.arrivalRates.size() > 1)
+    {
+        // Sweep the offered load, one open-loop run per rate
+        std::vector<InferenceStatistics> loadCurve;
+        for (const auto rate : options.inference.arrivalRates)
+        {
+            InferenceOptions point = options.inference;
+            point.arrivalRates = {rate};
+            sample::gLogInfo << "Offered load: " << rate << " inferences/s" << std::endl;
+            runInference(point, iEnv, statistics);
+            printPerformanceReport(statistics, options.reporting, options.inference.batch, sample::gLogInfo);
+            loadCurve.push_back(statistics);
+        }
+        printLoadCurve(options.inference.arrivalRates, loadCurve, options.reporting.percentiles, sample::gLogInfo);
+    }
+    else
+    {
+        runInference(options.inference, iEnv, statistics);
+        printPerformanceReport(statistics, options.reporting, options.inference.batch, sample::gLogInfo);
+    }
 }
 
 int main(int argc, char** argv)
@@ -133,6 +165,30 @@ int main(int argc, char** argv)
         sample::setReportableSeverity(ILogger::Severity::kVERBOSE);
     }
 
+    std::unique_ptr<TimelineWriter> timeline;
+    if (!options.reporting.exportTimeline.empty())
+    {
+        timeline.reset(new TimelineWriter(options.reporting.exportTimeline));
+        if (!timeline->isOpen())
+        {
+            sample::gLogError << "Cannot open timeline file: " << options.reporting.exportTimeline << std::endl;
+            return sample::gLogger.reportFail(sampleTest);
+        }
+    }
+
+    if (options.inference.simulation.enabled)
+    {
+        InferenceEnvironment iEnv;
+        if (!setUpSimulation(iEnv, options.inference))
+        {
+            sample::gLogError << "Simulation set up failed" << std::endl;
+            return sample::gLogger.reportFail(sampleTest);
+        }
+        sample::gLogInfo << "Starting simulated inference" << std::endl;
+        measurePerformance(options, iEnv, timeline.get());
+        return sample::gLogger.reportPass(sampleTest);
+    }
+
     setCudaDevice(options.system.device, sample::gLogInfo);
     sample::gLogInfo << std::endl;
 
@@ -181,6 +237,7 @@ int main(int argc, char** argv)
     if ((options.reporting.profile || !options.reporting.exportProfile.empty()) && !options.inference.rerun)
     {
         iEnv.profiler.reset(new Profiler);
+        iEnv.profiler->setTimeline(timeline.get());
         if (options.inference.graph)
         {
             options.inference.graph = false;
@@ -195,18 +252,18 @@ int main(int argc, char** argv)
         sample::gLogError << "Inference set up failed" << std::endl;
         return sample::gLogger.reportFail(sampleTest);
     }
-    std::vector<InferenceTrace> trace;
     sample::gLogInfo << "Starting inference" << std::endl;
-    runInference(options.inference, iEnv, options.system.device, trace);
-
-    printPerformanceReport(trace, options.reporting, static_cast<float>(options.inference.warmup),
-        options.inference.batch, sample::gLogInfo);
-    printOutput(options.reporting, iEnv, sample::gLogInfo);
+    measurePerformance(options, iEnv, timeline.get());
+    if (!printOutput(options.reporting, iEnv, sample::gLogInfo))
+    {
+        return sample::gLogger.reportFail(sampleTest);
+    }
 
     if ((options.reporting.profile || !options.reporting.exportProfile.empty()) && options.inference.rerun)
     {
         auto* profiler = new Profiler;
         iEnv.profiler.reset(profiler);
+        profiler->setTimeline(timeline.get());
         iEnv.context.front()->setProfiler(profiler);
         if (options.inference.graph)
         {
@@ -215,7 +272,9 @@ int main(int argc, char** argv)
                                    "and disabled CUDA graph in the second run with the profiler."
                                 << std::endl;
         }
-        runInference(options.inference, iEnv, options.system.device, trace);
+        InferenceStatistics statistics(static_cast<float>(options.inference.warmup), 0, false);
+        statistics.setTimeline(timeline.get());
+        runInference(options.inference, iEnv, statistics);
     }
     printPerformanceProfile(options.reporting, iEnv, sample::gLogInfo);
 